@@ -20,47 +20,51 @@ const int MAXFILE=100;
 	// Maximum number of files to append
 
 
-void readline(FILE*& in,xtring& text) {
-
-	char ch;
-	text="";
-	while (!feof(in)){
-		ch=getc(in);
-		if (ch=='\n' || feof(in)) return;
-		if (ch!='\r') text+=ch;
-	} 
+void readline(InputFile& in,xtring& text) {
+
+	// Reads the next line of in, omitting any carriage returns
+
+	char* pfrom,*pto;
+	in.readline(text);
+	pfrom=pto=(char*)text;
+	while (*pfrom) {
+		if (*pfrom!='\r') *pto++=*pfrom;
+		pfrom++;
+	}
+	*pto='\0';
 }
 	
 bool readwritedata(xtring* infile,int ninfile,xtring outfile,bool ifstrip,bool ifchain) {
 	
 	xtring text;
-	bool firstline;
-	FILE* in,*out;
+	bool firstline,ok;
+	InputFile in;
+	OutputFile out;
 	int j,pos,first;
 	
 	if (ifchain) {
-		out=fopen(infile[0],"at");
+		ok=out.open(infile[0],true);
 		first=1;
 	}
 	else {
-		out=fopen(outfile,"wt");
+		ok=out.open(outfile);
 		first=0;
 	}
-	if (!out) {
+	if (!ok) {
 		printf("Could not open %s for output\n",(char*)outfile);
 		return false;
 	}
 
 	for (j=first;j<ninfile;j++) {
-		in=fopen(infile[j],"rt");
-		if (!in) {
+		if (!in.open(infile[j])) {
 			printf("Could not open %s for input\n",(char*)infile[j]);
-			fclose(out);
+			out.close();
 			return false;
 		}
 		printf("Reading data from %s\n",(char*)infile[j]);
 		firstline=true;
-		while (!feof(in)) {
+		while (!in.eof()) {
+			runstats.setphase(RunStats::PHASE_READ);
 			readline(in,text);
 			if (ifstrip) {
 				if (firstline && text.findnotoneof(" \t")!=-1) {
@@ -72,14 +76,19 @@ bool readwritedata(xtring* infile,int ninfile,xtring outfile,bool ifstrip,bool i
 			}
 			firstline=false;
 			if (text.findnotoneof(" \t")!=-1 || !ifstrip) {
-				if (text!="" || !feof(in))
-					fprintf(out,"%s\n",(char*)text);
+				if (text!="" || !in.eof()) {
+					runstats.setphase(RunStats::PHASE_FORMAT);
+					out.printf("%s\n",(char*)text);
+					runstats.rowsparsed++;
+				}
 			}
+			else if (text!="" || !in.eof()) runstats.rowsblank++;
 		}
-		fclose(in);
+		in.close();
 	}
 	
-	fclose(out);
+	out.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	printf("\nOutput is in %s\n\n",(char*)outfile);
 	return true;
@@ -125,6 +134,8 @@ void helptext(FILE* out,xtring exe) {
 	fprintf(out,"-n\n");
 	fprintf(out,"    Suppresses purging of header row (if present) in second and subsequent\n");
 	fprintf(out,"    input file and purging of blank lines in all input files\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
 	fprintf(out,"-help\n");
 	fprintf(out,"    Displays this help message\n");
 }
@@ -150,6 +161,7 @@ void abort(xtring exe) {
 	printf("Options: -o <output-file>\n");
 	printf("         -c\n");
 	printf("         -n\n");
+	printf("         -stats\n");
 	printf("         -help\n");
 
 	exit(99);
@@ -183,6 +195,7 @@ bool processargs(int argc,char* argv[],xtring* infile,xtring& outfile,int& ninfi
 				}
 				i+=1;
 			}
+			else if (arg=="-stats") runstats.enable();
 			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
 			else if (arg=="-n") ifstrip=false;
 			else if (arg=="-c") ifchain=true;
@@ -239,5 +252,6 @@ int main(int argc,char* argv[]) {
 	
 	readwritedata(infile,ninfile,outfile,ifstrip,ifchain);
 	
+	runstats.print("append");
 	return 0;
 }
@@ -20,68 +20,11 @@
 
 using namespace std;
 
-const int MAXITEM=380;
-	// Maximum number of items in a record (row) of an output file
-	// (not including longitude,latitude,id and year)
-const int MAXYEAR=10000;
-	// Maximum number of timesteps (need not be consecutive) in time series
-
-class Record {
-
-public:
-	float lon;
-	float lat;
-	float year;
-	int nrec;
-	float val[MAXITEM];
-	double area;
-	
-	Record() {
-	
-		int i;
-		
-		nrec=0;
-		lon=lat=0.0;
-		year=0.0;
-		area=0.0;
-		
-		for (i=0;i<MAXITEM;i++) val[i]=0.0;
-	}
-	
-	void add_record(Record& rec) {
-	
-		// Function to add another record to this record
-		// Pixel area (for weighting) should be set in rec
-		
-		int i;
-		
-		if (year!=rec.year) {
-			printf("add_record: timestep mismatch\n");
-			exit(99);
-		}
-
-		for (i=0;i<MAXITEM;i++) val[i]+=rec.val[i]*rec.area;
-		nrec+=rec.nrec;
-		area+=rec.area;
-	}
-	
-	void average() {
-	
-		// Calculates area-based average over number of added records
-		
-		int i;
-		if (area)
-			for (i=0;i<MAXITEM;i++) {
-				//printf("%d: value=%g area=%g average=%g\n",i,val[i],area,val[i]/area);
-				val[i]/=area;
-			}
-	}
-};
-
 class Item {
 
 public:
 	xtring label,fmt,lfmt;
+	NumberFormat nfmt;
 	bool ifnum;
 	bool ifsign;
 	int places;
@@ -106,9 +49,14 @@ public:
 		
 		if (label.len()>w) w=label.len();
 		
-		if (ifnum)
+		if (ifnum) {
 			fmt.printf("%%%d.%df",w,places);
-		else fmt.printf("%%%dg",w);
+			nfmt.setfixed(w,places);
+		}
+		else {
+			fmt.printf("%%%dg",w);
+			nfmt.setgeneral(w);
+		}
 		
 		lfmt.printf("%%%ds",w);
 	}
@@ -122,11 +70,11 @@ struct Point {
 	float y;
 };
 
-// Global matrix to store data from files
-Record data[MAXYEAR];
+// Global table of weighted sums (then averages) for each timestep, one column per item
+RecordTable data;
 
-// Timestep as specified in input file
-float guessyear[MAXYEAR];
+// Timestep as specified in input file, for each row of data
+vector<float> guessyear;
 
 // Number of unique timesteps in input file
 int nyear;
@@ -198,9 +146,9 @@ bool scanitem(const char* text,int& places,int& digits,bool& ifsign) {
 }
 
 
-bool readheader(FILE*& in,Item* items,int& ncol,
+bool readheader(InputFile& in,vector<Item>& items,int& ncol,
 	int& lonitemno,int& latitemno,int& yearitemno,xtring filename,
-	double values[MAXITEM],bool& ifvalues,int& lineno) {
+	vector<double>& values,bool& ifvalues,int& lineno) {
 
 	// Reads header row of an LPJ-GUESS output file
 	// label = array of header labels
@@ -208,14 +156,15 @@ bool readheader(FILE*& in,Item* items,int& ncol,
 	// lonitemno = guess at column number (1-based) containing longitude
 	// latitemno = guess at column number (1-based) containing latitude
 	// yearitemno = guess at column number (1-based) containing year or time step
-	// Returns false if too many items in file
+	// items and values are extended to the number of columns
+	// Returns false if file contains no data or too few columns
 	
 	xtring line,item;
 	int pos,i;
 	bool alphabetics=false;
 	ncol=0;
 	
-	while (!ncol && !feof(in)) {
+	while (!ncol && !in.eof()) {
 	
 		readfor(in,"a#",&line);
 		lineno++;
@@ -228,9 +177,9 @@ bool readheader(FILE*& in,Item* items,int& ncol,
 		while (pos!=-1) {
 			line=line.mid(pos);
 			pos=line.findoneof(" \t\r");
-			if (ncol>MAXITEM+2) {
-				printf("Too many columns (>%d) in %s\n",MAXITEM,(char*)filename);
-				return false;
+			if (ncol==(int)items.size()) {
+				items.resize(ncol+1);
+				values.resize(ncol+1);
 			}
 			if (pos>0) {
 				item=line.left(pos);
@@ -291,89 +240,137 @@ bool readheader(FILE*& in,Item* items,int& ncol,
 	return true;
 }
 
-bool readrecord(FILE*& in,Record& rec,int nitem,int lonitemno,int latitemno,int yearitemno,
-	Item* items,const char* sfmt,const char* dfmt,bool iffast,int& lineno,xtring& filename,bool ifyear) {
+bool readrecord(InputFile& in,double* dval,float& lon,float& lat,float& year,
+	int lonitemno,int latitemno,int yearitemno,ReadFormat& dfmt,int& lineno,bool ifyear) {
 
-	// Reads one record (row) in output file
+	// Reads one record (row) in output file into dval by the compiled format
+	// dfmt (used to preread the file before it is read through a ChunkedReader)
+	// Returns false on end of file or if the row could not be read
+	
+	dfmt.bind(0,dval);
+	if (!readfor(in,dfmt)) return false;
+	lineno++;
+	
+	lon=dval[lonitemno];
+	lat=dval[latitemno];
+	if (ifyear) year=dval[yearitemno];
+	else year=1;
+	
+	return true;
+}
+
+bool readrecord(ChunkedReader& rows,double* dval,float& lon,float& lat,float& year,
+	int nitem,int lonitemno,int latitemno,int yearitemno,
+	Item* items,bool iffast,int& lineno,xtring& filename,bool ifyear) {
+
+	// Reads one record (row) in output file into dval (nitem values)
 	// Returns false on end of file
 	// nitem = total number of items including lon, lat, year
 	// lonitemno = column number (0-based) containing longitude
 	// latitemno = column number (0-based) containing latitude
 	// yearitemno = column number (0-based) containing year or time step
 	
-	static xtring sval[MAXITEM]; // static to avoid reallocating in each call
-	xtring line,whole_line;
-	double dval[MAXITEM];
-	int i,places,digits,pos;
-	bool ifsign,searching=true,blank,isnum;
+	static vector<ScannedItem> sval; // static to avoid reallocating in each call
+	const char* pchar;
+	const char* pend;
+	const char* pstart;
+	int i,len;
+	bool searching=true,blank,isnum;
+
+	if ((int)sval.size()<nitem) sval.resize(nitem);
 
 	while (searching) {
 		if (!iffast) {
 		
-			if (!readfor(in,"a#",&whole_line)) return false;
-			if (feof(in)) return false;
-			line=whole_line;
+			if (!rows.nextrow()) return false;
+			
+			// As when reading line by line, a last line without a newline
+			// counts as the end of the file
+			
+			pchar=rows.rowtext(len);
+			pend=pchar+len;
+			if (pend==pchar || pend[-1]!='\n') return false;
+			pend--;
 			lineno++;
-			i=0;
 			
+			// Items are separated by blanks, tabs and carriage returns; each is
+			// tested, converted and scanned for its format in one go (items
+			// missing from a short line keep those of an earlier line)
+			
+			i=0;
 			blank=true;
 			isnum=true;
-			pos=line.findnotoneof(" \t\r");
-			while (pos!=-1 && i<nitem) {
-				line=line.mid(pos);
+			while (i<nitem) {
+				while (pchar<pend && (*pchar==' ' || *pchar=='\t' || *pchar=='\r')) pchar++;
+				if (pchar==pend) break;
 				blank=false;
-				pos=line.findoneof(" \t\r");
-				if (pos>0) {
-					sval[i]=line.left(pos);
-					line=line.mid(pos);
-					pos=line.findnotoneof(" \t\r");
-				}
-				else {
-					sval[i]=line;
-				}
-				if (!sval[i].isnum()) {
+				pstart=pchar;
+				while (pchar<pend && *pchar!=' ' && *pchar!='\t' && *pchar!='\r') pchar++;
+				scannumber(pstart,pchar-pstart,sval[i]);
+				if (!sval[i].isnum) {
 					isnum=false;
-					i=nitem;
+					break;
 				}
 				i++;
 			}
 
-			if (blank)
+			if (blank) {
 				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename);
+				runstats.rowsblank++;
+			}
 			else if (!isnum) {
 				printf("Line %d of %s contains non-numeric data - ignoring entire line\n",
 					lineno,(char*)filename);
+				runstats.rowsnonnumeric++;
 			}
 			else {
 				for (i=0;i<nitem;i++) {
-					if (scanitem(sval[i],places,digits,ifsign)) {
-						if (places>items[i].places) items[i].places=places;
-						if (digits>items[i].digits) items[i].digits=digits;
-						if (ifsign) items[i].ifsign=true;
+					if (sval[i].ifplain) {
+						if (sval[i].places>items[i].places) items[i].places=sval[i].places;
+						if (sval[i].digits>items[i].digits) items[i].digits=sval[i].digits;
+						if (sval[i].ifsign) items[i].ifsign=true;
 					}
 					else items[i].ifnum=false;
-					dval[i]=sval[i].num();
+					dval[i]=sval[i].value;
 					searching=false;
 				}
 			}
 		}
 		else {
-			if (!readfor(in,dfmt,dval)) return false;
+			if (!rows.nextrow() || !rows.rowok()) return false;
 			lineno++;
+			for (i=0;i<nitem;i++) dval[i]=rows.values()[i];
 			searching=false;
 		}
 		
-		rec.lon=dval[lonitemno];
-		rec.lat=dval[latitemno];
-		if (ifyear) rec.year=dval[yearitemno];
-		else rec.year=1;
-		for (i=0;i<nitem;i++) rec.val[i]=dval[i];
-		rec.nrec=1;
+		lon=dval[lonitemno];
+		lat=dval[latitemno];
+		if (ifyear) year=dval[yearitemno];
+		else year=1;
 	}
 	
 	return true;
 }
 
+bool readrecord(ColumnCache& cache,double* dval,float& lon,float& lat,float& year,
+	int nitem,int lonitemno,int latitemno,int yearitemno,bool ifyear) {
+
+	// Fetches the next record (row) from the binary cache of the input file
+	// Returns false after the last row
+	
+	int i;
+	
+	if (!cache.nextrow()) return false;
+	for (i=0;i<nitem;i++) dval[i]=cache.values()[i];
+	
+	lon=dval[lonitemno];
+	lat=dval[latitemno];
+	if (ifyear) year=dval[yearitemno];
+	else year=1;
+	
+	return true;
+}
+
 int year_number(float& year) {
 
 	// Returns index of specified guess year in array guessyear
@@ -394,6 +391,10 @@ bool finditem(xtring item,int& itemno,xtring infile,Item* items,int nitem) {
 	if (itemno) {
 		// taking data from specified column number - no header assumed
 		
+		if (itemno>nitem) {
+			printf("Column %d not found in %s (%d columns)\n",itemno,(char*)infile,nitem);
+			return false;
+		}
 		itemno--; // convert to 0-based
 	}
 	else {
@@ -490,12 +491,14 @@ bool estimate_pixsize(const vector<Point>& pixdata,double& pixx,double& pixy,dou
 	return true;
 }
 
-bool preread(FILE*& in,double dval[MAXITEM],bool ifvalues,int nitem,int lonitemno,
-	int latitemno,int yearitemno,Item* items,int& lineno,xtring& sfmt,xtring& dfmt,
+bool preread(InputFile& in,ColumnCache& cache,bool ifcached,
+	vector<double>& dval,bool ifvalues,int nitem,int lonitemno,
+	int latitemno,int yearitemno,int& lineno,ReadFormat& dfmt,
 	xtring filename,double& pixx,double& pixy,double& pixdx,double& pixdy,
 	bool havepixsize,bool havepixoffset,bool ifyear) {
 
-	Record rec;
+	vector<double> val(nitem);
+	float lon,lat,year;
 
 	vector<Point> pixdata;
 	Point thispix;
@@ -504,15 +507,16 @@ bool preread(FILE*& in,double dval[MAXITEM],bool ifvalues,int nitem,int lonitemn
 		pixdata.push_back(Point(dval[lonitemno], dval[latitemno]));
 	}
 		
-	while (!feof(in)) {
+	while (ifcached?!cache.eof():!in.eof()) {
 		
 		// Read next record in file
 		
-		if (readrecord(in,rec,nitem,lonitemno,latitemno,yearitemno,items,
-			sfmt,dfmt,true,lineno,filename,ifyear)) {
+		if (ifcached?readrecord(cache,&val[0],lon,lat,year,nitem,lonitemno,latitemno,yearitemno,ifyear):
+			readrecord(in,&val[0],lon,lat,year,lonitemno,latitemno,yearitemno,dfmt,lineno,
+			ifyear)) {
 			
-			thispix.x=rec.val[lonitemno];
-			thispix.y=rec.val[latitemno];
+			thispix.x=val[lonitemno];
+			thispix.y=val[latitemno];
 
 			add_point(pixdata,thispix);
 		}
@@ -550,35 +554,43 @@ bool preread(FILE*& in,double dval[MAXITEM],bool ifvalues,int nitem,int lonitemn
 
 
 bool readdata(xtring filename,float north,float south,float east,float west,
-	Item* items,int& nitem,int& lonitemno,int& latitemno,int& yearitemno,int& witemno,
-	xtring lonitem,xtring latitem,xtring yearitem,xtring witem,bool iffast,
+	vector<Item>& items,int& nitem,int& lonitemno,int& latitemno,int& yearitemno,int& witemno,
+	xtring lonitem,xtring latitem,xtring yearitem,xtring witem,bool iffast,bool ifcache,
 	double pixx,double pixy,double pixdx,double pixdy,
 	bool havepixsize,bool havepixoffset,bool ifweight,bool ifyear) {
 
-	int recno,i,index;
+	int index,i;
 	int autolonitem,autolatitem,autoyearitem;
-	double dval[MAXITEM];
+	vector<double> dval;
 	bool ifvalues,ifwitem;
 	int lineno=0,lineno_bak;
-	xtring sfmt,dfmt;
-	Record rec;
+	unsigned long datapos;
+	xtring fmt;
+	ReadFormat dfmt;
+	ChunkedReader rows;
+	ColumnCache cache;
+	bool ifcached=false;
+	float lon,lat,year;
+	double area;
 	
 	nyear=0;
 	
-	FILE* in=fopen(filename,"rt");
-	if (!in) {
+	InputFile in;
+	if (!in.open(filename)) {
 		printf("Could not open %s for input\n",(char*)filename);
 		return false;
 	}
 
 	// Read header and find columns containing lon, lat, year
+	runstats.setphase(RunStats::PHASE_HEADER);
 	if (!readheader(in,items,nitem,autolonitem,autolatitem,autoyearitem,
 		filename,dval,ifvalues,lineno)) {
 		return false;
 	}
+	runstats.setphase(RunStats::PHASE_READ);
 	
-	sfmt.printf("%da",nitem);
-	dfmt.printf("%df",nitem);
+	fmt.printf("%df",nitem);
+	dfmt.compile(fmt);
 	
 	if (lonitem=="" && lonitemno==0) lonitemno=autolonitem;
 	if (latitem=="" && latitemno==0) latitemno=autolatitem;
@@ -589,13 +601,13 @@ bool readdata(xtring filename,float north,float south,float east,float west,
 	}
 	else ifwitem=true;
 	
-	if (!finditem(lonitem,lonitemno,filename,items,nitem)) return false;
-	if (!finditem(latitem,latitemno,filename,items,nitem)) return false;
+	if (!finditem(lonitem,lonitemno,filename,&items[0],nitem)) return false;
+	if (!finditem(latitem,latitemno,filename,&items[0],nitem)) return false;
 	if (ifyear) {
-		if (!finditem(yearitem,yearitemno,filename,items,nitem)) return false;
+		if (!finditem(yearitem,yearitemno,filename,&items[0],nitem)) return false;
 	}
 	if (ifwitem) {
-		if (!finditem(witem,witemno,filename,items,nitem)) return false;
+		if (!finditem(witem,witemno,filename,&items[0],nitem)) return false;
 	}
 	
 	if (lonitemno==latitemno || ifyear && (lonitemno==yearitemno || latitemno==yearitemno)) {
@@ -623,18 +635,32 @@ bool readdata(xtring filename,float north,float south,float east,float west,
 		else printf(", %g N\n",north);
 	}
 	
+	// Remaining rows are fetched from the binary cache if there is one
+	
+	if (ifcache) ifcached=cache.open(filename) && cache.ncolumn()==nitem;
+	if (ifcached) {
+		for (i=0;i<nitem;i++) {
+			if (cache.places(i)>items[i].places) items[i].places=cache.places(i);
+			if (cache.digits(i)>items[i].digits) items[i].digits=cache.digits(i);
+			if (cache.ifsign(i)) items[i].ifsign=true;
+			if (!cache.ifnum(i)) items[i].ifnum=false;
+		}
+	}
+	
 	// Preread if necessary to determine pixel size and offset
 	
 	if ((!havepixsize || !havepixoffset) && ifweight) {
 	
 		lineno_bak=lineno;
+		datapos=in.tell();
 		
-		if (!preread(in,dval,ifvalues,nitem,lonitemno,latitemno,yearitemno,items,lineno,
-			sfmt,dfmt,filename,pixx,pixy,pixdx,pixdy,havepixsize,havepixoffset,ifyear))
+		if (!preread(in,cache,ifcached,dval,ifvalues,nitem,lonitemno,latitemno,yearitemno,
+			lineno,dfmt,filename,pixx,pixy,pixdx,pixdy,havepixsize,havepixoffset,
+			ifyear))
 				return false;
 		
-		rewind(in);
-		for (i=0;i<lineno_bak;i++) readfor(in,"");
+		if (ifcached) cache.rewind();
+		else in.seek(datapos);
 		lineno=lineno_bak;
 	}
 	
@@ -660,75 +686,81 @@ bool readdata(xtring filename,float north,float south,float east,float west,
 	
 	// Transfer data from first row (if all numbers)
 	
+	data.init(nitem);
+	guessyear.clear();
+	
 	if (ifvalues) {
+		runstats.rowsparsed++;
 		if (dval[lonitemno]>=west && dval[lonitemno]<=east && dval[latitemno]>=south &&
 			dval[latitemno]<=north) {
-			if (ifyear) data[nyear].year=dval[yearitemno];
-			else data[nyear].year=1;
-			if (ifwitem) data[nyear].area=dval[witemno];
-			else data[nyear].area=1.0;
-			if (ifweight) data[nyear].area*=
+			if (ifwitem) area=dval[witemno];
+			else area=1.0;
+			if (ifweight) area*=
 				pixelsize(dval[lonitemno]+pixdx,dval[latitemno]+pixdy,pixx,pixy,0);
-			data[nyear].nrec=1;
-			for (i=0;i<nitem;i++) data[nyear].val[i]=dval[i];
-			guessyear[nyear]=data[nyear].year;
+			data.set(data.addrow(),&dval[0],area);
+			if (ifyear) guessyear.push_back(dval[yearitemno]);
+			else guessyear.push_back(1);
 			nyear++;
 		}
 	}
 		
-	while (!feof(in)) {
+	if (!ifcached) {
+		if (iffast) fmt.printf("%df",nitem);
+		else fmt="";
+		if (!rows.open(in,fmt)) return false;
+	}
+	
+	while (ifcached?!cache.eof():!rows.eof()) {
 		
 		// Read next record in file
 		
-		if (readrecord(in,rec,nitem,lonitemno,latitemno,yearitemno,items,
-			sfmt,dfmt,iffast,lineno,filename,ifyear)) {
+		runstats.setphase(RunStats::PHASE_READ);
+		if (ifcached?readrecord(cache,&dval[0],lon,lat,year,nitem,lonitemno,latitemno,yearitemno,
+			ifyear):readrecord(rows,&dval[0],lon,lat,year,nitem,lonitemno,latitemno,yearitemno,
+			&items[0],iffast,lineno,filename,ifyear)) {
 		
-			if (rec.lon>=west && rec.lon<=east && rec.lat>=south && rec.lat<=north) {
+			runstats.rowsparsed++;
+			runstats.setphase(RunStats::PHASE_AGGREGATE);
+			if (lon>=west && lon<=east && lat>=south && lat<=north) {
 			
-				index=year_number(rec.year);
+				index=year_number(year);
 				if (index==-1) {
-				
-					if (nyear==MAXYEAR) {
-						printf("Too many time steps (>%d) in %s\n",
-							MAXYEAR,(char*)filename);
-						return false;
-					}
-				
-					data[nyear].year=rec.year;
-					index=nyear;
-					guessyear[nyear]=rec.year;
+					index=data.addrow();
+					guessyear.push_back(year);
 					nyear++;
 				}
 				
-				if (ifwitem) rec.area=rec.val[witemno];
-				else rec.area=1.0;
-				if (ifweight) rec.area*=pixelsize(rec.val[lonitemno]+pixdx,rec.val[latitemno]+pixdy,
+				if (ifwitem) area=dval[witemno];
+				else area=1.0;
+				if (ifweight) area*=pixelsize(dval[lonitemno]+pixdx,dval[latitemno]+pixdy,
 						pixx,pixy,0);
-				data[index].add_record(rec);
+				data.add(index,&dval[0],area);
 			}
 		}
 	}
 	
 	// Now calculate averages for timeslice
 	
-	for (i=0;i<nyear;i++) {
-		data[i].average();
-		if (!i) printf("\nWeight for %g is %g\n",data[i].year,data[i].area);
-	}
+	runstats.setphase(RunStats::PHASE_AGGREGATE);
+	data.average();
+	if (nyear) printf("\nWeight for %g is %g\n",guessyear[0],data.weight(0));
 	
-	fclose(in);
+	rows.close();
+	in.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	return true;
 }
 
-bool writedata(xtring filename,Item* items,int& nitem,int lonitemno,int latitemno,
+bool writedata(xtring filename,vector<Item>& items,int& nitem,int lonitemno,int latitemno,
 	int yearitemno,int witemno,int nrec,char* sep,bool ifyear,bool ifsum) {
 	
 	int i,j;
 	bool first;
 	
-	FILE* out=fopen(filename,"wt");
-	if (!out) {
+	runstats.setphase(RunStats::PHASE_FORMAT);
+	OutputFile out;
+	if (!out.open(filename)) {
 		printf("Could not open %s for output\n",(char*)filename);
 		return false;
 	}
@@ -738,7 +770,7 @@ bool writedata(xtring filename,Item* items,int& nitem,int lonitemno,int latitemn
 	first=true;
 	if (ifyear) {
 		items[yearitemno].compute_fmt();
-		fprintf(out,items[yearitemno].lfmt,(char*)items[yearitemno].label);
+		out.printf(items[yearitemno].lfmt,(char*)items[yearitemno].label);
 		first=false;
 	}
 
@@ -752,12 +784,12 @@ bool writedata(xtring filename,Item* items,int& nitem,int lonitemno,int latitemn
 			}
 
 			items[i].compute_fmt();
-			if (!first) fprintf(out,sep);
-			fprintf(out,items[i].lfmt,(char*)items[i].label);
+			if (!first) out.put(sep);
+			out.printf(items[i].lfmt,(char*)items[i].label);
 			first=false;
 		}
 	}
-	fprintf(out,"\n");
+	out.put('\n');
 
 	// Print data
 
@@ -765,26 +797,27 @@ bool writedata(xtring filename,Item* items,int& nitem,int lonitemno,int latitemn
 
 		first=true;	
 		if (ifyear) {
-			fprintf(out,items[yearitemno].fmt,(double)data[i].year);
+			out.put((double)guessyear[i],items[yearitemno].nfmt);
 			first=false;
 		}
 		
 		for (j=0;j<nitem;j++) {
 			if (j!=lonitemno && j!=latitemno && (!ifyear || j!=yearitemno) && j!=witemno) {
-				if (!first) fprintf(out,sep);
+				if (!first) out.put(sep);
 				if(ifsum){
-				  fprintf(out,items[j].fmt,(double)data[i].val[j]*(double)data[i].area);
+				  out.put(data(i,j)*data.weight(i),items[j].nfmt);
 				}
 				else{
-				  fprintf(out,items[j].fmt,(double)data[i].val[j]);
+				  out.put(data(i,j),items[j].nfmt);
 				}
 				first=false;
 			}
 		}
-		fprintf(out,"\n");
+		out.put('\n');
 	}
 	
-	fclose(out);
+	out.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	return true;
 }
@@ -853,6 +886,11 @@ void helptext(FILE* out,xtring exe) {
 	fprintf(out,"-sum\n");
 	fprintf(out,"    Provide areal sum of values instead of average\n");
 	fprintf(out,"    Requires data expressed per m2\n");
+	fprintf(out,"-cache\n");
+	fprintf(out,"    Read data rows from a binary cache of the input file (<input-file>.gbin),\n");
+	fprintf(out,"    which is created or brought up to date by parsing the input file if necessary\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
 	fprintf(out,"-help\n");
 	fprintf(out,"    Displays this help message\n");
 }
@@ -887,6 +925,8 @@ void abort(xtring exe) {
 	printf("         -x <lon> <lat> | <west> <south> <east> <north>\n");
 	printf("         -tab\n");
 	printf("         -sum\n");
+	printf("         -cache\n");
+	printf("         -stats\n");
 	printf("         -help\n");
 	
 	exit(99);
@@ -899,13 +939,14 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 	bool& havepixsize,bool& havepixoffset,
 	double& north,double& south,double& east,double& west,
 	float& fromyear,float& toyear,bool& iffrom,bool& ifto,
-	xtring& sep,bool& iffast,bool& ifweight,bool& ifyear,bool& ifsum) {
+	xtring& sep,bool& iffast,bool& ifcache,bool& ifweight,bool& ifyear,bool& ifsum) {
 
 	int i,j,nval;
 	xtring arg,thisarg;
 	bool haveinfile=false,slut,havewindow=false;
 	iffrom=false,ifto=false;
 	iffast=false;
+	ifcache=false;
 	ifyear=true;
 	ifsum=false;
 	double dval;
@@ -945,10 +986,6 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 						dval=lonitem.num();
 						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 							lonitemno=dval;
-							if (lonitemno>MAXITEM) {
-								printf("Option -lon: too many items (maximum allowed is %d)\n",MAXITEM);
-								return false;
-							}
 							lonitem="";
 						}
 					}
@@ -966,10 +1003,6 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 						dval=latitem.num();
 						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 							latitemno=dval;
-							if (latitemno>MAXITEM) {
-								printf("Option -lat: too many items (maximum allowed is %d)\n",MAXITEM);
-								return false;
-							}
 							latitem="";
 						}
 					}
@@ -987,10 +1020,6 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 						dval=yearitem.num();
 						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 							yearitemno=dval;
-							if (yearitemno>MAXITEM) {
-								printf("Option -y: too many items (maximum allowed is %d)\n",MAXITEM);
-								return false;
-							}
 							yearitem="";
 						}
 					}
@@ -1008,10 +1037,6 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 						dval=witem.num();
 						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 							witemno=dval;
-							if (witemno>MAXITEM) {
-								printf("Option -w: too many items (maximum allowed is %d)\n",MAXITEM);
-								return false;
-							}
 							witem="";
 						}
 					}
@@ -1135,6 +1160,8 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 			else if (arg=="-n") { // suppress time step data
 				ifyear=false;
 			}
+			else if (arg=="-cache") ifcache=true;
+			else if (arg=="-stats") runstats.enable();
 			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
 			else if (arg="-sum") { 
 				ifsum=true;
@@ -1200,8 +1227,8 @@ int main(int argc,char* argv[]) {
 	double north,south,east,west;
 	double pixx,pixy,pixdx,pixdy;
 	bool havepixsize,havepixoffset;
-	bool iffrom,ifto,iffast,ifweight,ifyear;
-	Item items[MAXITEM];
+	bool iffrom,ifto,iffast,ifcache,ifweight,ifyear;
+	vector<Item> items;
 	int nitem;
 	xtring sep;
 	bool ifsum;
@@ -1211,7 +1238,7 @@ int main(int argc,char* argv[]) {
 		pixx,pixy,pixdx,pixdy,
 		havepixsize,havepixoffset,
 		north,south,east,west,
-		fromyear,toyear,iffrom,ifto,sep,iffast,ifweight,ifyear,ifsum))
+		fromyear,toyear,iffrom,ifto,sep,iffast,ifcache,ifweight,ifyear,ifsum))
 			abort(argv[0]);
 
 	unixtime(header);
@@ -1219,7 +1246,7 @@ int main(int argc,char* argv[]) {
 	printf("%s",(char*)header);
 
 	if (readdata(infile,north,south,east,west,items,nitem,
-		lonitemno,latitemno,yearitemno,witemno,lonitem,latitem,yearitem,witem,false,
+		lonitemno,latitemno,yearitemno,witemno,lonitem,latitem,yearitem,witem,false,ifcache,
 		pixx,pixy,pixdx,pixdy,havepixsize,havepixoffset,ifweight,ifyear)) {
 	
 		if (writedata(outfile,items,nitem,lonitemno,latitemno,yearitemno,witemno,nyear,sep,ifyear,ifsum)) {
@@ -1228,5 +1255,6 @@ int main(int argc,char* argv[]) {
 		}
 	} 
 	
+	runstats.print("aslice");
 	return 0;
 }
@@ -5,6 +5,7 @@
 #include <gutil.h> // Ben's input/output utility
 #include <math.h> 
 #include <map>
+#include <vector>
 #include <string>
 #include <sstream>
 #include <stdexcept>
@@ -45,15 +46,25 @@ int toint(const string& str) {
 */
 bool handleargs(int argc, char** argv) {
 	map<string, string> options;
+	std::vector<string> args;
+
+	// -stats is the only option without a value, so take it out first
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "-stats") {
+			runstats.enable();
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
 
-	if (argc != 11) {
+	if (args.size() != 10) {
 		return false;
 	}
 
 	// Go through the args two at a time, handling each option/value pair
-	for (int i = 1; i < argc; i+=2) {
-		string option(argv[i]);
-		string value(argv[i+1]);
+	for (size_t i = 0; i < args.size(); i+=2) {
+		string option(args[i]);
+		string value(args[i+1]);
 
 		if (option[0] != '-') {
 			// Not a proper option
@@ -118,6 +129,8 @@ void printusage() {
 	       "\tDefines the end year for which the balance is calculated\n"\
 	       "-matter <type>\n"\
 	       "\tThe type of matter (e.g. C or N), only used for descriptive purposes\n"\
+	       "-stats\n"\
+	       "\tWrite timings and throughput counters to stderr (as JSON) on completion\n"\
 	       "\n"\
 	       "The input files are expected to be text files with exactly four columns,\n"\
 	       "longitude, latitude, year and a value column. The value column should\n"\
@@ -193,19 +206,19 @@ int main(int argc, char** argv) {
 	string balance_total_file = type_of_matter + "balance_totalerror_Gt" + type_of_matter + ".txt";
 
 
-	FILE * in_pool = fopen(pool_path.c_str(),"rt"); // rt = read text
-	FILE * in_flux = fopen(flux_path.c_str(),"rt"); // rt = read text
+	InputFile in_pool;
+	InputFile in_flux;
 	
 	FILE * out_balance_cell = fopen(balance_cell_file.c_str(),"wt"); // wt = write text
 	FILE * out_balance_total = fopen(balance_total_file.c_str(),"wt"); // wt = write text
 	
 
-	if(!in_pool) {
+	if(!in_pool.open(pool_path.c_str())) {
 		printf("Could not open input\n");
 		return 1;
 	}
 
-	if(!in_flux) {
+	if(!in_flux.open(flux_path.c_str())) {
 		printf("Could not open input\n");
 		return 1;
 	}
@@ -223,8 +236,10 @@ int main(int argc, char** argv) {
 
 	xtring pool_header,flux_header; // For reading in first column headings
 
+	runstats.setphase(RunStats::PHASE_HEADER);
 	readfor(in_pool,"a#",&pool_header);
 	readfor(in_flux,"a#",&flux_header);
+	runstats.setphase(RunStats::PHASE_READ);
 
 	string inputstr = "f,f,i,f";
 
@@ -239,7 +254,7 @@ int main(int argc, char** argv) {
 	double cell_pool_start, cell_pool_end;
 	double cell_flux;
 
-	while (!feof(in_pool) && !feof(in_flux)) {
+	while (!in_pool.eof() && !in_flux.eof()) {
 
 		double lon_pool, lat_pool;
 		double lon_flux, lat_flux;
@@ -253,6 +268,7 @@ int main(int argc, char** argv) {
 		    !readfor(in_flux,inputstr.c_str(),&lon_flux,&lat_flux,&year_flux,&flux_value)) {
 			end_of_input = true;
 		}
+		else runstats.rowsparsed+=2;
 
 		if (!end_of_input && 
 		    (lon_pool != lon_flux ||
@@ -331,11 +347,14 @@ int main(int argc, char** argv) {
 
 
 	// Close files
-	fclose(in_pool);
-	fclose(in_flux);
+	in_pool.close();
+	in_flux.close();
 
+	runstats.setphase(RunStats::PHASE_NONE);
+	runstats.byteswritten+=ftell(out_balance_cell)+ftell(out_balance_total);
 	fclose(out_balance_cell);
 	fclose(out_balance_total);
 
+	runstats.print("balance");
 	return 0;
 }
@@ -5,6 +5,7 @@
 #include <gutil.h> // Ben's input/output utility
 #include <math.h> 
 #include <map>
+#include <vector>
 #include <string>
 #include <sstream>
 #include <stdexcept>
@@ -65,15 +66,25 @@ int toint(const string& str) {
 */
 bool handleargs(int argc, char** argv) {
 	map<string, string> options;
+	std::vector<string> args;
+
+	// -stats is the only option without a value, so take it out first
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "-stats") {
+			runstats.enable();
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
 
-	if (argc != 11) {
+	if (args.size() != 10) {
 		return false;
 	}
 
 	// Go through the args two at a time, handling each option/value pair
-	for (int i = 1; i < argc; i+=2) {
-		string option(argv[i]);
-		string value(argv[i+1]);
+	for (size_t i = 0; i < args.size(); i+=2) {
+		string option(args[i]);
+		string value(args[i+1]);
 
 		if (option[0] != '-') {
 			// Not a proper option
@@ -125,7 +136,7 @@ bool handleargs(int argc, char** argv) {
 // Gives the user instructions on how to run the program
 void printusage() {
 	printf("Usage:\ncbalance -spinup <years> -ncells <number_of_cells>\n");
-	printf("\t-path <directory> -start <year> -end <year>\n");
+	printf("\t-path <directory> -start <year> -end <year> [-stats]\n");
 }
 
 // calculates grazed area per continent
@@ -189,19 +200,19 @@ int main(int argc, char** argv) {
 	string cbalance_total_file = basedir + "cbalance_totalerror_GtC.txt";
 
 
-	FILE * in_cpool = fopen(cpool_file.c_str(),"rt"); // rt = read text
-	FILE * in_cflux = fopen(cflux_file.c_str(),"rt"); // rt = read text
+	InputFile in_cpool;
+	InputFile in_cflux;
 	
 	FILE * out_cbalance_cell = fopen(cbalance_cell_file.c_str(),"wt"); // wt = write text
 	FILE * out_cbalance_total = fopen(cbalance_total_file.c_str(),"wt"); // wt = write text
 	
 
-	if(!in_cpool) {
+	if(!in_cpool.open(cpool_file.c_str())) {
 		printf("Could not open input\n");
 		return 1;
 	}
 
-	if(!in_cflux) {
+	if(!in_cflux.open(cflux_file.c_str())) {
 		printf("Could not open input\n");
 		return 1;
 	}
@@ -220,8 +231,10 @@ int main(int argc, char** argv) {
 
 	xtring cpool_header,cflux_header; // For reading in first column headings
 
+	runstats.setphase(RunStats::PHASE_HEADER);
 	readfor(in_cpool,"a#",&cpool_header);
 	readfor(in_cflux,"a#",&cflux_header);
+	runstats.setphase(RunStats::PHASE_READ);
 
 	int cpool_columns, cflux_columns;
 	int total_column, nee_column;
@@ -250,6 +263,27 @@ int main(int argc, char** argv) {
 	cpool_inputstr.printf("f,f,f,%df", cpool_columns-3);
 	cflux_inputstr.printf("f,f,f,%df", cflux_columns-3);
 
+	// Only lon, lat, year and the Total or NEE column need to be converted,
+	// the other columns are skipped
+	bool* cpool_need = new bool[cpool_columns];
+	bool* cflux_need = new bool[cflux_columns];
+	for (int i = 0; i < cpool_columns; i++) cpool_need[i] = i < 3 || i == total_column+3;
+	for (int i = 0; i < cflux_columns; i++) cflux_need[i] = i < 3 || i == nee_column+3;
+
+	ReadFormat cpool_format, cflux_format;
+	cpool_format.compile((char*)cpool_inputstr);
+	cpool_format.project(cpool_columns, cpool_need);
+	cpool_format.bind(0, &lon);
+	cpool_format.bind(1, &lat);
+	cpool_format.bind(2, &year);
+	cpool_format.bind(3, cpool_data);
+	cflux_format.compile((char*)cflux_inputstr);
+	cflux_format.project(cflux_columns, cflux_need);
+	cflux_format.bind(0, &lon);
+	cflux_format.bind(1, &lat);
+	cflux_format.bind(2, &year);
+	cflux_format.bind(3, cflux_data);
+
 	// Header in cell C balance file
 	fprintf(out_cbalance_cell,"%10s%10s%20s%20s\n","lon","lat","absCdiff_kgCm-2","error_kgC");
 	fprintf(out_cbalance_total,"%12s%12s%12s\n","cpool_GtC","cflux_GtC","absdiff_GtC");
@@ -273,7 +307,7 @@ int main(int argc, char** argv) {
 		for (int yr = start_year; yr <= end_year; yr++) {
 			
 			// CPOOL
-			readfor(in_cpool,(char*)cpool_inputstr,&lon,&lat,&year,cpool_data);
+			readfor(in_cpool,cpool_format);
 			
 			// start year
 			if (int(year) == start_year) {
@@ -289,7 +323,8 @@ int main(int argc, char** argv) {
 
 			
 			// CFLUX
-			readfor(in_cflux,(char*)cflux_inputstr,&lon,&lat,&year,cflux_data);
+			readfor(in_cflux,cflux_format);
+			runstats.rowsparsed+=2;
 
 			if (int(year) == start_year)
 				cell_cflux = 0.0;
@@ -316,17 +351,22 @@ int main(int argc, char** argv) {
 
 	delete[] cpool_data;
 	delete[] cflux_data;
+	delete[] cpool_need;
+	delete[] cflux_need;
 
 	// TOTAL error in the C balance (GtC)
 	fprintf(out_cbalance_total,"%12.6f%12.6f%12.6f\n",uptake_cpool,uptake_cflux,absCdiff);
 
 
 	// Close files
-	fclose(in_cpool);
-	fclose(in_cflux);
+	in_cpool.close();
+	in_cflux.close();
 
+	runstats.setphase(RunStats::PHASE_NONE);
+	runstats.byteswritten+=ftell(out_cbalance_cell)+ftell(out_cbalance_total);
 	fclose(out_cbalance_cell);
 	fclose(out_cbalance_total);
 
+	runstats.print("cbalance");
 	return 0;
 }
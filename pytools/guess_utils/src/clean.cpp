@@ -77,6 +77,7 @@ class Item {
 
 public:
 	xtring label,fmt,lfmt;
+	NumberFormat nfmt;
 	bool ifnum;
 	bool ifsign;
 	bool ifalpha;
@@ -111,11 +112,14 @@ public:
 		
 		if (label.len()>w) w=label.len();
 		
-		if (ifnum)
+		if (ifnum) {
 			fmt.printf("%%%d.%df",w,places);
+			nfmt.setfixed(w,places);
+		}
 		else {
 			if (w<8) w=8;
 			fmt.printf("%%%dg",w);
+			nfmt.setgeneral(w);
 		}
 		
 		lfmt.printf("%%%ds",w);
@@ -162,7 +166,7 @@ bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
 }
 
 
-bool readheader(FILE*& in,Item* items,int& ncol,xtring filename,
+bool readheader(InputFile& in,Item* items,int& ncol,xtring filename,
 	double values[MAXITEM],bool& ifvalues,int& lineno,bool& ifdos) {
 
 	// Reads header row of an LPJ-GUESS output file
@@ -177,7 +181,7 @@ bool readheader(FILE*& in,Item* items,int& ncol,xtring filename,
 	ifdos=false;
 	const int MAXLEN=63;
 	
-	while (!ncol && !feof(in)) {
+	while (!ncol && !in.eof()) {
 	
 		readfor(in,"a#",&line);
 		lineno++;
@@ -235,9 +239,9 @@ bool readheader(FILE*& in,Item* items,int& ncol,xtring filename,
 	return true;
 }
 
-bool readrecord(FILE*& in,FILE*& out,Record& rec,int nitem,Item* items,
+bool readrecord(InputFile& in,FILE*& out,Record& rec,int nitem,Item* items,
 	xtring sfmt,xtring dfmt,int& nrec,int& lineno,xtring& filename,
-	int& nblank,int& nirreg,int& nalpha,xtring& fmt,bool& ifdos,int noutitem) {
+	int& nblank,int& nirreg,int& nalpha,ReadFormat& fmt,bool& ifdos,int noutitem) {
 
 	// Reads one record (row) in output file
 	// Returns false on end of file
@@ -256,7 +260,8 @@ bool readrecord(FILE*& in,FILE*& out,Record& rec,int nitem,Item* items,
 		m=0;
 		validitems=0;
 		isnum=true;
-		if (!readfor(in,fmt,&s)) return false;
+		fmt.bind(0,s);
+		if (!readfor(in,fmt)) return false;
 		while (s[n]!="" && n<MAXITEM) {
 			if (s[n].find("\r")!=-1) {
 				ifdos=true;
@@ -386,7 +391,7 @@ bool tagitems(xtring filename,Item* items,int nitem,xtring exclude[MAXITEM],
 	return true;
 }
 
-bool writerec(FILE*& out,Item* items,int nitem,Record& rec,char* sep) {
+bool writerec(OutputFile& out,Item* items,int nitem,Record& rec,char* sep) {
 	
 	int i,j;
 	bool first,valid;
@@ -409,13 +414,13 @@ bool writerec(FILE*& out,Item* items,int nitem,Record& rec,char* sep) {
 		first=true;
 		for (j=0;j<nitem;j++) {
 			if (!items[j].exclude) {
-				if (!first) fprintf(out,sep);
-				fprintf(out,items[j].fmt,(double)rec.val[j]);
+				if (!first) out.put(sep);
+				out.put((double)rec.val[j],items[j].nfmt);
 				first=false;
 			}
 		}
 		
-		fprintf(out,"\n");
+		out.put('\n');
 	}
 	
 	return true;
@@ -428,24 +433,24 @@ bool readdata(FILE*& outlog,xtring filename,xtring outfile,Item* items,int& nite
 	xtring exclude[MAXITEM],int excludeno[MAXITEM],int nexclude,int& noutitem,xtring sep,
 	xtring* header,int nheader) {
 
-	FILE* out;
+	OutputFile out;
 	int recno,i,j;
 	double dval[MAXITEM];
 	bool ifvalues,first,incl;
 	int lineno=0;
-	xtring sfmt,dfmt,rfmt,banner;
+	xtring sfmt,dfmt,fmt,banner;
+	ReadFormat rfmt;
 	Record thisrec;
 	nrec=0;
 	
-	FILE* in=fopen(filename,"rt");
-	if (!in) {
+	InputFile in;
+	if (!in.open(filename)) {
 		printf("Could not open %s for input\n",(char*)filename);
 		return false;
 	}
 	
 	if (ifwriting) {
-		out=fopen(outfile,"wt");
-		if (!out) {
+		if (!out.open(outfile)) {
 			printf("Could not open %s for output\n",(char*)outfile);
 			return false;
 		}
@@ -455,12 +460,12 @@ bool readdata(FILE*& outlog,xtring filename,xtring outfile,Item* items,int& nite
 		first=true;
 		for (i=0;i<nitem;i++) {
 			if (!items[i].exclude) {
-				if (!first) fprintf(out,(char*)sep);
-				fprintf(out,items[i].lfmt,(char*)items[i].label);
+				if (!first) out.put(sep);
+				out.printf(items[i].lfmt,(char*)items[i].label);
 				first=false;
 			}
 		}
-		fprintf(out,"\n");
+		out.put('\n');
 	}
 
 	unixtime(banner);
@@ -468,9 +473,11 @@ bool readdata(FILE*& outlog,xtring filename,xtring outfile,Item* items,int& nite
 	if (outlog) fprintf(outlog,"In %s on %s:\n",(char*)filename,(char*)banner);
 	
 	// Read header
+	runstats.setphase(RunStats::PHASE_HEADER);
 	if (!readheader(in,items,nitem,filename,dval,ifvalues,lineno,ifdos)) {
 		return false;
 	}
+	runstats.setphase(RunStats::PHASE_READ);
 	
 	if (ifvalues) {
 		for (i=0;i<MAXITEM;i++) {
@@ -505,7 +512,8 @@ bool readdata(FILE*& outlog,xtring filename,xtring outfile,Item* items,int& nite
 	
 	sfmt.printf("%da",nitem);
 	dfmt.printf("%df",nitem);
-	rfmt.printf("%da",MAXITEM);
+	fmt.printf("%da",MAXITEM);
+	rfmt.compile(fmt);
 	
 	nblank=lineno-1;
 	if (nblank && outlog) fprintf(outlog,"Lines 1-%d are blank (ignoring)\n",nblank);
@@ -533,22 +541,28 @@ bool readdata(FILE*& outlog,xtring filename,xtring outfile,Item* items,int& nite
 	}
 	else ifheader=true;
 		
-	while (!feof(in)) {
+	while (!in.eof()) {
 		
 		// Read next record in file
 		
+		runstats.setphase(RunStats::PHASE_READ);
 		if (readrecord(in,outlog,thisrec,nitem,items,sfmt,dfmt,nrec,lineno,filename,
 			nblank,nirreg,nalpha,rfmt,ifdos,noutitem)) {
 			
-			if (ifwriting)
+			if (ifwriting) {
+				runstats.setphase(RunStats::PHASE_FORMAT);
 				writerec(out,items,nitem,thisrec,sep);
-			else
+			}
+			else {
+				runstats.setphase(RunStats::PHASE_AGGREGATE);
 				sumrec.add_record(thisrec);
+			}
 		}
 	}
 	
 	// Now calculate averages for timeslice
 	
+	runstats.setphase(RunStats::PHASE_AGGREGATE);
 	sumrec.average();
 	
 	for (i=0;i<nitem;i++) {
@@ -556,13 +570,14 @@ bool readdata(FILE*& outlog,xtring filename,xtring outfile,Item* items,int& nite
 		items[i].compute_fmt();
 	}
 	
-	fclose(in);
+	in.close();
 	
 	if (ifwriting) {
 	
 		printf("\n");
-		fclose(out);
+		out.close();
 	}
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	return true;
 }
@@ -708,6 +723,8 @@ void helptext(FILE* out,xtring exe) {
 	fprintf(out,"    Item labels for inclusion in header of clean output file. Number of labels\n");
 	fprintf(out,"    should equal number of columns in cleaned output file, taking into account\n");
 	fprintf(out,"    items excluded with -x\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
 	fprintf(out,"-help\n");
 	fprintf(out,"    Displays this help message\n");
 }
@@ -735,6 +752,7 @@ void abort(xtring exe) {
 	printf("         -tab\n");
 	printf("         -x <item-name> | <column-number> { <item-name> | <column-number> }\n");
 	printf("         -h <item-name> { <item-name> }\n");
+	printf("         -stats\n");
 	printf("         -help\n");
 
 	exit(99);
@@ -829,6 +847,7 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 			else if (arg=="-n") {
 				ifoutput=false;
 			}
+			else if (arg=="-stats") runstats.enable();
 			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
 			else {
 				printf("Invalid option %s\n",(char*)arg);
@@ -905,6 +924,10 @@ int main(int argc,char* argv[]) {
 	if (readdata(outlog,infile,outfile,items,nitem,nrec,rec,nblank,nirreg,nalpha,ifheader,
 		iflog,ifdos,false,exclude,excludeno,nexclude,noutitem,sep,header,nheader)) {
 
+		runstats.rowsparsed=nrec;
+		runstats.rowsblank=nblank;
+		runstats.rowsnonnumeric=nalpha;
+
 		printstats(stdout,infile,items,rec,nitem,nrec,nblank,nirreg,nalpha,
 			ifheader,iflog,ifdos,noutitem);
 		if (iflog) {
@@ -924,5 +947,6 @@ int main(int argc,char* argv[]) {
 		}
 	}
 	
+	runstats.print("clean");
 	return 0;
 }
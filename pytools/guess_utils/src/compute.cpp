@@ -628,6 +628,7 @@ class Item {
 
 public:
 	xtring label,fmt,lfmt;
+	NumberFormat nfmt;
 	
 	// Used for new items
 	xtring expression;
@@ -661,15 +662,20 @@ public:
 		
 		if (label.len()>w) w=label.len();
 		
-		if (ifnum)
+		if (ifnum) {
 			fmt.printf("%%%d.%df",w,places);
-		else fmt.printf("%%%dg",w);
+			nfmt.setfixed(w,places);
+		}
+		else {
+			fmt.printf("%%%dg",w);
+			nfmt.setgeneral(w);
+		}
 		
 		lfmt.printf("%%%ds",w);
 	}
 };
 
-bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
+bool scanitem(const char* text,int& places,int& digits,bool& ifsign) {
 
 	places=0;
 	digits=0;
@@ -701,7 +707,7 @@ bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
 }
 
 
-bool readheader(FILE*& in,xtring& whole_line,Item* items,int& ncol,
+bool readheader(InputFile& in,xtring& whole_line,Item* items,int& ncol,
 	xtring filename,
 	double values[MAXITEM],bool& ifvalues,int& lineno) {
 
@@ -715,7 +721,7 @@ bool readheader(FILE*& in,xtring& whole_line,Item* items,int& ncol,
 	bool alphabetics=false;
 	ncol=0;
 	
-	while (!ncol && !feof(in)) {
+	while (!ncol && !in.eof()) {
 	
 		readfor(in,"a#",&whole_line);
 		line=whole_line;
@@ -769,75 +775,105 @@ bool readheader(FILE*& in,xtring& whole_line,Item* items,int& ncol,
 	return true;
 }
 
-bool readrecord(FILE*& in,xtring& whole_line,double* dval,int nitem,Item* items,
-	int& lineno,xtring& filename,bool iffast,bool warn) {
+bool readrecord(InputFile& in,xtring& whole_line,double* dval,int nitem,Item* items,
+	int& lineno,xtring& filename,bool iffast,bool warn,const bool* need) {
 
 	// Reads one record (row) in output file
 	// Returns false on end of file
 	// nitem = total number of items
+	// need = which items to convert (NULL for all); other items are skipped
+	//        without being checked or converted, and dval is not set for them
 	
-	xtring sval[MAXITEM],line;
-	int i,places,digits,pos;
-	bool ifsign,searching=true,blank,isnum;
+	static ScannedItem sval[MAXITEM]; // static to avoid reallocating in each call
+	const char* field[MAXITEM];
+	int fieldlen[MAXITEM];
+	const char* pchar;
+	int i,nfield;
+	bool searching=true,blank,isnum;
 
 	while (searching) {
 	
 		if (!readfor(in,"a#",&whole_line)) return false;
-		if (feof(in)) return false;
-		line=whole_line;
+		if (in.eof()) return false;
 		lineno++;
-		i=0;
 		
-		blank=true;
+		// Locate the fields with a scan for delimiters
+
+		pchar=whole_line;
+		nfield=0;
+		while (nfield<nitem) {
+			while (*pchar==' ' || *pchar=='\t' || *pchar=='\r') pchar++;
+			if (!*pchar) break;
+			field[nfield]=pchar;
+			while (*pchar && *pchar!=' ' && *pchar!='\t' && *pchar!='\r') pchar++;
+			fieldlen[nfield]=pchar-field[nfield];
+			nfield++;
+		}
+		
+		// Test, convert and scan for format the fields needed, in one go
+		
+		blank=!nfield;
 		isnum=true;
-		pos=line.findnotoneof(" \t\r");
-		while (pos!=-1 && i<nitem) {
-			line=line.mid(pos);
-			blank=false;
-			pos=line.findoneof(" \t\r");
-			if (pos>0) {
-				sval[i]=line.left(pos);
-				line=line.mid(pos);
-				pos=line.findnotoneof(" \t\r");
-			}
-			else {
-				sval[i]=line;
-			}
-			if (!sval[i].isnum()) {
-				isnum=false;
-				i=nitem;
+		for (i=0;i<nitem && isnum;i++) {
+			if (!need || need[i]) {
+				if (i<nfield) {
+					scannumber(field[i],fieldlen[i],sval[i]);
+					dval[i]=sval[i].value;
+					if (!sval[i].isnum) isnum=false;
+				}
+				else dval[i]=0.0;
 			}
-			i++;
 		}
 		
 		if (blank) {
-			if (warn)
-				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename,feof(in));
+			if (warn) {
+				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename,in.eof());
+				runstats.rowsblank++;
+			}
 		}
 		else if (!isnum) {
-			if (warn)
+			if (warn) {
 				printf("Line %d of %s contains non-numeric data - ignoring entire line\n",
 					lineno,(char*)filename);
+				runstats.rowsnonnumeric++;
+			}
 		}
 		else {
-			for (i=0;i<nitem;i++) {
-				dval[i]=sval[i].num();
-				if (!iffast) {
-					if (scanitem(sval[i],places,digits,ifsign)) {
-						if (places>items[i].places) items[i].places=places;
-						if (digits>items[i].digits) items[i].digits=digits;
-						if (ifsign) items[i].ifsign=true;
+			if (!iffast) {
+				for (i=0;i<nfield;i++) {
+					if (!need || need[i]) {
+						if (sval[i].ifplain) {
+							if (sval[i].places>items[i].places) items[i].places=sval[i].places;
+							if (sval[i].digits>items[i].digits) items[i].digits=sval[i].digits;
+							if (sval[i].ifsign) items[i].ifsign=true;
+						}
+						else items[i].ifnum=false;
 					}
-					else items[i].ifnum=false;
 				}
-				searching=false;
 			}
+			searching=false;
 		}
 	}
 	
 	return true;
 }
 
+bool readrecord(ColumnCache& cache,double* dval,int ncol,int nitem) {
+
+	// Fetches the next record (row) from the binary cache of the input file
+	// Returns false after the last row
+	// ncol = number of items read from the file
+	// nitem = total number of items (computed items are set to zero)
+	
+	int i;
+	
+	if (!cache.nextrow()) return false;
+	for (i=0;i<ncol;i++) dval[i]=cache.values()[i];
+	for (;i<nitem;i++) dval[i]=0.0;
+	
+	return true;
+}
+
 bool finditem(xtring item,int& itemno,xtring infile,Item* items,int nitem) {
 
 	int i;
@@ -1029,35 +1065,57 @@ bool parse_outitems(Item* items,int& nitem,xtring* outitem,int noutitem,xtring i
 }
 
 
+void keeprow(RowBuffer& kept,const double* dval,Item* items,int nitem) {
+
+	// Keeps the values of the items to be written (in slow mode, for writing
+	// once the formats of all items are known)
+	
+	double outval[MAXITEM];
+	int i,n=0;
+	
+	for (i=0;i<nitem;i++)
+		if (items[i].include) outval[n++]=dval[i];
+	kept.add(outval);
+}
+
 bool readdata(xtring infile,xtring outfile,Item* items,int& nitem,int& nrec,
-	bool iffast,xtring sep,xtring* outitem,int noutitem,bool includeall) {
+	bool iffast,bool iffull,bool ifcache,xtring sep,xtring* outitem,int noutitem,bool includeall) {
 
-	int i,ind,places,digits;
+	int i,j,ind,places,digits,itemno;
 	double dval[MAXITEM],dval0[MAXITEM];
+	bool need[MAXITEM];
 	bool ifvalues,first,ifsign;
-	int lineno=0,firstdata,ninitem,nnewitem;
+	int lineno=0,ninitem,nnewitem,nout;
+	int outitemno[MAXITEM];
 	xtring line,text;
+	RowBuffer kept; // rows to be written in slow mode
+	const double* row;
+	NumberFormat newfmt; // for computed items in fast mode
+	ColumnCache cache;
+	bool ifcached=false;
 	nrec=0;
 	
-	FILE* in=fopen(infile,"rt");
-	if (!in) {
+	if (iffull) newfmt.setshortest();
+	else newfmt.setgeneral(0);
+	
+	InputFile in;
+	if (!in.open(infile)) {
 		printf("Could not open %s for input\n",(char*)infile);
 		return false;
 	}
 	
-	FILE* out=fopen(outfile,"wt");
-	if (!out) {
+	OutputFile out;
+	if (!out.open(outfile)) {
 		printf("Could not open %s for output\n",(char*)outfile);
 		return false;
 	}
 
 	// Read header and find columns containing lon, lat, year
+	runstats.setphase(RunStats::PHASE_HEADER);
 	if (!readheader(in,line,items,nitem,infile,dval0,ifvalues,lineno)) {
 		return false;
 	}
 	
-	firstdata=lineno;
-	
 	if (includeall) {
 		for (i=0;i<nitem;i++) {
 			items[i].include=true;
@@ -1068,13 +1126,47 @@ bool readdata(xtring infile,xtring outfile,Item* items,int& nitem,int& nrec,
 	if (!parse_outitems(items,nitem,outitem,noutitem,infile)) return false;
 	nnewitem=nitem-ninitem;
 	
+	// Only items referenced by expressions, and in slow mode items written to
+	// the output file, need to be converted (fast mode copies rows as text)
+	
+	for (i=0;i<nitem;i++) need[i]=i>=ninitem || (items[i].include && !iffast);
+	for (i=ninitem;i<nitem;i++) {
+		for (j=0;j<items[i].ntoken;j++) {
+			itemno=items[i].plist[j].itemno;
+			if (items[i].plist[j].type==IDENTIFIER && itemno>=0) need[itemno]=true;
+		}
+	}
+	
 	if (iffast) {
-		fprintf(out,"%s",(char*)line);
+		out.put((char*)line);
 		for (i=0;i<nnewitem;i++) {
-			fprintf(out,sep);
-			fprintf(out,"%s",(char*)items[i+ninitem].label);
+			out.put(sep);
+			out.put((char*)items[i+ninitem].label);
+		}
+		out.put('\n');
+	}
+
+	// Slow mode reads the input only once, keeping the rows for output
+	// until the formats of all items are known
+	
+	if (!iffast) {
+		nout=0;
+		for (i=0;i<nitem;i++)
+			if (items[i].include) outitemno[nout++]=i;
+		kept.init(nout);
+	}
+
+	// In slow mode, remaining rows may be fetched from a binary cache
+	// (fast mode copies the text of each row to the output)
+	
+	if (ifcache && !iffast) ifcached=cache.open(infile) && cache.ncolumn()==ninitem;
+	if (ifcached) {
+		for (i=0;i<ninitem;i++) {
+			if (cache.places(i)>items[i].places) items[i].places=cache.places(i);
+			if (cache.digits(i)>items[i].digits) items[i].digits=cache.digits(i);
+			if (cache.ifsign(i)) items[i].ifsign=true;
+			if (!cache.ifnum(i)) items[i].ifnum=false;
 		}
-		fprintf(out,"\n");
 	}
 
 	printf("Reading data from %s ...\n",(char*)infile);
@@ -1083,12 +1175,17 @@ bool readdata(xtring infile,xtring outfile,Item* items,int& nitem,int& nrec,
 	
 	if (ifvalues) {
 
-		if (iffast) fprintf(out,"%s",(char*)line);
+		runstats.rowsparsed++;
+		runstats.setphase(RunStats::PHASE_AGGREGATE);
+		if (iffast) out.put((char*)line);
 		for (i=0;i<nnewitem;i++) {
 			ind=i+ninitem;
 			if (!evaluate(items[ind].plist,items[ind].ntoken,dval0,dval0[ind],nrec+1))
 				return false;
-			if (iffast) fprintf(out,"%s%g",(char*)sep,dval0[ind]);
+			if (iffast) {
+				out.put(sep);
+				out.put(dval0[ind],newfmt);
+			}
 			else {
 				text.printf("%g",dval0[ind]);
 				if (scanitem(text,places,digits,ifsign)) {
@@ -1099,24 +1196,28 @@ bool readdata(xtring infile,xtring outfile,Item* items,int& nitem,int& nrec,
 				else items[ind].ifnum=false;
 			}
 		}
-		if (iffast) fprintf(out,"\n");
+		if (iffast) out.put('\n');
+		else keeprow(kept,dval0,items,nitem);
 		nrec++;
 	}
 		
-	while (!feof(in)) {
+	if (!ifcached) progress.start(in);
+	while (ifcached?!cache.eof():!in.eof()) {
 		
 		// Read next record in file
 		
-		if (readrecord(in,line,dval,nitem,items,lineno,infile,iffast,true)) {
+		runstats.setphase(RunStats::PHASE_READ);
+		if (!ifcached) progress.tick(in);
+		if (ifcached?readrecord(cache,dval,ninitem,nitem):
+			readrecord(in,line,dval,nitem,items,lineno,infile,iffast,true,need)) {
 
-			if (iffast) fprintf(out,"%s",(char*)line);
-			
+			runstats.rowsparsed++;
+			runstats.setphase(RunStats::PHASE_AGGREGATE);
 			for (i=0;i<nnewitem;i++) {
 				ind=i+ninitem;
 				if (!evaluate(items[ind].plist,items[ind].ntoken,dval,dval[ind],nrec+1))
 					return false;
-				if (iffast) fprintf(out,"%s%g",(char*)sep,dval[ind]);
-				else {
+				if (!iffast) {
 					text.printf("%g",dval[ind]);
 					if (scanitem(text,places,digits,ifsign)) {
 						if (places>items[ind].places) items[ind].places=places;
@@ -1126,12 +1227,21 @@ bool readdata(xtring infile,xtring outfile,Item* items,int& nitem,int& nrec,
 					else items[ind].ifnum=false;
 				}
 			}
-			if (iffast) fprintf(out,"\n");
-			nrec++;
 			
-			if (!(nrec%50000)) printf("%d ...\n",nrec);
+			if (iffast) {
+				runstats.setphase(RunStats::PHASE_FORMAT);
+				out.put((char*)line);
+				for (i=0;i<nnewitem;i++) {
+					out.put(sep);
+					out.put(dval[i+ninitem],newfmt);
+				}
+				out.put('\n');
+			}
+			else keeprow(kept,dval,items,nitem);
+			nrec++;
 		}
 	}
+	progress.stop();
 	
 	// Slow mode
 	
@@ -1139,70 +1249,33 @@ bool readdata(xtring infile,xtring outfile,Item* items,int& nitem,int& nrec,
 	
 		// Print header row
 		
+		runstats.setphase(RunStats::PHASE_FORMAT);
 		first=true;
 		for (i=0;i<nitem;i++) {
 			if (items[i].include) {
 				items[i].compute_fmt();
-				if (!first) fprintf(out,sep);
-				fprintf(out,items[i].lfmt,(char*)items[i].label);
+				if (!first) out.put(sep);
+				out.printf(items[i].lfmt,(char*)items[i].label);
 				first=false;
 			}
 		}
-		fprintf(out,"\n");
-		
-		// Reread input file, printing data as we go
+		out.put('\n');
 		
-		rewind(in);
-		for (i=0;i<firstdata;i++) readfor(in,"");
+		// Write the rows kept
 		
-		nrec=0;
-		
-		if (ifvalues) {
-		
-			first=true;
-			for (i=0;i<nitem;i++) {
-				if (items[i].include) {
-					if (i>=ninitem) {
-						if (!evaluate(items[i].plist,items[i].ntoken,dval0,dval0[i],nrec+1))
-							return false;
-					}
-					if (!first) fprintf(out,sep);
-					fprintf(out,items[i].fmt,dval0[i]);
-					first=false;
-				}
-			}
-			fprintf(out,"\n");
-			nrec++;
-		}
-		
-		while (!feof(in)) {
-		
-			// Read next record in file
-			
-			if (readrecord(in,line,dval,nitem,items,lineno,infile,iffast,false)) {
-
-				first=true;
-				for (i=0;i<nitem;i++) {
-					if (items[i].include) {
-						if (i>=ninitem) {
-							if (!evaluate(items[i].plist,items[i].ntoken,dval,dval[i],nrec+1))
-								return false;
-						}
-						if (!first) fprintf(out,sep);
-						fprintf(out,items[i].fmt,dval[i]);
-						first=false;
-					}
-				}
-				fprintf(out,"\n");
-				nrec++;
-			
-				if (!(nrec%50000)) printf("%d ...\n",nrec);
+		kept.rewind();
+		while ((row=kept.next())) {
+			for (i=0;i<nout;i++) {
+				if (i) out.put(sep);
+				out.put(row[i],items[outitemno[i]].nfmt);
 			}
+			out.put('\n');
 		}
 	}
 	
-	fclose(in);
-	fclose(out);
+	in.close();
+	out.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	return true;
 }
@@ -1258,6 +1331,16 @@ void helptext(FILE* out,xtring exe) {
 	fprintf(out,"    Tab-delimited output\n\n");
 	fprintf(out,"-fast\n");
 	fprintf(out,"    Fast mode\n\n");
+	fprintf(out,"    Computed items are written with as many significant digits as needed\n");
+	fprintf(out,"    to represent their values exactly (up to 17)\n\n");
+	fprintf(out,"-g\n");
+	fprintf(out,"    In fast mode, write computed items rounded to 6 significant digits\n\n");
+	fprintf(out,"-cache\n");
+	fprintf(out,"    Except in fast mode, read data rows from a binary cache of the input file\n");
+	fprintf(out,"    (<input-file>.gbin), which is created or brought up to date by parsing the\n");
+	fprintf(out,"    input file if necessary\n\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
 	fprintf(out,"-help\n");
 	fprintf(out,"    Displays this help message\n");
 }
@@ -1285,13 +1368,17 @@ void abort(xtring exe) {
 	printf("         -o <output-file>\n");
 	printf("         -tab\n");
 	printf("         -fast\n");
+	printf("         -g\n");
+	printf("         -cache\n");
+	printf("         -stats\n");
 	printf("         -help\n");
 
 	exit(99);
 }
 
 bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
-	bool& iffast,xtring& sep,xtring* outitem,int& noutitem,bool& includeall) {
+	bool& iffast,bool& iffull,bool& ifcache,xtring& sep,xtring* outitem,int& noutitem,
+	bool& includeall) {
 
 	int i;
 	xtring arg,item;
@@ -1301,6 +1388,8 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 	outfile="";
 	sep=" ";
 	iffast=false;
+	iffull=true;
+	ifcache=false;
 	noutitem=0;
 	includeall=true;
 	
@@ -1339,6 +1428,7 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 					}
 				}
 			}
+			else if (arg=="-stats") runstats.enable();
 			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
 			else if (arg=="-tab") {
 				sep="\t";
@@ -1346,6 +1436,12 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 			else if (arg=="-fast") {
 				iffast=true;
 			}
+			else if (arg=="-g") {
+				iffull=false;
+			}
+			else if (arg=="-cache") {
+				ifcache=true;
+			}
 			else if (arg=="-n") {
 				includeall=false;
 			}
@@ -1385,21 +1481,21 @@ int main(int argc,char* argv[]) {
 	xtring infile,outfile,header,sep,outitem[MAXITEM];
 	Item items[MAXITEM];
 	int nitem,nrec,ntoken,noutitem;
-	bool iffast,includeall;
+	bool iffast,iffull,ifcache,includeall;
 			
-	if (!processargs(argc,argv,infile,outfile,iffast,sep,
+	if (!processargs(argc,argv,infile,outfile,iffast,iffull,ifcache,sep,
 		outitem,noutitem,includeall)) abort(argv[0]);
 	
 	unixtime(header);
 	header=(xtring)"[COMPUTE  "+header+"]\n\n";
 	printf("%s",(char*)header);
 
-	if (readdata(infile,outfile,items,nitem,nrec,iffast,sep,
+	if (readdata(infile,outfile,items,nitem,nrec,iffast,iffull,ifcache,sep,
 		outitem,noutitem,includeall)) {
 		
 		printf("\n%d records written to %s\n\n",nrec,(char*)outfile);
 	}
 
-		
+	runstats.print("compute");
 	return 0;
 }
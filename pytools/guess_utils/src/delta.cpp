@@ -15,44 +15,18 @@
 #include <time.h>
 #include <string.h>
 #include <gutil.h>
+#include <vector>
+
+using std::vector;
 
 const int MAXINDEX=8;
 	// Maximum number of index items (e.g. longitude, latitude, year)
-const int MAXITEM=380;
-	// Maximum number of items in a record (row) of an input file
-const int MAXGRID=65000;
-	// Maximum number of grid cells / records in input files
-
-class Record {
-
-public:
-	int nrec;
-	float val[MAXITEM];
-	
-	Record() {
-	
-		int i;
-		
-		nrec=0;
-		
-		for (i=0;i<MAXITEM;i++) val[i]=0.0;
-	}
-	
-	void add_record(Record& rec) {
-	
-		// Function to add another record to this record
-		
-		int i;
-		
-		for (i=0;i<MAXITEM;i++) val[i]+=rec.val[i];
-		nrec+=rec.nrec;
-	}
-};
 
 class Item {
 
 public:
 	xtring label,fmt,lfmt;
+	NumberFormat nfmt;
 	bool ifnum;
 	bool ifsign;
 	bool ifindex;
@@ -82,16 +56,23 @@ public:
 		
 		if (label.len()>w) w=label.len();
 		
-		if (ifnum)
+		if (ifnum) {
 			fmt.printf("%%%d.%df",w,places);
-		else fmt.printf("%%%dg",w);
+			nfmt.setfixed(w,places);
+		}
+		else {
+			fmt.printf("%%%dg",w);
+			nfmt.setgeneral(w);
+		}
 		
 		lfmt.printf("%%%ds",w);
 	}
 };
 
-// Global matrix to store data from files
-Record data[MAXGRID];
+// Global table of records from the second input file (then differences), one
+// column per shared item. The weight of a row counts the records read into it
+// (1, or 2 once a matching record of the first file has been subtracted)
+RecordTable data;
 
 bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
 
@@ -125,14 +106,15 @@ bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
 }
 
 
-bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
+bool readheader(InputFile& in,vector<Item>& items,int& ncol,int& nindexitem,
 	xtring indexitem[MAXINDEX],int indexitemno[MAXINDEX],xtring filename,
-	double values[MAXITEM],bool& ifvalues,bool relax,int& lineno) {
+	vector<double>& values,bool& ifvalues,bool relax,int& lineno) {
 
 	// Reads header row of an LPJ-GUESS output file
 	// label = array of header labels
 	// ncol  = number of columns (labels)
-	// Returns false if too many items in file
+	// items and values are extended to the number of columns
+	// Returns false if file contains no data or index items are missing
 	
 	xtring line,item;
 	int pos,i,j,idindex[MAXINDEX],lonpos,latpos;
@@ -143,7 +125,7 @@ bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
 	lonpos=-1;
 	latpos=-1;
 
-	while (!ncol && !feof(in)) {
+	while (!ncol && !in.eof()) {
 	
 		readfor(in,"a#",&line);
 		lineno++;
@@ -152,9 +134,9 @@ bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
 		while (pos!=-1) {
 			line=line.mid(pos);
 			pos=line.findoneof(" \t\r");
-			if (ncol>MAXITEM) {
-				printf("Too many columns (>%d) in %s\n",MAXITEM,(char*)filename);
-				return false;
+			if (ncol==(int)items.size()) {
+				items.resize(ncol+1);
+				values.resize(ncol+1);
 			}
 			if (pos>0) {
 				item=line.left(pos);
@@ -192,6 +174,15 @@ bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
 		}
 	}
 
+	if (!ncol) {
+		printf("%s contains no data\n",(char*)filename);
+		return false;
+	}
+	else if (ncol<3) {
+		printf("At least three columns expected in %s\n",(char*)filename);
+		return false;
+	}
+
 	for (i=0;i<nindexitem;i++) {
 		if (idindex[i]<0) {
 			if (indexitem[i]=="") {
@@ -236,104 +227,128 @@ bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
 			items[1].label="Lat";
 		}
 	}
-	
-	if (!ncol) {
-		printf("%s contains no data\n",(char*)filename);
-		return false;
-	}
-	else if (ncol<3) {
-		printf("At least three columns expected in %s\n",(char*)filename);
-		return false;
-	}
 
 	return true;
 }
 
-bool readrecord(FILE*& in,Record& rec,int ncol,int nitem,Item* items,xtring sfmt,xtring dfmt,
+bool readrecord(InputFile& in,double* val,int ncol,int nitem,Item* items,xtring sfmt,ReadFormat& dfmt,
 	int nrec,bool iffast,int fileno,int& lineno,xtring& filename) {
 
-	// Reads one record (row) in output file
+	// Reads one record (row) in output file into val (one value per item)
 	// Returns false on end of file
 	// ncol = total number of items/columns in this file including index items
 	// nitem = number of items to assign data to
 	// fileno = file number
 	
-	xtring sval[MAXITEM],sval_curr,line,whole_line;
-	double dval[MAXITEM];
-	int i,places,digits,pos;
-	bool ifsign,searching=true,blank,isnum;
+	static vector<ScannedItem> sval; // static to avoid reallocating in each call
+	static vector<double> dval;
+	xtring whole_line;
+	const char* pchar;
+	const char* pstart;
+	int i;
+	bool searching=true,blank;
+
+	if ((int)sval.size()<ncol || (int)sval.size()<nitem) sval.resize(ncol>nitem?ncol:nitem);
+	if ((int)dval.size()<ncol) dval.resize(ncol);
 
 	while (searching) {
 	
 		if (nrec<100 || !(nrec%10) || !iffast) {
 
 			if (!readfor(in,"a#",&whole_line)) return false;
-			if (feof(in)) return false;
-			line=whole_line;
+			if (in.eof()) return false;
 			lineno++;
-			i=0;
 			
+			// Items are separated by blanks, tabs and carriage returns; each is
+			// tested, converted and scanned for its format in one go (items
+			// missing from a short line, or following a non-numeric item, are
+			// empty and so read as 0)
+			
+			pchar=whole_line;
+			i=0;
 			blank=true;
-			isnum=true;
-			pos=line.findnotoneof(" \t\r");
-			while (pos!=-1 && i<nitem) {
-				line=line.mid(pos);
+			while (i<nitem) {
+				while (*pchar==' ' || *pchar=='\t' || *pchar=='\r') pchar++;
+				if (!*pchar) break;
 				blank=false;
-				pos=line.findoneof(" \t\r");
-				if (pos>0) {
-					sval[i]=line.left(pos);
-					line=line.mid(pos);
-					pos=line.findnotoneof(" \t\r");
-				}
-				else {
-					sval[i]=line;
-				}
-				if (!sval[i].isnum()) {
-					isnum=false;
-					i=nitem;
-				}
-				i++;
+				pstart=pchar;
+				while (*pchar && *pchar!=' ' && *pchar!='\t' && *pchar!='\r') pchar++;
+				scannumber(pstart,pchar-pstart,sval[i]);
+				if (!sval[i++].isnum) break;
 			}
+			while (i<(int)sval.size()) scannumber(pchar,0,sval[i++]);
 			
-			if (blank)
+			if (blank) {
 				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename);
+				runstats.rowsblank++;
+			}
 			else {
 				for (i=0;i<nitem;i++) {
 				
-					sval_curr=sval[items[i].colno[fileno]];
-					if (!sval_curr.isnum()) {
+					const ScannedItem& item=sval[items[i].colno[fileno]];
+					if (!item.isnum) {
 						printf("Line %d of %s contains non-numeric data - ignoring entire line\n",
 							lineno,(char*)filename);
+						runstats.rowsnonnumeric++;
 						searching=true;
 						i=nitem;
 					}
 					else {
-						if (scanitem(sval_curr,places,digits,ifsign)) {
-							if (places>items[i].places) items[i].places=places;
-							if (digits>items[i].digits) items[i].digits=digits;
-							if (ifsign) items[i].ifsign=true;
+						if (item.ifplain) {
+							if (item.places>items[i].places) items[i].places=item.places;
+							if (item.digits>items[i].digits) items[i].digits=item.digits;
+							if (item.ifsign) items[i].ifsign=true;
 						}
 						else items[i].ifnum=false;
-						rec.val[i]=sval_curr.num();
+						val[i]=item.value;
 						searching=false;
 					}
 				}
 			}
 		}
 		else {
-			if (!readfor(in,dfmt,dval)) return false;
+			dfmt.bind(0,&dval[0]);
+			if (!readfor(in,dfmt)) return false;
 			lineno++;
 			for (i=0;i<nitem;i++)
-				rec.val[i]=dval[items[i].colno[fileno]];
+				val[i]=dval[items[i].colno[fileno]];
 			searching=false;
 		}
 	}
+	
+	return true;
+}
+
+bool readrecord(ColumnCache& cache,double* val,int nitem,Item* items,int fileno) {
 
-	rec.nrec=1;
+	// Fetches the next record (row) from the binary cache of an input file
+	// Returns false after the last row
+	
+	int i;
+	
+	if (!cache.nextrow()) return false;
+	for (i=0;i<nitem;i++)
+		val[i]=cache.values()[items[i].colno[fileno]];
 	
 	return true;
 }
 
+void cacheformat(ColumnCache& cache,Item* items,int nitem,int fileno) {
+
+	// Widens the format of each item to hold the values of its column in the
+	// cached rows of an input file
+	
+	int i,col;
+	
+	for (i=0;i<nitem;i++) {
+		col=items[i].colno[fileno];
+		if (cache.places(col)>items[i].places) items[i].places=cache.places(col);
+		if (cache.digits(col)>items[i].digits) items[i].digits=cache.digits(col);
+		if (cache.ifsign(col)) items[i].ifsign=true;
+		if (!cache.ifnum(col)) items[i].ifnum=false;
+	}
+}
+
 bool finditem(xtring item,int& itemno,Item* items,int nitem) {
 
 	int i;
@@ -361,10 +376,10 @@ bool finditem(xtring item,int& itemno,Item* items,int nitem) {
 	return false;
 }
 
-int findrec(Record& rec,int nrec,Item* items,int nitem,int fileno,int guess) {
+int findrec(const double* val,int nrec,Item* items,int nitem,int fileno,int guess) {
 
 	// Returns record number in global data corresponding to given values of index items
-	// in argument record
+	// in argument record val
 	// -1 if not found
 	// nrec = number of records in global data
 	// guess = guess at matching record number
@@ -376,7 +391,7 @@ int findrec(Record& rec,int nrec,Item* items,int nitem,int fileno,int guess) {
 		matches=true;
 		for (j=0;j<nitem && matches;j++) {
 			if (items[j].ifindex) {
-				if (rec.val[items[j].colno[fileno]]!=data[i].val[j]) matches=false;
+				if (val[items[j].colno[fileno]]!=data(i,j)) matches=false;
 			}
 		}
 		
@@ -389,7 +404,7 @@ int findrec(Record& rec,int nrec,Item* items,int nitem,int fileno,int guess) {
 		matches=true;
 		for (j=0;j<nitem && matches;j++) {
 			if (items[j].ifindex) {
-				if (rec.val[items[j].colno[fileno]]!=data[i].val[j]) matches=false;
+				if (val[items[j].colno[fileno]]!=data(i,j)) matches=false;
 			}
 		}
 		
@@ -399,35 +414,39 @@ int findrec(Record& rec,int nrec,Item* items,int nitem,int fileno,int guess) {
 	return -1;
 }
 
-bool readdata(xtring infile1,xtring infile2,Item* items,int& nitem,
+bool readdata(xtring infile1,xtring infile2,vector<Item>& items,int& nitem,
 	xtring indexitem[MAXINDEX],int indexitemno[MAXINDEX],int& nindexitem,
-	int& nrec,bool iffast,int& lonely_recs) {
+	int& nrec,bool iffast,bool ifcache,int& lonely_recs) {
 
 	int recno,i,j,nrec1;
-	double dval1[MAXITEM],dval2[MAXITEM];
+	vector<double> dval1,dval2;
 	bool ifvalues1,ifvalues2;
-	xtring sfmt,dfmt;
-	Record rec;
-	Item items1[MAXITEM],items2[MAXITEM];
+	xtring sfmt,fmt;
+	ReadFormat dfmt;
+	vector<double> rec;
+	vector<Item> items1,items2;
+	ColumnCache cache1,cache2;
+	bool ifcached1=false,ifcached2=false;
 	int nitem1,nitem2;
 	int colno;
 	int lineno1=0,lineno2=0;
 	
-	FILE* in2=fopen(infile2,"rt");
-	if (!in2) {
+	InputFile in2;
+	if (!in2.open(infile2)) {
 		printf("Could not open %s for input\n",(char*)infile2);
 		return false;
 	}
 	
 	// Read headers and find columns containing index items
 	
+	runstats.setphase(RunStats::PHASE_HEADER);
 	if (!readheader(in2,items2,nitem2,nindexitem,indexitem,indexitemno,
 		infile2,dval2,ifvalues2,true,lineno2)) {
 		return false;
 	}
 	
-	FILE* in1=fopen(infile1,"rt");
-	if (!in1) {
+	InputFile in1;
+	if (!in1.open(infile1)) {
 		printf("Could not open %s for input\n",(char*)infile1);
 		return false;
 	}
@@ -458,10 +477,11 @@ bool readdata(xtring infile1,xtring infile2,Item* items,int& nitem,
 		
 	// Produce list of shared items
 	
+	items.clear();
 	if (ifvalues1 && ifvalues2) { // both files lack a header row, same number of columns
 		nitem=nitem1;
 		for (i=0;i<nitem1;i++) {
-			items[i]=items1[i];
+			items.push_back(items1[i]);
 			items[i].colno[1]=items[i].colno[0]=i;
 		}
 	}
@@ -469,8 +489,8 @@ bool readdata(xtring infile1,xtring infile2,Item* items,int& nitem,
 		nitem=0;
 		for (i=0;i<nitem1;i++) {
 			colno=0;
-			if (finditem(items1[i].label,colno,items2,nitem2)) {
-				items[nitem]=items1[i];
+			if (finditem(items1[i].label,colno,&items2[0],nitem2)) {
+				items.push_back(items1[i]);
 				items[nitem].colno[1]=colno;
 				items[nitem].colno[0]=i;
 				nitem++;
@@ -478,46 +498,58 @@ bool readdata(xtring infile1,xtring infile2,Item* items,int& nitem,
 		}
 	}
 	
+	// Record buffer is indexed by item, but also by column number in findrec
+	rec.resize(nitem1>nitem2?nitem1:nitem2);
+	data.init(nitem);
+	
+	// Remaining rows are fetched from binary caches of the input files if available
+	
+	if (ifcache) {
+		ifcached2=cache2.open(infile2) && cache2.ncolumn()==nitem2;
+		if (ifcached2) cacheformat(cache2,&items[0],nitem,1);
+		ifcached1=cache1.open(infile1) && cache1.ncolumn()==nitem1;
+		if (ifcached1) cacheformat(cache1,&items[0],nitem,0);
+	}
+	
 	printf("\nReading data from %s ...\n",(char*)infile2);
 	
 	sfmt.printf("%da",nitem2);
-	dfmt.printf("%df",nitem2);
+	fmt.printf("%df",nitem2);
+	dfmt.compile(fmt);
 	
 	// Transfer data from first row (if all numbers)
 	
 	nrec=0;
 
+	runstats.setphase(RunStats::PHASE_READ);
 	if (ifvalues2) {
-		for (i=0;i<nitem;i++) {
-			data[nrec].val[i]=dval2[items[i].colno[1]];
-			data[nrec].nrec=1;
-		}
+		runstats.rowsparsed++;
+		for (i=0;i<nitem;i++) rec[i]=dval2[items[i].colno[1]];
+		data.set(data.addrow(),&rec[0],1.0);
 		nrec++;
 	}
 		
-	while (!feof(in2)) {
+	if (!ifcached2) progress.start(in2);
+	while (ifcached2?!cache2.eof():!in2.eof()) {
 		
 		// Read next record in file
 
-		if (readrecord(in2,rec,nitem2,nitem,items,sfmt,dfmt,nrec,iffast,1,lineno2,infile2)) {
+		if (!ifcached2) progress.tick(in2);
+		if (ifcached2?readrecord(cache2,&rec[0],nitem,&items[0],1):
+			readrecord(in2,&rec[0],nitem2,nitem,&items[0],sfmt,dfmt,nrec,iffast,1,lineno2,infile2)) {
 
-			if (nrec==MAXGRID) {
-				printf("Too many records (>%d) in %s\n",MAXGRID,(char*)infile2);
-				return false;
-			}
-			
-			rec.nrec=1;
-			data[nrec].add_record(rec);
+			runstats.rowsparsed++;
+			data.set(data.addrow(),&rec[0],1.0);
 			nrec++;
-			if (!(nrec%5000)) printf("%d ...\n",nrec);
-			
 		}
 	}
+	progress.stop();
 
 	printf("Reading data from %s ...\n",(char*)infile1);
 	
 	sfmt.printf("%da",nitem1);
-	dfmt.printf("%df",nitem1);
+	fmt.printf("%df",nitem1);
+	dfmt.compile(fmt);
 
 	// Transfer data from first row (if all numbers)
 	
@@ -525,37 +557,45 @@ bool readdata(xtring infile1,xtring infile2,Item* items,int& nitem,
 	lonely_recs=0;
 	
 	if (ifvalues1) {
+		runstats.rowsparsed++;
+		runstats.setphase(RunStats::PHASE_AGGREGATE);
 		for (i=0;i<nitem;i++)
-			rec.val[i]=dval1[items[i].colno[0]];
+			rec[i]=dval1[items[i].colno[0]];
 
-		recno=findrec(rec,nrec,items,nitem,0,0);
+		recno=findrec(&rec[0],nrec,&items[0],nitem,0,0);
 		if (recno<0) {
 			lonely_recs++;
 		}
 		else {
 			for (i=0;i<nitem;i++) {
 				if (!items[i].ifindex) {
-					data[recno].val[i]=dval1[items[i].colno[0]]-data[recno].val[i];
+					data(recno,i)=dval1[items[i].colno[0]]-data(recno,i);
 				}
 			}
 				
-			data[recno].nrec++; // to flag that this record has been subtracted
+			data.weight(recno)++; // to flag that this record has been subtracted
 			nrec1++;
 		}
 	}
 	
-	while (!feof(in1)) {
+	if (!ifcached1) progress.start(in1);
+	while (ifcached1?!cache1.eof():!in1.eof()) {
 	
 		// Read next record in file
 		
-		if (readrecord(in1,rec,nitem1,nitem,items,sfmt,dfmt,nrec1,iffast,0,lineno1,infile1)) {
+		runstats.setphase(RunStats::PHASE_READ);
+		if (!ifcached1) progress.tick(in1);
+		if (ifcached1?readrecord(cache1,&rec[0],nitem,&items[0],0):
+			readrecord(in1,&rec[0],nitem1,nitem,&items[0],sfmt,dfmt,nrec1,iffast,0,lineno1,infile1)) {
 		
-			recno=findrec(rec,nrec,items,nitem,0,nrec1);
+			runstats.rowsparsed++;
+			runstats.setphase(RunStats::PHASE_AGGREGATE);
+			recno=findrec(&rec[0],nrec,&items[0],nitem,0,nrec1);
 			if (recno<0) {
 				lonely_recs++;
 			}
 			else {
-				if (data[recno].nrec>1) {
+				if (data.weight(recno)>1) {
 					printf("More than one record in %s matches record #%d in %s\n",
 						(char*)infile2,nrec1+1,(char*)infile1);
 					return false;
@@ -563,32 +603,34 @@ bool readdata(xtring infile1,xtring infile2,Item* items,int& nitem,
 				
 				for (i=0;i<nitem;i++) {
 					if (!items[i].ifindex) {
-						data[recno].val[i]=rec.val[i]-data[recno].val[i];
+						data(recno,i)=rec[i]-data(recno,i);
 					}
 				}
 				
-				data[recno].nrec++; // to flag that this record has been subtracted
+				data.weight(recno)++; // to flag that this record has been subtracted
 				
 				nrec1++;
-				if (!(nrec%5000)) printf("%d ...\n",nrec);
 			}
 		}
 	}
+	progress.stop();
 	
-	fclose(in1);
-	fclose(in2);
+	in1.close();
+	in2.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	return true;
 }
 
-bool writedata(xtring filename,Item* items,int& nitem,int nrec,char* sep,
+bool writedata(xtring filename,vector<Item>& items,int& nitem,int nrec,char* sep,
 	xtring infile1,xtring infile2,int lonely_recs) {
 	
 	int i,j,mismatch_recs=0,good_recs=0;
 	bool mismatch=false;
 	
-	FILE* out=fopen(filename,"wt");
-	if (!out) {
+	runstats.setphase(RunStats::PHASE_FORMAT);
+	OutputFile out;
+	if (!out.open(filename)) {
 		printf("Could not open %s for output\n",(char*)filename);
 		return false;
 	}
@@ -597,21 +639,21 @@ bool writedata(xtring filename,Item* items,int& nitem,int nrec,char* sep,
 	
 	for (i=0;i<nitem;i++) {
 		items[i].compute_fmt();
-		if (i) fprintf(out,sep);
-		fprintf(out,items[i].lfmt,(char*)items[i].label);
+		if (i) out.put(sep);
+		out.printf(items[i].lfmt,(char*)items[i].label);
 	}
-	fprintf(out,"\n");
+	out.put('\n');
 
 	// Print data
 
 	for (i=0;i<nrec;i++) {
 
-		if (data[i].nrec==2) {
+		if (data.weight(i)==2) {
 			for (j=0;j<nitem;j++) {
-				if (j) fprintf(out,sep);
-				fprintf(out,items[j].fmt,(double)data[i].val[j]);
+				if (j) out.put(sep);
+				out.put(data(i,j),items[j].nfmt);
 			}
-			fprintf(out,"\n");
+			out.put('\n');
 			good_recs++;
 		}
 		else {
@@ -620,7 +662,8 @@ bool writedata(xtring filename,Item* items,int& nitem,int nrec,char* sep,
 		}
 	}
 	
-	fclose(out);
+	out.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	printf("\n");
 	if (mismatch || lonely_recs) {
@@ -682,6 +725,11 @@ void helptext(FILE* out,xtring exe) {
 	fprintf(out,"    Tab-delimited output\n");
 	fprintf(out,"-fast\n");
 	fprintf(out,"    Fast mode with tab-delimited output\n");
+	fprintf(out,"-cache\n");
+	fprintf(out,"    Read data rows from binary caches of the input files (<input-file>.gbin),\n");
+	fprintf(out,"    which are created or brought up to date by parsing the input files if necessary\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
 	fprintf(out,"-help\n");
 	fprintf(out,"    Displays this help message\n");
 }
@@ -708,6 +756,8 @@ void abort(xtring exe) {
 	printf("         -o <output-file>\n");
 	printf("         -tab\n");
 	printf("         -fast\n");
+	printf("         -cache\n");
+	printf("         -stats\n");
 	printf("         -help\n");
 
 	exit(99);
@@ -715,7 +765,7 @@ void abort(xtring exe) {
 
 bool processargs(int argc,char* argv[],xtring& infile1,xtring& infile2,xtring& outfile,
 	xtring& sep,xtring indexitem[MAXINDEX],int indexitemno[MAXINDEX],int& nindexitem,
-	bool& iffast) {
+	bool& iffast,bool& ifcache) {
 
 	int i,itemno,ninfile=0;
 	xtring arg,item;
@@ -726,6 +776,7 @@ bool processargs(int argc,char* argv[],xtring& infile1,xtring& infile2,xtring& o
 	// Defaults
 	outfile="";
 	iffast=false;
+	ifcache=false;
 	for (i=0;i<MAXINDEX;i++) {
 		indexitem[i]="";
 		indexitemno[i]=0;
@@ -756,10 +807,6 @@ bool processargs(int argc,char* argv[],xtring& infile1,xtring& infile2,xtring& o
 							dval=item.num();
 							if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 								itemno=dval;
-								if (itemno>MAXITEM) {
-									printf("Option -i: too many items (maximum allowed is %d)\n",MAXITEM);
-									return false;
-								}
 								indexitemno[nindexitem++]=itemno;
 							}
 						}
@@ -779,6 +826,8 @@ bool processargs(int argc,char* argv[],xtring& infile1,xtring& infile2,xtring& o
 				sep="\t";
 				iffast=true;
 			}
+			else if (arg=="-cache") ifcache=true;
+			else if (arg=="-stats") runstats.enable();
 			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
 			else {
 				printf("Invalid option %s\n",(char*)arg);
@@ -820,13 +869,13 @@ int main(int argc,char* argv[]) {
 	xtring infile1,infile2,outfile,header;
 	xtring indexitem[MAXINDEX];
 	int indexitemno[MAXINDEX],nindexitem;
-	bool iffast;
-	Item items[MAXITEM];
+	bool iffast,ifcache;
+	vector<Item> items;
 	int nitem,nrec,lonely_records;
 	xtring sep;
 	
 	if (!processargs(argc,argv,infile1,infile2,outfile,sep,indexitem,
-		indexitemno,nindexitem,iffast))
+		indexitemno,nindexitem,iffast,ifcache))
 			abort(argv[0]);
 
 	unixtime(header);
@@ -834,10 +883,11 @@ int main(int argc,char* argv[]) {
 	printf("%s",(char*)header);
 	
 	if (readdata(infile1,infile2,items,nitem,indexitem,indexitemno,nindexitem,
-		nrec,iffast,lonely_records)) {
+		nrec,iffast,ifcache,lonely_records)) {
 
 		writedata(outfile,items,nitem,nrec,sep,infile1,infile2,lonely_records);
 	} 
 	
+	runstats.print("delta");
 	return 0;
 }
@@ -631,6 +631,7 @@ class Item {
 
 public:
 	xtring label,fmt,lfmt;
+	NumberFormat nfmt;
 	bool ifnum;
 	bool ifsign;
 	int places;
@@ -655,15 +656,20 @@ public:
 		
 		if (label.len()>w) w=label.len();
 		
-		if (ifnum)
+		if (ifnum) {
 			fmt.printf("%%%d.%df",w,places);
-		else fmt.printf("%%%dg",w);
+			nfmt.setfixed(w,places);
+		}
+		else {
+			fmt.printf("%%%dg",w);
+			nfmt.setgeneral(w);
+		}
 		
 		lfmt.printf("%%%ds",w);
 	}
 };
 
-bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
+bool scanitem(const char* text,int& places,int& digits,bool& ifsign) {
 
 	places=0;
 	digits=0;
@@ -695,7 +701,7 @@ bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
 }
 
 
-bool readheader(FILE*& in,xtring& whole_line,Item* items,int& ncol,
+bool readheader(InputFile& in,xtring& whole_line,Item* items,int& ncol,
 	xtring filename,
 	double values[MAXITEM],bool& ifvalues,int& lineno) {
 
@@ -709,7 +715,7 @@ bool readheader(FILE*& in,xtring& whole_line,Item* items,int& ncol,
 	bool alphabetics=false;
 	ncol=0;
 	
-	while (!ncol && !feof(in)) {
+	while (!ncol && !in.eof()) {
 	
 		readfor(in,"a#",&whole_line);
 		line=whole_line;
@@ -763,75 +769,102 @@ bool readheader(FILE*& in,xtring& whole_line,Item* items,int& ncol,
 	return true;
 }
 
-bool readrecord(FILE*& in,xtring& whole_line,double* dval,int nitem,Item* items,
-	int& lineno,xtring& filename,bool iffast,bool warn) {
+bool readrecord(InputFile& in,xtring& whole_line,double* dval,int nitem,Item* items,
+	int& lineno,xtring& filename,bool iffast,bool warn,const bool* need) {
 
 	// Reads one record (row) in output file
 	// Returns false on end of file
 	// nitem = total number of items
+	// need = which items to convert (NULL for all); other items are skipped
+	//        without being checked or converted, and dval is not set for them
 	
-	xtring sval[MAXITEM],line;
-	int i,places,digits,pos;
-	bool ifsign,searching=true,blank,isnum;
+	static ScannedItem sval[MAXITEM]; // static to avoid reallocating in each call
+	const char* field[MAXITEM];
+	int fieldlen[MAXITEM];
+	const char* pchar;
+	int i,nfield;
+	bool searching=true,blank,isnum;
 
 	while (searching) {
 	
 		if (!readfor(in,"a#",&whole_line)) return false;
-		if (feof(in)) return false;
-		line=whole_line;
+		if (in.eof()) return false;
 		lineno++;
-		i=0;
 		
-		blank=true;
+		// Locate the fields with a scan for delimiters
+
+		pchar=whole_line;
+		nfield=0;
+		while (nfield<nitem) {
+			while (*pchar==' ' || *pchar=='\t' || *pchar=='\r') pchar++;
+			if (!*pchar) break;
+			field[nfield]=pchar;
+			while (*pchar && *pchar!=' ' && *pchar!='\t' && *pchar!='\r') pchar++;
+			fieldlen[nfield]=pchar-field[nfield];
+			nfield++;
+		}
+		
+		// Test, convert and scan for format the fields needed, in one go
+		
+		blank=!nfield;
 		isnum=true;
-		pos=line.findnotoneof(" \t\r");
-		while (pos!=-1 && i<nitem) {
-			line=line.mid(pos);
-			blank=false;
-			pos=line.findoneof(" \t\r");
-			if (pos>0) {
-				sval[i]=line.left(pos);
-				line=line.mid(pos);
-				pos=line.findnotoneof(" \t\r");
-			}
-			else {
-				sval[i]=line;
-			}
-			if (!sval[i].isnum()) {
-				isnum=false;
-				i=nitem;
+		for (i=0;i<nitem && isnum;i++) {
+			if (!need || need[i]) {
+				if (i<nfield) {
+					scannumber(field[i],fieldlen[i],sval[i]);
+					dval[i]=sval[i].value;
+					if (!sval[i].isnum) isnum=false;
+				}
+				else dval[i]=0.0;
 			}
-			i++;
 		}
 		
 		if (blank) {
-			if (warn)
-				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename,feof(in));
+			if (warn) {
+				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename,in.eof());
+				runstats.rowsblank++;
+			}
 		}
 		else if (!isnum) {
-			if (warn)
+			if (warn) {
 				printf("Line %d of %s contains non-numeric data - ignoring entire line\n",
 					lineno,(char*)filename);
+				runstats.rowsnonnumeric++;
+			}
 		}
 		else {
-			for (i=0;i<nitem;i++) {
-				dval[i]=sval[i].num();
-				if (!iffast) {
-					if (scanitem(sval[i],places,digits,ifsign)) {
-						if (places>items[i].places) items[i].places=places;
-						if (digits>items[i].digits) items[i].digits=digits;
-						if (ifsign) items[i].ifsign=true;
+			if (!iffast) {
+				for (i=0;i<nfield;i++) {
+					if (!need || need[i]) {
+						if (sval[i].ifplain) {
+							if (sval[i].places>items[i].places) items[i].places=sval[i].places;
+							if (sval[i].digits>items[i].digits) items[i].digits=sval[i].digits;
+							if (sval[i].ifsign) items[i].ifsign=true;
+						}
+						else items[i].ifnum=false;
 					}
-					else items[i].ifnum=false;
 				}
-				searching=false;
 			}
+			searching=false;
 		}
 	}
 	
 	return true;
 }
 
+bool readrecord(ColumnCache& cache,double* dval,int nitem) {
+
+	// Fetches the next record (row) from the binary cache of the input file
+	// Returns false after the last row
+	
+	int i;
+	
+	if (!cache.nextrow()) return false;
+	for (i=0;i<nitem;i++) dval[i]=cache.values()[i];
+	
+	return true;
+}
+
 bool finditem(xtring item,int& itemno,xtring infile,Item* items,int nitem) {
 
 	int i;
@@ -946,71 +979,112 @@ bool convert_plist(int ntoken,xtring infile,Item* items,int nitem) {
 
 
 bool readdata(xtring infile,xtring outfile,Item* items,int ntoken,int& nitem,int& nrec,
-	bool iffast,xtring sep) {
+	bool iffast,bool ifcache,xtring sep) {
 
 	int inrec=0,i;
 	double dval[MAXITEM],dval0[MAXITEM],thisval;
+	bool need[MAXITEM];
 	bool ifvalues;
-	int lineno=0,firstdata;
+	int lineno=0;
 	xtring line;
+	ColumnCache cache;
+	RowBuffer kept; // rows to be written in slow mode
+	const double* row;
+	bool ifcached=false;
 	nrec=0;
 	
-	FILE* in=fopen(infile,"rt");
-	if (!in) {
+	InputFile in;
+	if (!in.open(infile)) {
 		printf("Could not open %s for input\n",(char*)infile);
 		return false;
 	}
 	
-	FILE* out=fopen(outfile,"wt");
-	if (!out) {
+	OutputFile out;
+	if (!out.open(outfile)) {
 		printf("Could not open %s for output\n",(char*)outfile);
 		return false;
 	}
 
 	// Read header and find columns containing lon, lat, year
+	runstats.setphase(RunStats::PHASE_HEADER);
 	if (!readheader(in,line,items,nitem,infile,dval0,ifvalues,lineno)) {
 		return false;
 	}
 	
-	firstdata=lineno;
-
 	if (!convert_plist(ntoken,infile,items,nitem)) return false;
 	
-	if (iffast) fprintf(out,"%s\n",(char*)line);
+	// In fast mode (which copies rows as text) only the items referenced by
+	// the expression need to be converted
+	
+	for (i=0;i<nitem;i++) need[i]=!iffast;
+	for (i=0;i<ntoken;i++) {
+		if (plist[i].type==IDENTIFIER && plist[i].itemno>=0) need[plist[i].itemno]=true;
+	}
+	
+	if (iffast) out.printf("%s\n",(char*)line);
+
+	// In slow mode, remaining rows may be fetched from a binary cache
+	// (fast mode copies the text of each row to the output)
+	
+	if (ifcache && !iffast) ifcached=cache.open(infile) && cache.ncolumn()==nitem;
+	
+	// Slow mode reads the input only once, keeping the rows selected for
+	// output until the formats of all items are known
+	
+	if (!iffast) kept.init(nitem);
+	
+	if (ifcached) {
+		for (i=0;i<nitem;i++) {
+			if (cache.places(i)>items[i].places) items[i].places=cache.places(i);
+			if (cache.digits(i)>items[i].digits) items[i].digits=cache.digits(i);
+			if (cache.ifsign(i)) items[i].ifsign=true;
+			if (!cache.ifnum(i)) items[i].ifnum=false;
+		}
+	}
 
 	printf("Reading data from %s ...\n",(char*)infile);
 	
 	// Transfer data from first row (if all numbers)
 	
-	if (ifvalues && iffast) {
+	if (ifvalues) {
 		
+		runstats.rowsparsed++;
+		runstats.setphase(RunStats::PHASE_AGGREGATE);
 		if (!evaluate(ntoken,dval0,thisval,inrec+1)) return false;
 		if (thisval) {
-			fprintf(out,"%s\n",(char*)line);
+			if (iffast) out.printf("%s\n",(char*)line);
+			else kept.add(dval0);
 			nrec++;
 		}
 		inrec++;
 	}
 		
-	while (!feof(in)) {
+	if (!ifcached) progress.start(in);
+	while (ifcached?!cache.eof():!in.eof()) {
 		
 		// Read next record in file
 		
-		if (readrecord(in,line,dval,nitem,items,lineno,infile,iffast,true)) {
-
-			if (iffast) {
-				if (!evaluate(ntoken,dval,thisval,inrec+1)) return false;
-				
-				if (thisval) {
-					fprintf(out,"%s\n",(char*)line);
-					nrec++;
+		runstats.setphase(RunStats::PHASE_READ);
+		if (!ifcached) progress.tick(in);
+		if (ifcached?readrecord(cache,dval,nitem):
+			readrecord(in,line,dval,nitem,items,lineno,infile,iffast,true,need)) {
+
+			runstats.rowsparsed++;
+			runstats.setphase(RunStats::PHASE_AGGREGATE);
+			if (!evaluate(ntoken,dval,thisval,inrec+1)) return false;
+			
+			if (thisval) {
+				if (iffast) {
+					runstats.setphase(RunStats::PHASE_FORMAT);
+					out.printf("%s\n",(char*)line);
 				}
+				else kept.add(dval);
+				nrec++;
 			}
 			inrec++;
-			
-			if (!(inrec%50000)) printf("%d ...\n",inrec);
 		}
 	}
+	progress.stop();
 	
 	// Slow mode
 	
@@ -1018,59 +1092,29 @@ bool readdata(xtring infile,xtring outfile,Item* items,int ntoken,int& nitem,int
 	
 		// Print header row
 		
+		runstats.setphase(RunStats::PHASE_FORMAT);
 		for (i=0;i<nitem;i++) {
 			items[i].compute_fmt();
-			if (i) fprintf(out,sep);
-			fprintf(out,items[i].lfmt,(char*)items[i].label);
-		}
-		fprintf(out,"\n");
-		
-		// Reread input file, printing data as we go
-		
-		rewind(in);
-		for (i=0;i<firstdata;i++) readfor(in,"");
-		
-		inrec=nrec=0;
-		
-		if (ifvalues) {
-		
-			if (!evaluate(ntoken,dval0,thisval,inrec+1)) return false;
-			if (thisval) {
-				for (i=0;i<nitem;i++) {
-					if (i) fprintf(out,sep);
-					fprintf(out,items[i].fmt,dval0[i]);
-				}
-				fprintf(out,"\n");
-				nrec++;
-			}
-			inrec++;
+			if (i) out.put(sep);
+			out.printf(items[i].lfmt,(char*)items[i].label);
 		}
+		out.put('\n');
 		
-		while (!feof(in)) {
+		// Write the rows kept
 		
-			// Read next record in file
-			
-			if (readrecord(in,line,dval,nitem,items,lineno,infile,iffast,false)) {
-	
-				if (!evaluate(ntoken,dval,thisval,inrec+1)) return false;
-					
-				if (thisval) {
-					for (i=0;i<nitem;i++) {
-						if (i) fprintf(out,sep);
-						fprintf(out,items[i].fmt,dval[i]);
-					}
-					fprintf(out,"\n");
-					nrec++;
-				}
-				inrec++;
-			
-				if (!(inrec%50000)) printf("%d ...\n",inrec);
+		kept.rewind();
+		while ((row=kept.next())) {
+			for (i=0;i<nitem;i++) {
+				if (i) out.put(sep);
+				out.put(row[i],items[i].nfmt);
 			}
+			out.put('\n');
 		}
 	}
 	
-	fclose(in);
-	fclose(out);
+	in.close();
+	out.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	return true;
 }
@@ -1121,6 +1165,12 @@ void helptext(FILE* out,xtring exe) {
 	fprintf(out,"    Tab-delimited output\n\n");
 	fprintf(out,"-fast\n");
 	fprintf(out,"    Fast mode\n\n");
+	fprintf(out,"-cache\n");
+	fprintf(out,"    Except in fast mode, read data rows from a binary cache of the input file\n");
+	fprintf(out,"    (<input-file>.gbin), which is created or brought up to date by parsing the\n");
+	fprintf(out,"    input file if necessary\n\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
 	fprintf(out,"-help\n");
 	fprintf(out,"    Displays this help message\n");
 }
@@ -1147,13 +1197,15 @@ void abort(xtring exe) {
 	printf("         -o <output-file>\n");
 	printf("         -tab\n");
 	printf("         -fast\n");
+	printf("         -cache\n");
+	printf("         -stats\n");
 	printf("         -help\n");
 
 	exit(99);
 }
 
 bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,xtring& expression,
-	bool& iffast,xtring& sep) {
+	bool& iffast,bool& ifcache,xtring& sep) {
 
 	int i;
 	xtring arg;
@@ -1164,6 +1216,7 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,xtring& ex
 	expression="1"; // include all data by default
 	sep=" ";
 	iffast=false;
+	ifcache=false;
 	
 	if (argc<2) {
 		printf("Input file name or path must be specified\n");
@@ -1194,6 +1247,7 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,xtring& ex
 				}
 				i+=1;
 			}
+			else if (arg=="-stats") runstats.enable();
 			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
 			else if (arg=="-tab") {
 				sep="\t";
@@ -1201,6 +1255,9 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,xtring& ex
 			else if (arg=="-fast") {
 				iffast=true;
 			}
+			else if (arg=="-cache") {
+				ifcache=true;
+			}
 			else {
 				printf("Invalid option %s\n",(char*)arg);
 				return false;
@@ -1237,9 +1294,9 @@ int main(int argc,char* argv[]) {
 	xtring infile,outfile,expression,header,sep;
 	Item items[MAXITEM];
 	int nitem,nrec,ntoken;
-	bool iffast;
+	bool iffast,ifcache;
 		
-	if (!processargs(argc,argv,infile,outfile,expression,iffast,sep)) abort(argv[0]);
+	if (!processargs(argc,argv,infile,outfile,expression,iffast,ifcache,sep)) abort(argv[0]);
 	
 	if (parse_expression(expression,ntoken)) { 
 	
@@ -1247,11 +1304,12 @@ int main(int argc,char* argv[]) {
 		header=(xtring)"[EXTRACT  "+header+"]\n\n";
 		printf("%s",(char*)header);
 	
-		if (readdata(infile,outfile,items,ntoken,nitem,nrec,iffast,sep)) {
+		if (readdata(infile,outfile,items,ntoken,nitem,nrec,iffast,ifcache,sep)) {
 			
 			printf("\n%d records written to %s\n\n",nrec,(char*)outfile);
 		} 
 	}
 		
+	runstats.print("extract");
 	return 0;
 }
@@ -19,6 +19,33 @@
 #include "gutil.h"
 
 #include <stdarg.h>
+#include <float.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <io.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 void fail() {
 
@@ -27,50 +54,48 @@ void fail() {
 	exit(99);
 }
 
-const unsigned long XEGMENT=32;
-
 void xtring::init() {
 
-	buf=NULL;
-	ptext=new char[XEGMENT];
-	if (!ptext) fail();
-	nxegment=1;
+	ptext=sso;
 	*ptext='\0';
 }
 
+void xtring::release() {
+
+	if (ptext!=sso) delete[] ptext;
+}
+
+void xtring::grow(unsigned long nbyte,unsigned long ncopy) {
+
+	// Moves the string to a heap buffer of at least nbyte bytes, keeping the
+	// first ncopy bytes of the current buffer. The capacity is at least
+	// doubled, so that building a string by repeated small expansions costs
+	// only a logarithmic number of reallocations
+
+	if (nbyte<2*bufsize()) nbyte=2*bufsize();
+	char* pnew=new char[nbyte];
+	if (!pnew) fail();
+	memcpy(pnew,ptext,ncopy);
+	release();
+	ptext=pnew;
+	capacity=nbyte;
+}
+
 void xtring::resize(unsigned long nchar) {
 
-	// Resizes character buffer pointed to by ptext if necessary to
+	// Enlarges character buffer pointed to by ptext if necessary to
 	// accomodate nchar characters, plus a \0
 
-	if (nchar<0) nchar=0;
-	nchar++;
-	if (nchar>nxegment*XEGMENT || (nxegment-1)*XEGMENT>=nchar) {
-		ptext[nxegment*XEGMENT-1]='\0';
-		unsigned long nxegment_old=nxegment;
-		nxegment=nchar/XEGMENT+!!(nchar%XEGMENT);
-		char* pnew=new char[nxegment*XEGMENT];
-		if (!pnew) fail();
-		if (nxegment>nxegment_old || strlen(ptext)<nxegment*XEGMENT) strcpy(pnew,ptext);
-		else pnew[nxegment*XEGMENT-1]='\0';
-		delete[] ptext;
-		ptext=pnew;
-	}
+	if (nchar>=bufsize()) grow(nchar+1,bufsize());
 }
 
 void xtring::expand(unsigned long nchar) {
 
-	if (nchar<0) nchar=0;
-	if (nchar>=nxegment*XEGMENT) {
-		nxegment=nchar/XEGMENT+1;
-		char* pnew=new char[nxegment*XEGMENT];
-		if (!pnew) fail();
-		unsigned long i;
-		for (i=0;i<nchar;i++)
-			pnew[i]=ptext[i];
-		pnew[i]='\0';
-		delete[] ptext;
-		ptext=pnew;
+	// Enlarges character buffer if necessary so that ptext[nchar] is valid
+
+	if (nchar>=bufsize()) {
+		grow(nchar+1,bufsize());
+		ptext[nchar]='\0';
 	}
 }
 
@@ -79,8 +104,24 @@ xtring::xtring(const xtring& s) {
 	// COPY CONSTRUCTOR
 
 	init();
-	resize(strlen(s.ptext));
-	strcpy(ptext,s.ptext);
+	unsigned long n=strlen(s.ptext);
+	resize(n);
+	memcpy(ptext,s.ptext,n+1);
+}
+
+xtring::xtring(xtring&& s) {
+
+	// MOVE CONSTRUCTOR: takes over the heap buffer of s, if any
+
+	if (s.ptext==s.sso) {
+		init();
+		memcpy(sso,s.sso,SSOSIZE);
+	}
+	else {
+		ptext=s.ptext;
+		capacity=s.capacity;
+		s.init();
+	}
 }
 
 xtring::xtring() {
@@ -88,7 +129,6 @@ xtring::xtring() {
 	// CONSTRUCTOR: xtring s;
 
 	init();
-	*ptext='\0';
 }
 
 xtring::xtring(char* inittext) {
@@ -96,8 +136,9 @@ xtring::xtring(char* inittext) {
 	// CONSTRUCTOR: xtring s="text";
 
 	init();
-	resize(strlen(inittext));
-	strcpy(ptext,inittext);
+	unsigned long n=strlen(inittext);
+	resize(n);
+	memcpy(ptext,inittext,n+1);
 }
 
 xtring::xtring(const char* inittext) {
@@ -105,8 +146,9 @@ xtring::xtring(const char* inittext) {
 	// CONSTRUCTOR: xtring s="text";
 
 	init();
-	resize(strlen(inittext));
-	strcpy(ptext,inittext);
+	unsigned long n=strlen(inittext);
+	resize(n);
+	memcpy(ptext,inittext,n+1);
 }
 
 xtring::xtring(char c) {
@@ -124,7 +166,6 @@ xtring::xtring(unsigned long n) {
 
 	init();
 	resize(n);
-	*ptext='\0';
 }
 
 xtring::xtring(int n) {
@@ -133,7 +174,6 @@ xtring::xtring(int n) {
 
 	init();
 	resize(n);
-	*ptext='\0';
 }
 
 xtring::xtring(unsigned int n) {
@@ -142,7 +182,6 @@ xtring::xtring(unsigned int n) {
 
 	init();
 	resize(n);
-	*ptext='\0';
 }
 
 xtring::xtring(long n) {
@@ -151,15 +190,13 @@ xtring::xtring(long n) {
 
 	init();
 	resize(n);
-	*ptext='\0';
 }
 
 xtring::~xtring() {
 
 	// DESTRUCTOR
 
-	if (buf) delete[] buf;
-	delete[] ptext;
+	release();
 }
 
 xtring::operator char*() {
@@ -195,113 +232,70 @@ xtring xtring::upper() {
 
 	// Upper case
 
-	if (buf) delete[] buf;
-	buf=new char[len()+1];
-	if (!buf) fail();
-	char* pold=ptext,*pnew=buf;
+	xtring result(len());
+	char* pold=ptext,*pnew=result.ptext;
 	do {
 		if (*pold>='a' && *pold<='z') *pnew=*pold-32;
 		else *pnew=*pold;
 		pnew++;
 	} while (*pold++);
-	return (xtring)buf;
+	return result;
 }
 
 xtring xtring::lower() {
 
 	// Lower case
 
-	if (buf) delete[] buf;
-	buf=new char[len()+1];
-	if (!buf) fail();
-	char* pold=ptext,*pnew=buf;
+	xtring result(len());
+	char* pold=ptext,*pnew=result.ptext;
 	do {
 		if (*pold>='A' && *pold<='Z') *pnew=*pold+32;
 		else *pnew=*pold;
 		pnew++;
 	} while (*pold++);
-	return (xtring)buf;
+	return result;
 }
 
 xtring xtring::printable() {
 
 	// Printable characters (ASCII code >=32)
 
-	if (buf) delete[] buf;
-	buf=new char[len()+1];
-	if (!buf) fail();
-	char* pold=ptext,*pnew=buf;
+	xtring result(len());
+	char* pold=ptext,*pnew=result.ptext;
 	while (*pold) {
 		if (*pold>=' ') *pnew++=*pold;
 		pold++;
 	}
 	*pnew='\0';
-	return (xtring)buf;
+	return result;
 }
 
 xtring xtring::left(unsigned long n) {
 
 	// Leftmost n characters
 
-	if (buf) delete[] buf;
-	if (n<=0) {
-		buf=new char[1];
-		if (!buf) fail();
-		*buf='\0';
-	}
-	else {
-		buf=new char[n+1];
-		if (!buf) fail();
-		char* pold=ptext,*pnew=buf;
-		unsigned long i=0;
-		while (i<n && *pold) {
-			*pnew=*pold;
-			pold++;
-			pnew++;
-			i++;
-		}
-		*pnew='\0';
-	}
-	return (xtring)buf;
+	return mid(0,n);
 }
 
 xtring xtring::mid(unsigned long s) {
 
 	// Rightmost portion of xtring, starting at character s
 
-	if (buf) delete[] buf;
-	if (s>=len()) {
-		buf=new char[1];
-		if (!buf) fail();
-		*buf='\0';
-	}
-	else {
-		buf=new char[len()-s+1];
-		if (!buf) fail();
-		strcpy(buf,ptext+s);
-	}
-	return (xtring)buf;
+	if (s>=len()) return xtring();
+	return xtring(ptext+s);
 }
 
 xtring xtring::mid(unsigned long s,unsigned long n) {
 
 	// Middle n characters starting at character s
 
-	if (buf) delete[] buf;
-	if (s>=len() || n<=0) {
-		buf=new char[1];
-		if (!buf) fail();
-		*buf='\0';
-	}
-	else {
-		buf=new char[n+1];
-		if (!buf) fail();
-		char* pold=ptext+s,*pnew=buf;
-		unsigned long i=0;
-		while (i++<n && *pold) *pnew++=*pold++;
-		*pnew='\0';
-	}
-	return (xtring)buf;
+	unsigned long length=len();
+	if (s>=length || n<=0) return xtring();
+	if (n>length-s) n=length-s;
+	xtring result(n);
+	memcpy(result.ptext,ptext+s,n);
+	result.ptext[n]='\0';
+	return result;
 }
 
 
@@ -319,15 +313,9 @@ long xtring::find(const char* s) {
 	// Find string s in this xtring
 	// (returns -1 if string does not occur)
 
-	long length=strlen(s);
-	long bound=len()-length;
-	long i=0;
-	while (i<=bound) {
-		xtring sub=mid(i,length);
-		if (sub==s) return i;
-		i++;
-	}
-	return -1;
+	const char* p=strstr(ptext,s);
+	if (!p) return -1;
+	return p-ptext;
 }
 
 long xtring::find(char c) {
@@ -401,119 +389,78 @@ char xtring::isnum() {
 
 void xtring::printf(const char* fmt,...) {
 
-	va_list v;
-	va_start(v,fmt);
+	// Formats to a local buffer first, so that the arguments may refer to
+	// the current contents of this xtring
 
-	const int MINBUF=100;
-	xtring sect;
-	xtring output="";
-	xtring fspec;
-	xtring wspec;
-	xtring buffer(MINBUF);
-	const char* pfmt=fmt;
-	char* pchar;
-	int i;
-	char waitspec=0,readspec=0,readwidth,havewidth;
+	const int MINBUF=256;
+	char local[MINBUF];
+	va_list v,v2;
+	int n;
 
-	i=0;
-	while (*pfmt) {
-		if (waitspec) {
-			if (*pfmt>='0' && *pfmt<='9' || *pfmt=='-' || *pfmt=='+' || *pfmt==' ' ||
-				*pfmt=='#' || *pfmt=='h' || *pfmt=='l' || *pfmt=='I' || *pfmt=='L' ||
-				*pfmt=='c' || *pfmt=='C' || *pfmt=='d' || *pfmt=='i' || *pfmt=='o' ||
-				*pfmt=='u' || *pfmt=='x' || *pfmt=='X' || *pfmt=='e' || *pfmt=='E' ||
-				*pfmt=='f' || *pfmt=='g' || *pfmt=='G' || *pfmt=='n' || *pfmt=='p' ||
-				*pfmt=='s' || *pfmt=='S' || *pfmt=='.') {
-				readspec=1;
-				havewidth=0;
-				readwidth=0;
-				wspec="0";
-				fspec="%";
-				pfmt--;
-			}
-			else output+=*pfmt;
-			waitspec=0;
-		}
-		else if (readspec) {
-			if (*pfmt!='*') fspec+=*pfmt;
-			if (readwidth) {
-				if (*pfmt>='0' && *pfmt<='9') wspec+=*pfmt;
-				else {
-					readwidth=0;
-					havewidth=1;
-				}
-			}
-			else if (*pfmt>='0' && *pfmt<='9' && !havewidth) {
-				wspec=*pfmt;
-				readwidth=1;
-			}
-			else if (*pfmt=='*' && !havewidth) {
-				wspec.reserve(MINBUF);
-				sprintf(wspec,"%d",va_arg(v,int));
-				fspec+=wspec;
-				havewidth=1;
-			}
-			else if (*pfmt!='-' && *pfmt!='+' && *pfmt!=' ' && *pfmt!='#') {
-				havewidth=1;
-			}
-			if (*pfmt=='c' || *pfmt=='C' || *pfmt=='d' || *pfmt=='i' || *pfmt=='o' ||
-				*pfmt=='u' || *pfmt=='x' || *pfmt=='X') {
-				buffer.reserve((unsigned long)(MINBUF+wspec.num()));
-				sprintf(buffer,fspec,va_arg(v,int));
-				output+=buffer;
-				readspec=0;
-			}
-			else if (*pfmt=='e' || *pfmt=='E' || *pfmt=='f' || *pfmt=='g' ||
-				*pfmt=='G') {
-				buffer.reserve((unsigned long)(MINBUF+wspec.num()));
-				sprintf(buffer,fspec,va_arg(v,double));
-				output+=buffer;
-				readspec=0;
-			}
-			else if (*pfmt=='p') {
-				buffer.reserve((unsigned long)(MINBUF+wspec.num()));
-				sprintf(buffer,fspec,va_arg(v,void*));
-				output+=buffer;
-				readspec=0;
-			}
-			else if (*pfmt=='s' || *pfmt=='S') {
-				pchar=va_arg(v,char*);
-				buffer.reserve((unsigned long)(strlen(pchar)+wspec.num()));
-				sprintf(buffer,fspec,pchar);
-				output+=buffer;
-				readspec=0;
-			}
-		}
-		else if (*pfmt=='%') waitspec=1;
-		else {
-			sect[i++]=*pfmt;
-			if (*(pfmt+1)=='%' || !*(pfmt+1)) {
-				sect[i]='\0';
-				output+=sect;
-				i=0;
-			}
-		}
-		pfmt++;
+	va_start(v,fmt);
+	va_copy(v2,v);
+	n=vsnprintf(local,MINBUF,fmt,v);
+	if (n<0) {
+		n=0;
+		*local='\0';
+	}
+	if (n<MINBUF) {
+		resize(n);
+		memcpy(ptext,local,n+1);
+	}
+	else {
+		char* pbuf=new char[n+1];
+		if (!pbuf) fail();
+		vsnprintf(pbuf,n+1,fmt,v2);
+		resize(n);
+		memcpy(ptext,pbuf,n+1);
+		delete[] pbuf;
 	}
-	resize(output.len());
-	strcpy(ptext,output);
+	va_end(v2);
+	va_end(v);
 }
 
 xtring& xtring::operator=(xtring& s) {
 
 	// Assignment: s1=s2;
 
-	resize(s.len());
-	strcpy(ptext,s.ptext);
+	if (&s!=this) {
+		unsigned long n=s.len();
+		resize(n);
+		memcpy(ptext,s.ptext,n+1);
+	}
+	return *this;
+}
+
+xtring& xtring::operator=(xtring&& s) {
+
+	// Move assignment: s1=s2+s3; takes over the heap buffer of s, if any
+
+	if (&s!=this) {
+		if (s.ptext==s.sso) {
+			unsigned long n=strlen(s.ptext);
+			resize(n);
+			memcpy(ptext,s.ptext,n+1);
+		}
+		else {
+			release();
+			ptext=s.ptext;
+			capacity=s.capacity;
+			s.init();
+		}
+	}
 	return *this;
 }
 
 xtring& xtring::operator=(const char* s) {
 
 	// Assignment: s="text"
+	// (s may point into the current buffer, which resize does not move
+	// unless s is too long to have come from it)
 
-	resize(strlen(s));
-	strcpy(ptext,s);
+	unsigned long n=strlen(s);
+	resize(n);
+	memmove(ptext,s,n+1);
 	return *this;
 }
 
@@ -521,7 +468,6 @@ xtring& xtring::operator=(char c) {
 
 	// Assignment: s='c'
 
-	resize(1);
 	ptext[0]=c;
 	ptext[1]='\0';
 	return *this;
@@ -531,48 +477,52 @@ xtring xtring::operator+(xtring& s2) {
 
 	// Concatenate: s1+s2
 
-	if (buf) delete[] buf;
-	buf=new char[len()+s2.len()+1];
-	if (!buf) fail();
-	strcpy(buf,ptext);
-	strcat(buf,s2.ptext);
-	return (xtring)buf;
+	return *this+s2.ptext;
 }
 
 xtring xtring::operator+(const char* s2) {
 
 	// Concatenate: s1+"text"
 
-	if (buf) delete[] buf;
-	buf=new char[len()+strlen(s2)+1];
-	if (!buf) fail();
-	strcpy(buf,ptext);
-	strcat(buf,s2);
-	return xtring(buf);
+	unsigned long n1=len(),n2=strlen(s2);
+	xtring result(n1+n2);
+	memcpy(result.ptext,ptext,n1);
+	memcpy(result.ptext+n1,s2,n2+1);
+	return result;
 }
 
 xtring xtring::operator+(char c) {
 
 	// Concatenate s1+'c'
 
-	return (xtring)ptext+(xtring)c;
+	xtring result(*this);
+	result+=c;
+	return result;
 }
 
 xtring& xtring::operator+=(xtring& s2) {
 
 	// Concatenate s1+=s2;
 
-	resize(len()+s2.len());
-	strcat(ptext,s2.ptext);
-	return *this;
+	return *this+=s2.ptext;
 }
 
 xtring& xtring::operator+=(const char* s2) {
 
 	// Concatenate s1+="text";
-
-	resize(len()+strlen(s2));
-	strcat(ptext,s2);
+	// (capacity grows geometrically, so repeated appends are amortised O(1)
+	// in the number of reallocations)
+
+	unsigned long n1=len(),n2=strlen(s2);
+	if (n1+n2>=bufsize()) {
+		if (s2>=ptext && s2<ptext+bufsize()) {
+			// Appending (part of) this xtring to itself
+			xtring copy(s2);
+			return *this+=copy.ptext;
+		}
+		grow(n1+n2+1,n1);
+	}
+	memmove(ptext+n1,s2,n2+1);
 	return *this;
 }
 
@@ -580,8 +530,10 @@ xtring& xtring::operator+=(char c) {
 
 	// Concatenate s1+='c';
 
-	resize(len()+1);
-	strcat(ptext,(xtring)c);
+	unsigned long n=len();
+	if (n+1>=bufsize()) grow(n+2,n);
+	ptext[n]=c;
+	ptext[n+1]='\0';
 	return *this;
 }
 
@@ -758,559 +710,850 @@ char xtring::operator>=(char c) const {
 }
 
 
-void unixtime(xtring& result) {
+RecordTable::RecordTable() {
 
-	time_t t;
-	time(&t);
-	result=ctime(&t);
-	result=result.left(result.findoneof("\n"));
+	values=weights=NULL;
+	ncol=0;
+	nrow=maxrow=0;
+}
+
+RecordTable::~RecordTable() {
+
+	clear();
+}
+
+void RecordTable::init(int ncolumn) {
+
+	clear();
+	ncol=ncolumn;
 }
 
+void RecordTable::clear() {
 
-FILE** pin;
-xtring inxtr;
-bool iseol=false;
-char cbuf;
+	if (values) delete[] values;
+	if (weights) delete[] weights;
+	values=weights=NULL;
+	nrow=maxrow=0;
+}
 
-inline char xgetc() {
+void RecordTable::grow() {
 
-	// Equivalent to getc(*pin), but returns character stored in cbuf (global)
-	// if there is one (see xungetc below)
+	// Doubles the number of rows allocated, moving each column to its place in
+	// the new block
 
-	char copy;
+	unsigned long newmax=maxrow?maxrow*2:1024;
+	double* newvalues=new double[newmax*(ncol?ncol:1)];
+	double* newweights=new double[newmax];
+	if (!newvalues || !newweights) fail();
 
-	if (cbuf) {
-		copy=cbuf;
-		cbuf=0;
-		return copy;
+	if (nrow) {
+		for (int c=0;c<ncol;c++)
+			memcpy(newvalues+c*newmax,values+c*maxrow,nrow*sizeof(double));
+		memcpy(newweights,weights,nrow*sizeof(double));
 	}
-	return getc(*pin);
+
+	if (values) delete[] values;
+	if (weights) delete[] weights;
+	values=newvalues;
+	weights=newweights;
+	maxrow=newmax;
 }
 
-inline void xungetc(char& ch) {
+unsigned long RecordTable::addrows(unsigned long n) {
+
+	unsigned long first=nrow;
 
-	// Equivalent to ungetc(ch,*pin), but assigns ch to cbuf instead of trying
-	// to push it back onto the stream (which may not be possible)
+	while (maxrow<nrow+n) grow();
+	for (int c=0;c<ncol;c++)
+		memset(values+c*maxrow+nrow,0,n*sizeof(double));
+	memset(weights+nrow,0,n*sizeof(double));
+	nrow+=n;
 
-	cbuf=ch;
+	return first;
 }
 
-inline bool xfeof() {
+void RecordTable::average() {
 
-	// Equivalent to feof(*pin), but returns false if character stored in cbuf
-	// even if feof(*pin)==true
+	unsigned long r;
+	int c;
 
-	if (feof(*pin) && !cbuf) return true;
-	return false;
+	for (c=0;c<ncol;c++) {
+		double* pval=values+c*maxrow;
+		for (r=0;r<nrow;r++)
+			if (weights[r]) pval[r]/=weights[r];
+	}
 }
 
-inline int readfixedwidth(int& width) {
 
-	// Reads the next 'width' characters from stream in
-	// Returns the number of characters successfully read (may be <width on eof)
 
-	int cread=0;
-	char ch;
+// Rows read back from the temporary file of a RowBuffer at a time
+const unsigned long ROWBUFFER_BLOCK=4096;
 
-	iseol=false;
+static void rowbuffererror(const char* what) {
 
-	inxtr.reserve(width);
-	if (xfeof()) {
-		inxtr[cread]='\0';
-		iseol=1;
-		return 0;
-	}
+	::printf("Error in GUTIL library: could not %s temporary file for buffered rows\n",what);
+	fprintf(stderr,"Error in GUTIL library: could not %s temporary file for buffered rows\n",what);
+	exit(99);
+}
 
-	while (cread<width) {
-		ch=xgetc();
-		if (xfeof() || ch=='\n') {
-			inxtr[cread]='\0';
-			iseol=1;
-			return cread;
-		}
-		inxtr[cread++]=ch;
-	}
-	inxtr[cread]='\0';
-	return cread;
+RowBuffer::RowBuffer() {
+
+	mem=readbuf=NULL;
+	spill=NULL;
+	nval=0;
+	nmem=maxmem=memlimit=0;
+	nrow=nread=0;
+	nreadbuf=readpos=0;
 }
 
-inline int readtoeol(bool breakcomma) {
+RowBuffer::~RowBuffer() {
 
-	// Reads to end of the current line or eof from stream in
-	// Returns number of characters read
+	clear();
+}
 
-	int cread=0;
-	char ch;
+void RowBuffer::init(int nvalue,unsigned long long maxmemory) {
 
-	iseol=false;
+	clear();
+	nval=nvalue;
+	memlimit=maxmemory/((nval?nval:1)*sizeof(double));
+	if (!memlimit) memlimit=1;
+}
 
-	do {
-		ch=xgetc();
-		if (xfeof() || ch=='\n') {
-			inxtr[cread]='\0';
-			iseol=true;
-			return cread;
-		}
-		else if (breakcomma && ch==',') {
-			inxtr[cread]='\0';
-			return cread;
-		}
-		inxtr[cread++]=ch;
-	} while (true);
+void RowBuffer::clear() {
+
+	if (mem) delete[] mem;
+	if (readbuf) delete[] readbuf;
+	if (spill) fclose(spill); // a file from tmpfile is removed when closed
+	mem=readbuf=NULL;
+	spill=NULL;
+	nmem=maxmem=0;
+	nrow=nread=0;
+	nreadbuf=readpos=0;
 }
 
-inline void readtocomma() {
+void RowBuffer::add(const double* values) {
 
-	// Reads to next comma or next non-white-space character,
-	// whichever comes first (newline or eof always terminates input)
+	// Rows go to memory until the limit is reached, and to the temporary
+	// file after that
 
-	char ch;
-	iseol=false;
+	unsigned long newmax;
+	double* newmem;
 
-	do {
-		ch=xgetc();
-		if (xfeof() || ch=='\n') {
-			iseol=true;
-			return;
+	if (nmem<memlimit) {
+		if (nmem==maxmem) {
+			newmax=maxmem?maxmem*2:1024;
+			if (newmax>memlimit) newmax=memlimit;
+			newmem=new double[newmax*(nval?nval:1)];
+			if (!newmem) fail();
+			if (nmem) memcpy(newmem,mem,nmem*nval*sizeof(double));
+			if (mem) delete[] mem;
+			mem=newmem;
+			maxmem=newmax;
 		}
-		if (ch==',') return;
-		if (ch!=' ' && ch!='\t') {
-			xungetc(ch);
-			return;
+		memcpy(mem+nmem*nval,values,nval*sizeof(double));
+		nmem++;
+	}
+	else {
+		if (!spill) {
+			spill=tmpfile();
+			if (!spill) rowbuffererror("create");
 		}
-	} while (true);
+		if (fwrite(values,sizeof(double),nval,spill)!=(size_t)nval) rowbuffererror("write to");
+	}
+	nrow++;
 }
 
-inline int readtowhitespace(bool& breakcomma) {
+void RowBuffer::rewind() {
 
-	// Reads to next space, tab, newline or eof from stream in
-	// Space or tab is not read in (returned to stream)
-	// Returns number of characters read
+	nread=0;
+	nreadbuf=readpos=0;
+	if (spill && fseek(spill,0,SEEK_SET)) rowbuffererror("read");
+}
 
-	int cread=0;
-	char ch;
+const double* RowBuffer::next() {
 
-	iseol=false;
+	if (nread==nrow) return NULL;
+	if (nread<nmem) return mem+(nread++)*nval;
 
-	do {
-		ch=xgetc();
-		if (xfeof() || ch=='\n') {
-			iseol=true;
-			inxtr[cread]='\0';
-			return cread;
-		}
-		if (breakcomma) {
-			if (ch==' ' || ch=='\t') {
-				inxtr[cread]='\0';
-				readtocomma();
-				return cread;
-			}
-			if (ch==',') {
-				inxtr[cread]='\0';
-				return cread;
-			}
-		}
-		else {
-			if (ch==' ' || ch=='\t') {
-				xungetc(ch);
-				inxtr[cread]='\0';
-				return cread;
-			}
+	if (readpos==nreadbuf) {
+		if (!readbuf) {
+			readbuf=new double[ROWBUFFER_BLOCK*nval];
+			if (!readbuf) fail();
 		}
-		inxtr[cread++]=ch;
-	} while (true);
+		nreadbuf=fread(readbuf,nval*sizeof(double),ROWBUFFER_BLOCK,spill);
+		if (!nreadbuf) rowbuffererror("read");
+		readpos=0;
+	}
+
+	nread++;
+	return readbuf+(readpos++)*nval;
 }
 
+CellIndex::CellIndex() {
 
-inline int readtochar(char sep) {
+	slots=NULL;
+	nslot=0;
+	lons=lats=NULL;
+	ncell=maxcell=0;
+	last=-1;
+}
 
-	// Reads to next instance of character 'sep'
-	// Character sep is lost to the stream, but not stored as part of the input string
-	// Newline or eof also terminate input
-	// Returns number of characters read
+CellIndex::~CellIndex() {
 
-	int cread=0;
-	char ch;
+	clear();
+}
 
-	iseol=false;
+void CellIndex::clear() {
 
-	do {
-		ch=xgetc();
-		if (xfeof() || ch=='\n') {
-			iseol=true;
-			inxtr[cread]='\0';
-			return cread;
-		}
-		if (ch==sep) {
-			inxtr[cread]='\0';
-			return cread;
-		}
-		inxtr[cread++]=ch;
-	} while (true);
+	if (slots) delete[] slots;
+	if (lons) delete[] lons;
+	if (lats) delete[] lats;
+	slots=NULL;
+	nslot=0;
+	lons=lats=NULL;
+	ncell=maxcell=0;
+	last=-1;
 }
 
-inline void skipwhitespace() {
+unsigned long CellIndex::hash(float lon,float lat) const {
 
-	// Reads to next non-white-space character
-	// Newline or eof also terminate input
+	// Coordinates rounded to hundredths of a degree (anything out of range,
+	// including NaN, goes to 0), mixed and reduced to a slot number
 
-	iseol=false;
-	char ch;
+	double qlon=lon*100.0+0.5,qlat=lat*100.0+0.5;
+	long ilon=(qlon>-2e9 && qlon<2e9)?(long)floor(qlon):0;
+	long ilat=(qlat>-2e9 && qlat<2e9)?(long)floor(qlat):0;
 
-	do {
-		ch=xgetc();
-		if (xfeof() || ch=='\n') {
-			iseol=true;
-			return;
-		}
-		if (ch!=' ' && ch!='\t') {
-			xungetc(ch);
-			return;
-		}
-	} while (true);
+	unsigned long long h=(unsigned long long)ilon*0x9E3779B97F4A7C15ULL;
+	h^=(unsigned long long)ilat+0x632BE59BD9B4E019ULL+(h<<6)+(h>>2);
+	h*=0xBF58476D1CE4E5B9ULL;
+	return (unsigned long)(h>>32)&(nslot-1);
 }
 
-bool readfloat(int nitem,int& width,int dec,int exp,char termch,double* parg) {
+int CellIndex::lookup(float lon,float lat) const {
 
-	int i,j,len;
-	char ch;
-	bool havesign;
-	bool negcard;
-	bool haveexpsign;
-	bool havedec;
-	bool haveexp;
-	bool negexp;
+	unsigned long i;
 
-	double cardpart;
-	double decpart;
-	double decmul;
-	double value;
-	int exppart;
-	int posdec;
-	int posexp;
+	if (!nslot) return -1;
 
-	bool breakcomma=termch==',';
+	// Linear probing: the cell, if present, lies between its home slot and
+	// the next empty slot
 
-	if (termch==',' || termch=='$') termch=0;
+	i=hash(lon,lat);
+	while (slots[i].cell>=0) {
+		if (slots[i].lon==lon && slots[i].lat==lat) {
+			last=slots[i].cell;
+			return slots[i].cell;
+		}
+		i=(i+1)&(nslot-1);
+	}
 
-	do {
+	return -1;
+}
 
-		if (xfeof()) return false;
+void CellIndex::rehash(unsigned long newslot) {
 
-		havesign=false;
-		negcard=false;
-		haveexpsign=false;
-		negexp=false;
-		havedec=false;
-		haveexp=false;
-		cardpart=0;
-		decpart=0;
-		decmul=1.0;
-		exppart=0;
+	// Reallocates the slots and inserts each cell afresh
 
-		if (width) {
-			readfixedwidth(width);
-		}
-		else { // no width specified, read to next white space or end of line
-			if (!iseol) skipwhitespace();
-			if (iseol) {
-				*parg++=0.0;
-				goto next;
-			}
-			if (termch) readtochar(termch);
-			else readtowhitespace(breakcomma);
-		}
+	unsigned long i;
+	int c;
 
-		len=inxtr.len();
+	if (slots) delete[] slots;
+	slots=new Slot[newslot];
+	if (!slots) fail();
+	nslot=newslot;
+	for (i=0;i<nslot;i++) slots[i].cell=-1;
 
-		if (dec>=0 || exp>=0) { // strip non-numeric characters from string
-			i=j=0;
-			ch=inxtr[j];
-			posdec=posexp=-1;
-			while (ch) {
-				if (ch=='e' || ch=='E') {
-					if (posexp<0) {
-						inxtr[i++]=inxtr[j++];
-						posexp=i;
-					}
-					else j++;
-				}
-				else if (ch=='.') {
-					if (posexp<0 && posdec<0) {
-						inxtr[i++]=inxtr[j++];
-						posdec=i;
-					}
-					else j++;
-				}
-				else if (ch=='-' || ch>='0' && ch<='9')
-					inxtr[i++]=inxtr[j++];
-				else j++;
-				ch=inxtr[j];
-			}
-			inxtr[i]='\0';
+	for (c=0;c<ncell;c++) {
+		i=hash(lons[c],lats[c]);
+		while (slots[i].cell>=0) i=(i+1)&(nslot-1);
+		slots[i].lon=lons[c];
+		slots[i].lat=lats[c];
+		slots[i].cell=c;
+	}
+}
 
-			len=inxtr.len();
-			if (exp>=0 && posexp<0 && posdec<len-exp) posexp=len-exp;
-			else posexp=len;
+void CellIndex::reserve(int n) {
 
-			if (dec>=0 && posdec<0) posdec=posexp-dec;
-			else posdec=posexp;
-		}
-		else posdec=posexp=len;
+	unsigned long newslot;
+	float* newlons;
+	float* newlats;
 
-		len=inxtr.len();
-		for (i=0;i<len;i++) {
-			ch=inxtr[i];
-			if (i<posdec) { // cardinal part
-				if (ch=='-' && !havesign) negcard=true;
-				else if (ch=='.' && !havedec && !haveexp) {
-					posdec=i+1;
-					if (posexp<posdec) posexp=posdec;
-					havedec=true;
-				}
-				else if (ch=='E' || ch=='e' && !haveexp) {
-					posexp=i+1;
-					posdec=i+1;
-					haveexp=true;
-				}
-				else if (ch>='0' && ch<='9') {
-					havesign=true;
-					cardpart=cardpart*10.0+(double)(ch-'0');
-				}
-			}
-			else if (i<posexp) { // decimal part
-				if (ch=='E' || ch=='e' && !haveexp) {
-					posexp=i+1;
-					posdec=i+1;
-					haveexp=true;
-				}
-				else if (ch>='0' && ch<='9') {
-					decmul/=10.0;
-					decpart+=(double)(ch-'0')*decmul;
-				}
-			}
-			else { // exponent part
-				if (ch=='-' && !haveexpsign) negexp=true;
-				else if (ch>='0' && ch<='9') {
-					haveexpsign=true;
-					exppart=exppart*10+(ch-'0');
-				}
-			}
+	if (n>maxcell) {
+		newlons=new float[n];
+		newlats=new float[n];
+		if (!newlons || !newlats) fail();
+		if (ncell) {
+			memcpy(newlons,lons,ncell*sizeof(float));
+			memcpy(newlats,lats,ncell*sizeof(float));
 		}
-		if (negcard)
-			value=-cardpart-decpart;
-		else
-			value=cardpart+decpart;
+		if (lons) delete[] lons;
+		if (lats) delete[] lats;
+		lons=newlons;
+		lats=newlats;
+		maxcell=n;
+	}
 
-		if (exppart) {
-			if (negexp)
-				inxtr.printf("1E-%d",exppart);
-			else
-				inxtr.printf("1E%d",exppart);
-			value*=inxtr.num();
-		}
-		*parg++=value;
-next:
-		nitem--;
-	} while (nitem>0);
-	return true;
+	// Slots are kept at most half full
+
+	newslot=nslot?nslot:64;
+	while (newslot<2*(unsigned long)n) newslot*=2;
+	if (newslot!=nslot) rehash(newslot);
 }
 
-bool readint(int& nitem,int& width,char termch,int* parg) {
+int CellIndex::add(float lon,float lat) {
 
-	bool havesign;
-	bool neg;
-	int value;
-	int len,i;
-	char ch;
+	unsigned long i;
 
-	bool breakcomma=termch==',';
+	if (ncell==maxcell) reserve(maxcell?maxcell*2:1024);
 
-	if (termch==',' || termch=='$') termch=0;
+	lons[ncell]=lon;
+	lats[ncell]=lat;
 
-	do {
+	i=hash(lon,lat);
+	while (slots[i].cell>=0) i=(i+1)&(nslot-1);
+	slots[i].lon=lon;
+	slots[i].lat=lat;
+	slots[i].cell=ncell;
 
-		if (xfeof()) return false;
-		havesign=false;
-		neg=false;
-		value=0;
+	last=ncell;
+	return ncell++;
+}
 
-		if (width) {
-			readfixedwidth(width);
-		}
-		else { // no width specified, read to next white space or end of line
-			if (!iseol) skipwhitespace();
-			if (iseol) {
-				*parg++=0;
-				goto next;
-			}
-			if (termch) readtochar(termch);
-			else readtowhitespace(breakcomma);
-		}
+QuantileSketch::QuantileSketch() {
 
-		len=inxtr.len();
-		for (i=0;i<len;i++) {
-			ch=inxtr[i];
-			if (ch=='-' && !havesign) {
-				havesign=true;
-				neg=true;
-			}
-			else if (ch>='0' && ch<='9') {
-				havesign=true;
-				value=value*10+ch-'0';
-			}
-		}
+	levels=NULL;
+	nval=maxval=NULL;
+	nlevel=0;
+	k=QUANTILESKETCH_K;
+	init(k);
+}
 
-		if (neg) value=-value;
+QuantileSketch::~QuantileSketch() {
 
-		*parg++=value;
-next:
-		nitem--;
-	} while (nitem>0);
+	clear();
+}
 
-	return true;
+void QuantileSketch::clear() {
+
+	int h;
+
+	for (h=0;h<nlevel;h++)
+		if (levels[h]) delete[] levels[h];
+	if (levels) delete[] levels;
+	if (nval) delete[] nval;
+	if (maxval) delete[] maxval;
+	levels=NULL;
+	nval=maxval=NULL;
+	nlevel=0;
+	count=0;
+	random=2463534242u; // fixed, so that results are reproducible
 }
 
-bool readchar(int nitem,int& width,char termch,xtring* parg,bool read_to_eol) {
+void QuantileSketch::init(int kvalue) {
 
-	bool nomulti=nitem>1 && width<0;
+	clear();
+	k=kvalue;
+	addlevel();
+}
 
-	bool breakcomma=termch==',';
+int QuantileSketch::capacity(int h) const {
 
-	if (termch==',' || termch=='$') termch=0;
+	// k for the top level, and 2/3 of the capacity of the level above for
+	// each level below it, but no less than 8
 
-	do {
-		if (xfeof()) return false;
+	const int MINCAP=8;
+	int h2,cap=k;
 
-		if (width) {
-			readfixedwidth(width);
-		}
-		else {
-			if (!iseol) skipwhitespace();
-			if (iseol) {
-				*parg++="";
-				goto next;
-			}
-			if (termch) readtochar(termch);
-			else if (read_to_eol) readtoeol(breakcomma);
-			else readtowhitespace(breakcomma);
-		}
+	if (!k) return 0x7fffffff;
 
-		*parg++=inxtr;
-next:
-		nitem--;
+	for (h2=nlevel-1;h2>h && cap>MINCAP;h2--) cap=cap*2/3;
+	return cap>MINCAP?cap:MINCAP;
+}
 
-		while (nomulti && nitem>0) {
-			// Disallow multiple strings if width not specified
-			// Set extra arguments to blank
+void QuantileSketch::reserve(int h,int n) {
 
-			*parg++="";
-		}
-	} while (nitem>0);
+	// Makes room for at least n values in level h
 
-	return true;
+	int newmax;
+	double* newlevel;
+
+	if (n<=maxval[h]) return;
+
+	newmax=maxval[h]?maxval[h]*2:8;
+	while (newmax<n) newmax*=2;
+	newlevel=new double[newmax];
+	if (!newlevel) fail();
+	if (nval[h]) memcpy(newlevel,levels[h],nval[h]*sizeof(double));
+	if (levels[h]) delete[] levels[h];
+	levels[h]=newlevel;
+	maxval[h]=newmax;
 }
 
+void QuantileSketch::addlevel() {
 
-bool readfor(FILE* in, const char* fmt, ...) {
+	double** newlevels=new double*[nlevel+1];
+	int* newnval=new int[nlevel+1];
+	int* newmaxval=new int[nlevel+1];
+	if (!newlevels || !newnval || !newmaxval) fail();
 
-	va_list v;
-	va_start(v,fmt);
+	if (nlevel) {
+		memcpy(newlevels,levels,nlevel*sizeof(double*));
+		memcpy(newnval,nval,nlevel*sizeof(int));
+		memcpy(newmaxval,maxval,nlevel*sizeof(int));
+		delete[] levels;
+		delete[] nval;
+		delete[] maxval;
+	}
+	newlevels[nlevel]=NULL;
+	newnval[nlevel]=newmaxval[nlevel]=0;
+
+	levels=newlevels;
+	nval=newnval;
+	maxval=newmaxval;
+	nlevel++;
+	cap0=capacity(0);
+}
 
-	bool waitwidth=false;
-	bool waitfloat=false;
-	bool waitdec=false;
-	bool waitexp=false;
-	bool waitint=false;
-	bool waitchar=false;
-	bool waitcomma=false;
-	bool croff=false;
-	bool read_to_eol=false;
-	const char* pchar = fmt;
-	int nitem=0;
-	int width=0;
-	int dec=0;
-	int exp=0;
-	iseol=false;
-	pin=&in;
+void QuantileSketch::compress() {
 
-	cbuf=0;
+	// Compacts each level over its capacity, from the bottom up (compacting a level
+	// adds values to the one above, and compacting the top level adds a new
+	// level and so lowers the capacities of the others)
 
-	while (*pchar) {
-		if (*pchar!=' ') {
-			if (*pchar!='$' && *pchar!='#') croff=read_to_eol=false;
-			else if (*pchar=='$') croff=true;
-			else if (*pchar=='#') read_to_eol=true;
-			if (waitwidth) {
-				if (*pchar>='0' && *pchar<='9') { // width specifier
-					width=width*10+*pchar-'0';
-				}
-				else if (*pchar=='.' && waitfloat) {
-					waitdec=true;
-					waitwidth=false;
-				}
-				else if (*pchar=='e' || *pchar=='E' && waitfloat) {
-					dec=0;
-					waitexp=true;
-					waitwidth=false;
-				}
-				else if (*pchar=='/') {
-					if (waitfloat) {
-						if (!readfloat(nitem,width,-1,-1,0,va_arg(v,double*))) return false;
-						waitfloat=false;
-						nitem=0;
-						width=0;
-					}
-					else if (waitint) {
-						if (!readint(nitem,width,0,va_arg(v,int*))) return false;
-						waitint=false;
-						nitem=0;
-						width=0;
-					}
-					else {
-						if (!readchar(nitem,width,0,va_arg(v,xtring*),read_to_eol)) return false;
-						waitchar=false;
-						nitem=0;
-						width=0;
-					}
-					if (!iseol) readtoeol(false);
-					iseol=false;
-					waitwidth=false;
-				}
-				else if (waitfloat) {
-					if (!readfloat(nitem,width,-1,-1,*pchar,va_arg(v,double*))) return false;
-					waitfloat=false;
-					waitwidth=false;
-					nitem=0;
-					width=0;
-				}
-				else if (waitint) {
-					if (!readint(nitem,width,*pchar,va_arg(v,int*))) return false;
-					waitint=false;
-					waitwidth=false;
-					nitem=0;
-					width=0;
-				}
-				else {
-					if (!readchar(nitem,width,*pchar,va_arg(v,xtring*),read_to_eol)) return false;
-					waitchar=false;
-					waitwidth=false;
-					nitem=0;
-					width=0;
-				}
-			}
-			else if (waitdec) {
-				if (*pchar>='0' && *pchar<='9') { // decimal places specifier
-					dec=dec*10+*pchar-'0';
-				}
-				else if (*pchar=='e' || *pchar=='E') {
-					waitexp=true;
-					waitdec=false;
-				}
+	int h;
+
+	for (h=0;h<nlevel;h++)
+		if (nval[h]>capacity(h)) compact(h);
+}
+
+void QuantileSketch::compact(int h) {
+
+	// Sorts level h and moves one value of each pair to level h+1, where it
+	// stands for both; with an odd number of values, the largest stays behind
+
+	int i,n,npair;
+	double* val;
+
+	if (h+1==nlevel) addlevel();
+
+	val=levels[h];
+	n=nval[h];
+	std::sort(val,val+n);
+	npair=n/2;
+
+	// Choosing the first or second value of the pairs at random (the same
+	// for all pairs) keeps the compactions from biasing the ranks up or down
+
+	random^=random<<13;
+	random^=random>>17;
+	random^=random<<5;
+
+	reserve(h+1,nval[h+1]+npair);
+	for (i=0;i<npair;i++) levels[h+1][nval[h+1]++]=val[2*i+(random&1)];
+
+	if (n%2) val[0]=val[n-1];
+	nval[h]=n%2;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+
+	// Appends each level of other to the same level here (where a value stands
+	// for as many values of the stream), then compacts any level now over its
+	// capacity
+
+	int h;
+
+	if (!other.count) return;
+
+	while (nlevel<other.nlevel) addlevel();
+
+	for (h=0;h<other.nlevel;h++) {
+		if (!other.nval[h]) continue;
+		reserve(h,nval[h]+other.nval[h]);
+		memcpy(levels[h]+nval[h],other.levels[h],other.nval[h]*sizeof(double));
+		nval[h]+=other.nval[h];
+	}
+	count+=other.count;
+
+	compress();
+}
+
+double QuantileSketch::quantile(double q) const {
+
+	// Each value stands for a block of consecutive ranks (2^h of them at level
+	// h); the value is placed at the middle of its block, and the quantile
+	// interpolated linearly between values at rank q*(count-1)
+
+	std::vector<std::pair<double,double> > val;
+	double pos,nextpos,target,w;
+	int h,i;
+	size_t j;
+
+	if (!count) return 0.0;
+
+	for (h=0,w=1.0;h<nlevel;h++,w*=2.0)
+		for (i=0;i<nval[h];i++) val.push_back(std::make_pair(levels[h][i],w));
+	std::sort(val.begin(),val.end());
+
+	if (q<0.0) q=0.0;
+	else if (q>1.0) q=1.0;
+	target=q*(double)(count-1);
+
+	pos=(val[0].second-1.0)/2.0;
+	if (target<=pos) return val[0].first;
+
+	for (j=1;j<val.size();j++) {
+		nextpos=pos+(val[j-1].second+val[j].second)/2.0;
+		if (target<=nextpos)
+			return val[j-1].first+(val[j].first-val[j-1].first)*(target-pos)/(nextpos-pos);
+		pos=nextpos;
+	}
+
+	return val.back().first;
+}
+
+unsigned long long Timer::nanotime() {
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+RunStats runstats;
+
+RunStats::RunStats() {
+
+	bytesread=rowsparsed=rowsblank=rowsnonnumeric=byteswritten=0;
+	timing=false;
+	current=PHASE_NONE;
+	start=last=0;
+	for (int i=0;i<NPHASE;i++) elapsed[i]=0;
+}
+
+void RunStats::enable() {
+
+	if (timing) return;
+	timing=true;
+	start=last=Timer::nanotime();
+}
+
+void RunStats::print(const char* tool) {
+
+	const char* name[NPHASE]={"other","header","read","aggregate","format","write"};
+	unsigned long long now;
+	double wall;
+	int i;
+
+	if (!timing) return;
+
+	now=Timer::nanotime();
+	elapsed[current]+=now-last;
+	last=now;
+	wall=(now-start)*1.0e-9;
+	if (wall<=0.0) wall=1.0e-9;
+
+	fprintf(stderr,"{\"tool\":\"%s\",\"wall_s\":%.6f,\"phase_s\":{",tool,wall);
+	for (i=PHASE_HEADER;i<NPHASE;i++)
+		fprintf(stderr,"\"%s\":%.6f,",name[i],elapsed[i]*1.0e-9);
+	fprintf(stderr,"\"%s\":%.6f},",name[PHASE_NONE],elapsed[PHASE_NONE]*1.0e-9);
+	fprintf(stderr,"\"bytes_read\":%llu,\"rows_parsed\":%llu,\"rows_blank\":%llu,"
+		"\"rows_nonnumeric\":%llu,\"bytes_written\":%llu,",
+		bytesread,rowsparsed,rowsblank,rowsnonnumeric,byteswritten);
+	fprintf(stderr,"\"rows_per_s\":%.6g,\"read_mb_per_s\":%.6g,\"write_mb_per_s\":%.6g}\n",
+		rowsparsed/wall,bytesread*1.0e-6/wall,byteswritten*1.0e-6/wall);
+}
+
+
+void unixtime(xtring& result) {
+
+	time_t t;
+	time(&t);
+	result=ctime(&t);
+	result=result.left(result.findoneof("\n"));
+}
+
+
+LineReader::LineReader() {
+
+	in=NULL;
+	mem=memend=NULL;
+	size=16384;
+	buf=new char[size];
+	if (!buf) fail();
+	reset();
+}
+
+LineReader::~LineReader() {
+
+	delete[] buf;
+}
+
+void LineReader::reset() {
+
+	pos=end=buf;
+	pushed=NULL;
+	haveline=false;
+	havenl=false;
+	ateof=false;
+	nread=0;
+}
+
+void LineReader::attach(FILE* strm) {
+
+	if (strm!=in || (ateof && !feof(strm))) reset();
+	in=strm;
+}
+
+void LineReader::attach(const char* begin,const char* end) {
+
+	in=NULL;
+	mem=begin;
+	memend=end;
+	reset();
+}
+
+bool LineReader::nextline() {
+
+	// Reads the next line of the stream into buf, growing buf as necessary.
+	// fgets stops after the newline, so the stream itself is left positioned at
+	// the start of the following line
+
+	unsigned long len=0,n;
+	char* pnew;
+
+	pushed=NULL;
+	if (ateof) return false;
+
+	if (!in) {
+
+		// Memory block: the line is used where it lies
+
+		if (mem>=memend) {
+			ateof=true;
+			return false;
+		}
+		pos=(char*)mem;
+		mem=(const char*)memchr(mem,'\n',memend-mem);
+		if (mem) {
+			havenl=true;
+			end=(char*)mem++;
+		}
+		else {
+			havenl=false;
+			mem=memend;
+			end=(char*)mem;
+		}
+		haveline=true;
+		return true;
+	}
+
+	while (fgets(buf+len,size-len,in)) {
+		n=strlen(buf+len);
+		len+=n;
+		if (len && buf[len-1]=='\n') {
+			nread+=len;
+			havenl=true;
+			pos=buf;
+			end=buf+len-1;
+			haveline=true;
+			return true;
+		}
+		if (feof(in)) break;
+		if (len+1>=size) {
+			pnew=new char[size*2];
+			if (!pnew) fail();
+			memcpy(pnew,buf,len);
+			delete[] buf;
+			buf=pnew;
+			size*=2;
+		}
+	}
+
+	if (!len) {
+		ateof=true;
+		return false;
+	}
+
+	// Last line of stream, not terminated by a newline
+
+	nread+=len;
+	havenl=false;
+	pos=buf;
+	end=buf+len;
+	haveline=true;
+	return true;
+}
+
+
+ReadFormat::ReadFormat() {
+
+	maxop=8;
+	ops=new Op[maxop];
+	if (!ops) fail();
+	nop=narg=0;
+	croff=false;
+}
+
+ReadFormat::ReadFormat(const char* fmt) {
+
+	maxop=8;
+	ops=new Op[maxop];
+	if (!ops) fail();
+	compile(fmt);
+}
+
+ReadFormat::~ReadFormat() {
+
+	delete[] ops;
+}
+
+void ReadFormat::add(optype type,int nitem,int width,int dec,int exp,char termch,
+	bool read_to_eol) {
+
+	Op* pnew;
+
+	if (nop==maxop) {
+		pnew=new Op[maxop*2];
+		if (!pnew) fail();
+		memcpy(pnew,ops,nop*sizeof(Op));
+		delete[] ops;
+		ops=pnew;
+		maxop*=2;
+	}
+
+	Op& op=ops[nop++];
+	op.type=type;
+	op.nitem=nitem;
+	op.width=width;
+	op.dec=dec;
+	op.exp=exp;
+	op.termch=termch;
+	op.read_to_eol=read_to_eol;
+	op.dest=NULL;
+	op.argno=-1;
+	op.offset=0;
+	if (type==OP_FLOAT || type==OP_INT || type==OP_CHAR) op.argno=narg++;
+}
+
+void ReadFormat::append(const Op& op,int nitem,int offset) {
+
+	// Adds a copy of operation op (which must not be one of ops) reading nitem
+	// items, the first of them into element offset of its destination
+
+	Op* pnew;
+
+	if (nop==maxop) {
+		pnew=new Op[maxop*2];
+		if (!pnew) fail();
+		memcpy(pnew,ops,nop*sizeof(Op));
+		delete[] ops;
+		ops=pnew;
+		maxop*=2;
+	}
+
+	ops[nop]=op;
+	ops[nop].nitem=nitem;
+	ops[nop].offset=offset;
+	if (op.dest) ops[nop].dest=(char*)op.dest+(offset-op.offset)*sizeof(double);
+	nop++;
+}
+
+void ReadFormat::compile(const char* fmt) {
+
+	// Interprets the format string in exactly the way readfor always has,
+	// recording a read operation wherever readfor would perform one
+
+	bool waitwidth=false;
+	bool waitfloat=false;
+	bool waitdec=false;
+	bool waitexp=false;
+	bool waitint=false;
+	bool waitchar=false;
+	bool waitcomma=false;
+	bool read_to_eol=false;
+	const char* pchar=fmt;
+	int nitem=0;
+	int width=0;
+	int dec=0;
+	int exp=0;
+
+	nop=narg=0;
+	croff=false;
+
+	while (*pchar) {
+		if (*pchar!=' ') {
+			if (*pchar!='$' && *pchar!='#') croff=read_to_eol=false;
+			else if (*pchar=='$') croff=true;
+			else if (*pchar=='#') read_to_eol=true;
+			if (waitwidth) {
+				if (*pchar>='0' && *pchar<='9') { // width specifier
+					width=width*10+*pchar-'0';
+				}
+				else if (*pchar=='.' && waitfloat) {
+					waitdec=true;
+					waitwidth=false;
+				}
+				else if (*pchar=='e' || *pchar=='E' && waitfloat) {
+					dec=0;
+					waitexp=true;
+					waitwidth=false;
+				}
+				else if (*pchar=='/') {
+					if (waitfloat) {
+						add(OP_FLOAT,nitem,width,-1,-1,0,false);
+						waitfloat=false;
+						nitem=0;
+						width=0;
+					}
+					else if (waitint) {
+						add(OP_INT,nitem,width,0,0,0,false);
+						waitint=false;
+						nitem=0;
+						width=0;
+					}
+					else {
+						add(OP_CHAR,nitem,width,0,0,0,read_to_eol);
+						waitchar=false;
+						nitem=0;
+						width=0;
+					}
+					add(OP_EOL,0,0,0,0,0,false);
+					waitwidth=false;
+				}
+				else if (waitfloat) {
+					add(OP_FLOAT,nitem,width,-1,-1,*pchar,false);
+					waitfloat=false;
+					waitwidth=false;
+					nitem=0;
+					width=0;
+				}
+				else if (waitint) {
+					add(OP_INT,nitem,width,0,0,*pchar,false);
+					waitint=false;
+					waitwidth=false;
+					nitem=0;
+					width=0;
+				}
+				else {
+					add(OP_CHAR,nitem,width,0,0,*pchar,read_to_eol);
+					waitchar=false;
+					waitwidth=false;
+					nitem=0;
+					width=0;
+				}
+			}
+			else if (waitdec) {
+				if (*pchar>='0' && *pchar<='9') { // decimal places specifier
+					dec=dec*10+*pchar-'0';
+				}
+				else if (*pchar=='e' || *pchar=='E') {
+					waitexp=true;
+					waitdec=false;
+				}
 				else if (*pchar=='/') {
-					if (!readfloat(nitem,width,dec,-1,0,va_arg(v,double*))) return false;
-					if (!iseol) readtoeol(false);
-					iseol=false;
+					add(OP_FLOAT,nitem,width,dec,-1,0,false);
+					add(OP_EOL,0,0,0,0,0,false);
 					waitdec=false;
 					waitfloat=false;
 					nitem=0;
@@ -1318,7 +1561,7 @@ bool readfor(FILE* in, const char* fmt, ...) {
 					dec=0;
 				}
 				else {
-					if (!readfloat(nitem,width,dec,-1,*pchar,va_arg(v,double*))) return false;
+					add(OP_FLOAT,nitem,width,dec,-1,*pchar,false);
 					waitdec=false;
 					waitfloat=false;
 					nitem=0;
@@ -1331,9 +1574,8 @@ bool readfor(FILE* in, const char* fmt, ...) {
 					exp=exp*10+*pchar-'0';
 				}
 				else if (*pchar=='/') {
-					if (!readfloat(nitem,width,dec,exp,0,va_arg(v,double*))) return false;
-					if (!iseol) readtoeol(false);
-					iseol=false;
+					add(OP_FLOAT,nitem,width,dec,exp,0,false);
+					add(OP_EOL,0,0,0,0,0,false);
 					waitexp=false;
 					waitfloat=false;
 					nitem=0;
@@ -1342,7 +1584,7 @@ bool readfor(FILE* in, const char* fmt, ...) {
 					exp=0;
 				}
 				else {
-					if (!readfloat(nitem,width,dec,exp,*pchar,va_arg(v,double*))) return false;
+					add(OP_FLOAT,nitem,width,dec,exp,*pchar,false);
 					waitexp=false;
 					waitfloat=false;
 					nitem=0;
@@ -1371,41 +1613,2865 @@ bool readfor(FILE* in, const char* fmt, ...) {
 					waitwidth=true;
 				}
 				else if (*pchar=='/') { // to end of line
-					readtoeol(false);
-					iseol=false;
+					add(OP_NEXTLINE,0,0,0,0,0,false);
 				}
 				else if (*pchar=='X' || *pchar=='x') { // skip characters
-					readfixedwidth(nitem);
+					add(OP_SKIP,nitem,0,0,0,0,false);
 					nitem=0;
 					waitcomma=true;
 				}
 				else if (*pchar!='$') { // take any other character (including a comma) as a separator specifier
-					readtochar(*pchar);
+					add(OP_TOCHAR,0,0,0,0,*pchar,false);
 				}
 			}
 		}
 		pchar++;
 	}
 	if (waitfloat) {
-		if (waitexp) {
-			if (!readfloat(nitem,width,dec,exp,0,va_arg(v,double*))) return false;
-		}
-		else if (waitdec) {
-			if (!readfloat(nitem,width,dec,-1,0,va_arg(v,double*))) return false;
+		if (waitexp)
+			add(OP_FLOAT,nitem,width,dec,exp,0,false);
+		else if (waitdec)
+			add(OP_FLOAT,nitem,width,dec,-1,0,false);
+		else
+			add(OP_FLOAT,nitem,width,-1,-1,0,false);
+	}
+	else if (waitint)
+		add(OP_INT,nitem,width,0,0,0,false);
+	else if (waitchar)
+		add(OP_CHAR,nitem,width,0,0,0,read_to_eol);
+}
+
+void ReadFormat::project(int nfield,const bool* need) {
+
+	// Splits the F operations reading free-format fields into runs of fields
+	// to be converted (still F) and runs to be passed over (OP_SKIPFIELD)
+
+	Op* old=ops;
+	int nold=nop;
+	int i,j,k,n,field=0;
+	bool keep;
+
+	ops=new Op[maxop];
+	if (!ops) fail();
+	nop=0;
+
+	for (i=0;i<nold;i++) {
+		const Op& op=old[i];
+		if (op.type!=OP_FLOAT || op.width || field<0) {
+			append(op,op.nitem,op.offset);
+			field=-1; // field numbers no longer known
+			continue;
 		}
-		else {
-			if (!readfloat(nitem,width,-1,-1,0,va_arg(v,double*))) return false;
+		n=op.nitem?op.nitem:1;
+		for (j=0;j<n;j=k) {
+			keep=field+j>=nfield || need[field+j];
+			for (k=j+1;k<n && (field+k>=nfield || need[field+k])==keep;k++);
+			append(op,k-j,op.offset+j);
+			if (!keep) ops[nop-1].type=OP_SKIPFIELD;
 		}
+		field+=n;
 	}
-	else if (waitint) {
-		if (!readint(nitem,width,0,va_arg(v,int*))) return false;
+
+	// The remainder of the line is discarded anyway after the last operation
+
+	if (!croff)
+		while (nop && ops[nop-1].type==OP_SKIPFIELD) nop--;
+
+	delete[] old;
+}
+
+void ReadFormat::bindarg(int argno,optype type,void* dest,int size) {
+
+	// Binds dest to each operation for F, I or A specifier number argno,
+	// which must be of the given type (an operation reading only part of the
+	// items of a specifier gets the address of its first item)
+
+	int i;
+	optype actual;
+	const char* name[]={"F","I","A"};
+
+	if (argno<0 || argno>=narg) {
+		::printf("Error in GUTIL library: format has no specifier %d\n",argno);
+		fprintf(stderr,"Error in GUTIL library: format has no specifier %d\n",argno);
+		exit(99);
 	}
-	else if (waitchar) {
-		if (!readchar(nitem,width,0,va_arg(v,xtring*),read_to_eol)) return false;
+
+	for (i=0;i<nop;i++) {
+		if (ops[i].argno==argno) {
+			actual=ops[i].type==OP_SKIPFIELD?OP_FLOAT:ops[i].type;
+			if (actual!=type) {
+				::printf("Error in GUTIL library: specifier %d of format is %s, not %s\n",
+					argno,name[actual],name[type]);
+				fprintf(stderr,"Error in GUTIL library: specifier %d of format is %s, not %s\n",
+					argno,name[actual],name[type]);
+				exit(99);
+			}
+			ops[i].dest=(char*)dest+ops[i].offset*size;
+		}
 	}
+}
 
-	if (!iseol && !croff) readtoeol(false);
-	return true;
+void ReadFormat::bind(int argno,double* dest) {
+
+	bindarg(argno,OP_FLOAT,dest,sizeof(double));
+}
+
+void ReadFormat::bind(int argno,int* dest) {
+
+	bindarg(argno,OP_INT,dest,sizeof(int));
+}
+
+void ReadFormat::bind(int argno,xtring* dest) {
+
+	bindarg(argno,OP_CHAR,dest,sizeof(xtring));
+}
+
+
+GuessReader::GuessReader() {
+
+	in=NULL;
+	iseol=false;
+	field=NULL;
+	fieldlen=0;
+}
+
+GuessReader::GuessReader(FILE* strm) {
+
+	in=NULL;
+	iseol=false;
+	field=NULL;
+	fieldlen=0;
+	attach(strm);
+}
+
+void GuessReader::attach(FILE* strm) {
+
+	in=strm;
+	linein.attach(strm);
+}
+
+void GuessReader::attach(const char* begin,const char* end) {
+
+	in=NULL;
+	linein.attach(begin,end);
+}
+
+void GuessReader::reset() {
+
+	iseol=false;
+	linein.reset();
+}
+
+int GuessReader::readfixedwidth(int& width) {
+
+	// Reads the next 'width' characters from stream in
+	// Returns the number of characters successfully read (may be <width on eof)
+
+	int avail;
+
+	iseol=false;
+	fieldlen=0;
+
+	if (linein.ateof) {
+		iseol=true;
+		return 0;
+	}
+	if (width<=0) return 0;
+	if (!linein.fill()) {
+		iseol=true;
+		return 0;
+	}
+
+	field=linein.pos;
+	avail=linein.end-linein.pos;
+	if (avail>=width) {
+		fieldlen=width;
+		linein.pos+=width;
+		return width;
+	}
+
+	fieldlen=avail;
+	linein.pos=linein.end;
+	linein.takeeol();
+	iseol=true;
+	return fieldlen;
+}
+
+int GuessReader::readtoeol(bool breakcomma) {
+
+	// Reads to end of the current line or eof from stream in
+	// Returns number of characters read
+
+	const char* pchar;
+
+	iseol=false;
+	fieldlen=0;
+
+	if (!linein.fill()) {
+		iseol=true;
+		return 0;
+	}
+
+	field=linein.pos;
+	if (breakcomma) {
+		pchar=(const char*)memchr(linein.pos,',',linein.end-linein.pos);
+		if (pchar) {
+			fieldlen=pchar-field;
+			linein.pos+=fieldlen+1;
+			return fieldlen;
+		}
+	}
+
+	fieldlen=linein.end-linein.pos;
+	linein.pos=linein.end;
+	linein.takeeol();
+	iseol=true;
+	return fieldlen;
+}
+
+void GuessReader::readtocomma() {
+
+	// Reads to next comma or next non-white-space character,
+	// whichever comes first (newline or eof always terminates input)
+
+	iseol=false;
+
+	if (!linein.fill()) {
+		iseol=true;
+		return;
+	}
+
+	while (linein.pos<linein.end && (*linein.pos==' ' || *linein.pos=='\t')) linein.pos++;
+
+	if (linein.pos==linein.end) {
+		linein.takeeol();
+		iseol=true;
+	}
+	else if (*linein.pos==',') linein.pos++;
+	else linein.pushed=linein.pos;
+}
+
+int GuessReader::readtowhitespace(bool& breakcomma) {
+
+	// Reads to next space, tab, newline or eof from stream in
+	// Space or tab is not read in (returned to stream)
+	// Returns number of characters read
+
+	char* pchar;
+
+	iseol=false;
+	fieldlen=0;
+
+	if (!linein.fill()) {
+		iseol=true;
+		return 0;
+	}
+
+	field=pchar=linein.pos;
+	while (pchar<linein.end && *pchar!=' ' && *pchar!='\t' && (*pchar!=',' || !breakcomma))
+		pchar++;
+	fieldlen=pchar-field;
+
+	if (pchar==linein.end) {
+		linein.pos=linein.end;
+		linein.takeeol();
+		iseol=true;
+	}
+	else if (breakcomma) {
+		linein.pos=pchar+1;
+		if (*pchar!=',') readtocomma();
+	}
+	else {
+		linein.pos=pchar;
+		linein.pushed=pchar;
+	}
+
+	return fieldlen;
+}
+
+
+int GuessReader::readtochar(char sep) {
+
+	// Reads to next instance of character 'sep'
+	// Character sep is lost to the stream, but not stored as part of the input string
+	// Newline or eof also terminate input
+	// Returns number of characters read
+
+	const char* pchar;
+
+	iseol=false;
+	fieldlen=0;
+
+	if (!linein.fill()) {
+		iseol=true;
+		return 0;
+	}
+
+	field=linein.pos;
+	pchar=(const char*)memchr(linein.pos,sep,linein.end-linein.pos);
+	if (pchar) {
+		fieldlen=pchar-field;
+		linein.pos+=fieldlen+1;
+		return fieldlen;
+	}
+
+	fieldlen=linein.end-linein.pos;
+	linein.pos=linein.end;
+	linein.takeeol();
+	iseol=true;
+	return fieldlen;
+}
+
+void GuessReader::skipwhitespace() {
+
+	// Reads to next non-white-space character
+	// Newline or eof also terminate input
+
+	iseol=false;
+
+	if (!linein.fill()) {
+		iseol=true;
+		return;
+	}
+
+	while (linein.pos<linein.end && (*linein.pos==' ' || *linein.pos=='\t')) linein.pos++;
+
+	if (linein.pos==linein.end) {
+		linein.takeeol();
+		iseol=true;
+	}
+	else linein.pushed=linein.pos;
+}
+
+// Exactly representable powers of ten for the fast path of parsefloat
+const double POW10[]={1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,
+	1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+bool parsefloat(const char* text,int len,double& value) {
+
+	// Converts the len characters at text to a double without copying or
+	// allocating. If the significand fits in 53 bits and the power of ten is
+	// exactly representable, a single IEEE multiplication or division gives the
+	// correctly rounded result (Clinger's fast path); other well-formed numbers
+	// are passed to strtod
+
+	const unsigned long long MAXMANT=1000000000000000000ULL; // 10^18
+	const unsigned long long MAXEXACT=9007199254740992ULL; // 2^53
+
+	const char* pchar=text;
+	const char* pend=text+len;
+	const char* pstart;
+	unsigned long long mant=0;
+	int exp10=0,expval=0,ndigit=0;
+	bool neg=false,negexp=false;
+	char buffer[64];
+	char* pbuf;
+	double dval;
+
+	while (pchar<pend && (*pchar==' ' || *pchar=='\t')) pchar++;
+	while (pend>pchar && (pend[-1]==' ' || pend[-1]=='\t' || pend[-1]=='\r')) pend--;
+	if (pchar==pend) return false;
+
+	pstart=pchar;
+	if (*pchar=='-' || *pchar=='+') neg=*pchar++=='-';
+
+	while (pchar<pend && *pchar>='0' && *pchar<='9') {
+		if (mant<MAXMANT) mant=mant*10+(*pchar-'0');
+		else exp10++;
+		ndigit++;
+		pchar++;
+	}
+	if (pchar<pend && *pchar=='.') {
+		pchar++;
+		while (pchar<pend && *pchar>='0' && *pchar<='9') {
+			if (mant<MAXMANT) {
+				mant=mant*10+(*pchar-'0');
+				exp10--;
+			}
+			ndigit++;
+			pchar++;
+		}
+	}
+	if (!ndigit) return false;
+
+	if (pchar<pend && (*pchar=='e' || *pchar=='E')) {
+		pchar++;
+		if (pchar<pend && (*pchar=='-' || *pchar=='+')) negexp=*pchar++=='-';
+		if (pchar==pend) return false;
+		while (pchar<pend && *pchar>='0' && *pchar<='9') {
+			if (expval<100000) expval=expval*10+(*pchar-'0');
+			pchar++;
+		}
+	}
+	if (pchar!=pend) return false;
+
+	if (negexp) exp10-=expval;
+	else exp10+=expval;
+
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD==0
+	if (mant<=MAXEXACT && exp10>=-22 && exp10<=22) {
+		dval=(double)mant;
+		if (exp10<0) dval/=POW10[-exp10];
+		else dval*=POW10[exp10];
+		value=neg ? -dval : dval;
+		return true;
+	}
+#endif
+
+	if (!mant) {
+		value=neg ? -0.0 : 0.0;
+		return true;
+	}
+
+	// Long significand or large exponent: correct rounding needs strtod
+
+	len=pend-pstart;
+	if (len<(int)sizeof(buffer)) pbuf=buffer;
+	else pbuf=new char[len+1];
+	if (!pbuf) fail();
+	memcpy(pbuf,pstart,len);
+	pbuf[len]='\0';
+	value=strtod(pbuf,NULL);
+	if (pbuf!=buffer) delete[] pbuf;
+
+	return true;
+}
+
+void scannumber(const char* text,int len,ScannedItem& item) {
+
+	// Counts digits as the programs' scanitem does, then converts the item,
+	// leaving anything parsefloat cannot take (e.g. blanks, hexadecimal,
+	// infinity) for strtod to accept or reject as a whole
+
+	const char* pchar=text;
+	const char* pend=text+len;
+	bool ifdecimal=false;
+	char buffer[64];
+	char* pbuf;
+	char* endptr;
+	char ch;
+
+	item.places=item.digits=0;
+	item.ifsign=false;
+	item.ifplain=true;
+
+	while (pchar<pend) {
+		ch=*pchar++;
+		if (ch>='0' && ch<='9') {
+			if (ifdecimal) item.places++;
+			else item.digits++;
+		}
+		else if ((ch=='-' || ch=='+') && !item.ifsign) item.ifsign=true;
+		else if (ch=='.' && !ifdecimal) ifdecimal=true;
+		else {
+			item.ifplain=false;
+			break;
+		}
+	}
+
+	item.isnum=true;
+	if (!len) item.value=0.0;
+	else if (text[0]>' ' && pend[-1]>' ' && parsefloat(text,len,item.value)) return;
+	else {
+		if (len<(int)sizeof(buffer)) pbuf=buffer;
+		else pbuf=new char[len+1];
+		if (!pbuf) fail();
+		memcpy(pbuf,text,len);
+		pbuf[len]='\0';
+		item.value=strtod(pbuf,&endptr);
+		if (*endptr) {
+			item.value=0.0;
+			item.isnum=false;
+		}
+		if (pbuf!=buffer) delete[] pbuf;
+	}
+}
+
+bool GuessReader::readfloat(int nitem,int& width,int dec,int exp,char termch,double* parg) {
+
+	int i,j,len;
+	char ch;
+	bool havesign;
+	bool negcard;
+	bool haveexpsign;
+	bool havedec;
+	bool haveexp;
+	bool negexp;
+
+	double cardpart;
+	double decpart;
+	double decmul;
+	double value;
+	int exppart;
+	int posdec;
+	int posexp;
+	const char* text;
+	char* ptext;
+	char expbuf[16];
+
+	bool breakcomma=termch==',';
+
+	if (termch==',' || termch=='$') termch=0;
+
+	do {
+
+		if (linein.ateof) return false;
+
+		havesign=false;
+		negcard=false;
+		haveexpsign=false;
+		negexp=false;
+		havedec=false;
+		haveexp=false;
+		cardpart=0;
+		decpart=0;
+		decmul=1.0;
+		exppart=0;
+
+		if (width) {
+			readfixedwidth(width);
+		}
+		else { // no width specified, read to next white space or end of line
+			if (!iseol) skipwhitespace();
+			if (iseol) {
+				*parg++=0.0;
+				goto next;
+			}
+			if (termch) readtochar(termch);
+			else readtowhitespace(breakcomma);
+		}
+
+		// Plain numbers (the usual case) are converted directly from the
+		// input buffer; anything else gets the lenient FORTRAN-style treatment
+
+		if (dec<0 && exp<0 && parsefloat(field,fieldlen,value)) {
+			*parg++=value;
+			goto next;
+		}
+
+		text=field;
+		len=fieldlen;
+
+		if (dec>=0 || exp>=0) { // strip non-numeric characters from string
+			inxtr.reserve(len);
+			ptext=(char*)inxtr;
+			i=j=0;
+			posdec=posexp=-1;
+			while (j<len) {
+				ch=text[j++];
+				if (ch=='e' || ch=='E') {
+					if (posexp<0) {
+						ptext[i++]=ch;
+						posexp=i;
+					}
+				}
+				else if (ch=='.') {
+					if (posexp<0 && posdec<0) {
+						ptext[i++]=ch;
+						posdec=i;
+					}
+				}
+				else if (ch=='-' || ch>='0' && ch<='9')
+					ptext[i++]=ch;
+			}
+			ptext[i]='\0';
+
+			text=ptext;
+			len=i;
+			if (exp>=0 && posexp<0 && posdec<len-exp) posexp=len-exp;
+			else posexp=len;
+
+			if (dec>=0 && posdec<0) posdec=posexp-dec;
+			else posdec=posexp;
+		}
+		else posdec=posexp=len;
+
+		for (i=0;i<len;i++) {
+			ch=text[i];
+			if (i<posdec) { // cardinal part
+				if (ch=='-' && !havesign) negcard=true;
+				else if (ch=='.' && !havedec && !haveexp) {
+					posdec=i+1;
+					if (posexp<posdec) posexp=posdec;
+					havedec=true;
+				}
+				else if (ch=='E' || ch=='e' && !haveexp) {
+					posexp=i+1;
+					posdec=i+1;
+					haveexp=true;
+				}
+				else if (ch>='0' && ch<='9') {
+					havesign=true;
+					cardpart=cardpart*10.0+(double)(ch-'0');
+				}
+			}
+			else if (i<posexp) { // decimal part
+				if (ch=='E' || ch=='e' && !haveexp) {
+					posexp=i+1;
+					posdec=i+1;
+					haveexp=true;
+				}
+				else if (ch>='0' && ch<='9') {
+					decmul/=10.0;
+					decpart+=(double)(ch-'0')*decmul;
+				}
+			}
+			else { // exponent part
+				if (ch=='-' && !haveexpsign) negexp=true;
+				else if (ch>='0' && ch<='9') {
+					haveexpsign=true;
+					exppart=exppart*10+(ch-'0');
+				}
+			}
+		}
+		if (negcard)
+			value=-cardpart-decpart;
+		else
+			value=cardpart+decpart;
+
+		if (exppart) {
+			if (negexp)
+				sprintf(expbuf,"1E-%d",exppart);
+			else
+				sprintf(expbuf,"1E%d",exppart);
+			value*=strtod(expbuf,NULL);
+		}
+		*parg++=value;
+next:
+		nitem--;
+	} while (nitem>0);
+	return true;
+}
+
+bool GuessReader::readint(int& nitem,int& width,char termch,int* parg) {
+
+	bool havesign;
+	bool neg;
+	int value;
+	int len,i;
+	char ch;
+
+	bool breakcomma=termch==',';
+
+	if (termch==',' || termch=='$') termch=0;
+
+	do {
+
+		if (linein.ateof) return false;
+		havesign=false;
+		neg=false;
+		value=0;
+
+		if (width) {
+			readfixedwidth(width);
+		}
+		else { // no width specified, read to next white space or end of line
+			if (!iseol) skipwhitespace();
+			if (iseol) {
+				*parg++=0;
+				goto next;
+			}
+			if (termch) readtochar(termch);
+			else readtowhitespace(breakcomma);
+		}
+
+		len=fieldlen;
+		for (i=0;i<len;i++) {
+			ch=field[i];
+			if (ch=='-' && !havesign) {
+				havesign=true;
+				neg=true;
+			}
+			else if (ch>='0' && ch<='9') {
+				havesign=true;
+				value=value*10+ch-'0';
+			}
+		}
+
+		if (neg) value=-value;
+
+		*parg++=value;
+next:
+		nitem--;
+	} while (nitem>0);
+
+	return true;
+}
+
+void GuessReader::assignfield(xtring& dest) {
+
+	// Assigns the current field to an xtring
+	// (the input may be read-only, e.g. a mapped file, so is not written to)
+
+	dest.reserve(fieldlen);
+	char* pchar=(char*)dest;
+	memcpy(pchar,field,fieldlen);
+	pchar[fieldlen]='\0';
+}
+
+bool GuessReader::readchar(int nitem,int& width,char termch,xtring* parg,bool read_to_eol) {
+
+	bool nomulti=nitem>1 && width<0;
+
+	bool breakcomma=termch==',';
+
+	if (termch==',' || termch=='$') termch=0;
+
+	do {
+		if (linein.ateof) return false;
+
+		if (width) {
+			readfixedwidth(width);
+		}
+		else {
+			if (!iseol) skipwhitespace();
+			if (iseol) {
+				*parg++="";
+				goto next;
+			}
+			if (termch) readtochar(termch);
+			else if (read_to_eol) readtoeol(breakcomma);
+			else readtowhitespace(breakcomma);
+		}
+
+		assignfield(*parg++);
+next:
+		nitem--;
+
+		while (nomulti && nitem>0) {
+			// Disallow multiple strings if width not specified
+			// Set extra arguments to blank
+
+			*parg++="";
+		}
+	} while (nitem>0);
+
+	return true;
+}
+
+
+bool GuessReader::read(const char* fmt, ...) {
+
+	va_list v;
+	va_start(v,fmt);
+	bool ok=vread(fmt,v);
+	va_end(v);
+	return ok;
+}
+
+bool GuessReader::vread(const char* fmt,va_list& v) {
+
+	// Compiles the format into a reusable member object (no allocation once it
+	// is large enough) and binds the arguments in order
+
+	int i;
+
+	vformat.compile(fmt);
+	for (i=0;i<vformat.nop;i++) {
+		ReadFormat::Op& op=vformat.ops[i];
+		if (op.type==ReadFormat::OP_FLOAT) op.dest=va_arg(v,double*);
+		else if (op.type==ReadFormat::OP_INT) op.dest=va_arg(v,int*);
+		else if (op.type==ReadFormat::OP_CHAR) op.dest=va_arg(v,xtring*);
+	}
+
+	return read(vformat);
+}
+
+bool GuessReader::readline(xtring& text) {
+
+	if (in) linein.attach(in);
+	linein.pushed=NULL;
+	iseol=false;
+
+	if (!linein.fill()) {
+		text="";
+		return false;
+	}
+	field=linein.pos;
+	fieldlen=linein.end-linein.pos;
+	assignfield(text);
+	linein.pos=linein.end;
+	linein.takeeol();
+	return true;
+}
+
+bool GuessReader::skipfields(int nitem,char termch) {
+
+	// Passes over nitem fields exactly as readfloat would read them without
+	// a width, but only scanning for the end of each field
+
+	bool breakcomma=termch==',';
+
+	if (termch==',' || termch=='$') termch=0;
+
+	do {
+		if (linein.ateof) return false;
+		if (!iseol) skipwhitespace();
+		if (!iseol) {
+			if (termch) readtochar(termch);
+			else readtowhitespace(breakcomma);
+		}
+		nitem--;
+	} while (nitem>0);
+	return true;
+}
+
+bool GuessReader::read(const ReadFormat& format) {
+
+	int i,nitem,width;
+
+	iseol=false;
+	if (in) linein.attach(in); // notices a rewind since the last call
+
+	// A character returned to the stream at the end of the previous call
+	// (possible only with a $ specifier) is discarded, as with getc/ungetc input
+
+	if (linein.pushed && linein.pushed==linein.pos) linein.pos++;
+	linein.pushed=NULL;
+
+	for (i=0;i<format.nop;i++) {
+		const ReadFormat::Op& op=format.ops[i];
+		nitem=op.nitem;
+		width=op.width;
+		switch (op.type) {
+			case ReadFormat::OP_FLOAT:
+				if (!readfloat(nitem,width,op.dec,op.exp,op.termch,(double*)op.dest)) return false;
+				break;
+			case ReadFormat::OP_INT:
+				if (!readint(nitem,width,op.termch,(int*)op.dest)) return false;
+				break;
+			case ReadFormat::OP_CHAR:
+				if (!readchar(nitem,width,op.termch,(xtring*)op.dest,op.read_to_eol)) return false;
+				break;
+			case ReadFormat::OP_SKIP:
+				readfixedwidth(nitem);
+				break;
+			case ReadFormat::OP_TOCHAR:
+				readtochar(op.termch);
+				break;
+			case ReadFormat::OP_EOL:
+				if (!iseol) readtoeol(false);
+				iseol=false;
+				break;
+			case ReadFormat::OP_NEXTLINE:
+				readtoeol(false);
+				iseol=false;
+				break;
+			case ReadFormat::OP_SKIPFIELD:
+				if (!skipfields(nitem,op.termch)) return false;
+				break;
+		}
+	}
+
+	if (!iseol && !format.croff) readtoeol(false);
+	return true;
+}
+
+// Reader shared by all callers of readfor (not thread safe)
+GuessReader stdreader;
+
+bool readfor(FILE* in, const char* fmt, ...) {
+
+	va_list v;
+	va_start(v,fmt);
+	stdreader.attach(in);
+	bool ok=stdreader.vread(fmt,v);
+	va_end(v);
+	return ok;
+}
+
+bool readfor(FILE* in,const ReadFormat& format) {
+
+	stdreader.attach(in);
+	return stdreader.read(format);
+}
+
+
+enum {COMP_NONE,COMP_GZIP,COMP_ZSTD};
+
+const unsigned long ZBUFSIZE=1<<18;
+	// Size of the blocks of compressed and uncompressed data handled by a
+	// Compressor or Decompressor
+
+static int compression(FILE* in) {
+
+	// Identifies the compression format of a file by its first bytes. Only
+	// seekable streams are examined, since the bytes must be read again
+
+	unsigned char magic[4];
+	size_t n;
+
+	if (fseek(in,0,SEEK_SET)) return COMP_NONE;
+	n=fread(magic,1,4,in);
+	fseek(in,0,SEEK_SET);
+
+	if (n>=2 && magic[0]==0x1f && magic[1]==0x8b) return COMP_GZIP;
+	if (n==4 && magic[0]==0x28 && magic[1]==0xb5 && magic[2]==0x2f && magic[3]==0xfd)
+		return COMP_ZSTD;
+	return COMP_NONE;
+}
+
+
+static bool supported(int format) {
+
+	// Whether the library was compiled with support for a compression format
+
+#ifdef HAVE_ZLIB
+	if (format==COMP_GZIP) return true;
+#endif
+#ifdef HAVE_ZSTD
+	if (format==COMP_ZSTD) return true;
+#endif
+	return format==COMP_NONE;
+}
+
+static bool makepipe(int fd[2]) {
+
+	// Creates a pipe for text passed between the reading or writing thread
+	// and a Compressor or Decompressor
+
+#ifdef _WIN32
+	if (_pipe(fd,ZBUFSIZE,_O_BINARY)) return false;
+#else
+	if (pipe(fd)) return false;
+#ifdef F_SETPIPE_SZ
+	fcntl(fd[1],F_SETPIPE_SZ,ZBUFSIZE); // fewer switches between threads
+#endif
+#endif
+	return true;
+}
+
+struct Decompressor {
+
+	// Decompresses a file on a background thread into a pipe, from which the
+	// text is read by the InputFile
+
+	FILE* src;                ///< compressed file
+	int format;               ///< compression format (COMP_GZIP or COMP_ZSTD)
+	xtring filename;
+	int fdout;                ///< write end of the pipe
+	std::thread worker;
+	std::atomic<bool> stop;   ///< set to make the worker quit early
+	xtring error;             ///< description of any error in the compressed data
+	unsigned long base;       ///< position in the decompressed text of the last reset
+	std::atomic<unsigned long long> srcread; ///< compressed bytes read from src
+
+	Decompressor(FILE* src,int format,const char* filename) {
+		this->src=src;
+		this->format=format;
+		this->filename=filename;
+		fdout=-1;
+		stop=false;
+		base=0;
+		srcread=0;
+	}
+
+	FILE* start();
+	void finish();
+	void run();
+	bool put(const char* text,unsigned long len);
+	void gunzip(char* inbuf,char* outbuf);
+	void unzstd(char* inbuf,char* outbuf);
+};
+
+FILE* Decompressor::start() {
+
+	// Starts decompressing src from its beginning; returns the read end of the
+	// pipe the text is written to
+
+	int fd[2];
+	FILE* out;
+
+	if (!makepipe(fd)) return NULL;
+	out=fdopen(fd[0],"r");
+	if (!out) {
+		close(fd[0]);
+		close(fd[1]);
+		return NULL;
+	}
+
+	fseek(src,0,SEEK_SET);
+	fdout=fd[1];
+	stop=false;
+	base=0;
+	srcread=0;
+	error="";
+	worker=std::thread(&Decompressor::run,this);
+	return out;
+}
+
+void Decompressor::finish() {
+
+	// Waits for the worker to end; terminates the program if the compressed
+	// data could not be decompressed
+
+	if (worker.joinable()) worker.join();
+	if (error!="") {
+		::printf("Error in GUTIL library: %s: %s\n",(char*)filename,(char*)error);
+		fprintf(stderr,"Error in GUTIL library: %s: %s\n",(char*)filename,(char*)error);
+		exit(99);
+	}
+}
+
+void Decompressor::run() {
+
+	std::vector<char> inbuf(ZBUFSIZE),outbuf(ZBUFSIZE);
+
+	if (format==COMP_GZIP) gunzip(&inbuf[0],&outbuf[0]);
+	else if (format==COMP_ZSTD) unzstd(&inbuf[0],&outbuf[0]);
+
+	// End of file for the reader
+
+	close(fdout);
+	fdout=-1;
+}
+
+bool Decompressor::put(const char* text,unsigned long len) {
+
+	// Writes text to the pipe, waiting while the pipe is full.
+	// Returns false if the worker should stop
+
+	long n;
+
+	while (len) {
+		if (stop) return false;
+		n=write(fdout,text,len);
+		if (n<0) {
+			if (errno==EINTR) continue;
+			return false;
+		}
+		text+=n;
+		len-=n;
+	}
+	return !stop;
+}
+
+void Decompressor::gunzip(char* inbuf,char* outbuf) {
+
+#ifdef HAVE_ZLIB
+
+	// Concatenated gzip members (as produced by e.g. pigz, or cat a.gz b.gz)
+	// are decompressed as one stream
+
+	z_stream z;
+	int ret=Z_OK;
+	bool full=false;
+
+	memset(&z,0,sizeof(z));
+	if (inflateInit2(&z,15+32)!=Z_OK) { // 15+32: gzip or zlib header
+		error="could not initialise zlib";
+		return;
+	}
+
+	for (;;) {
+		if (!z.avail_in && !full) {
+			z.avail_in=fread(inbuf,1,ZBUFSIZE,src);
+			srcread+=z.avail_in;
+			z.next_in=(Bytef*)inbuf;
+			if (!z.avail_in) {
+				if (ret!=Z_STREAM_END) error="unexpected end of compressed data";
+				break;
+			}
+		}
+		if (ret==Z_STREAM_END) {
+			inflateReset(&z); // next member
+			ret=Z_OK;
+		}
+
+		z.next_out=(Bytef*)outbuf;
+		z.avail_out=ZBUFSIZE;
+		ret=inflate(&z,Z_NO_FLUSH);
+		if (ret==Z_BUF_ERROR && !z.avail_in) ret=Z_OK; // no more output pending
+		else if (ret!=Z_OK && ret!=Z_STREAM_END) {
+			error.printf("corrupt gzip data (%s)",z.msg?z.msg:"inflate failed");
+			break;
+		}
+		full=!z.avail_out;
+		if (!put(outbuf,ZBUFSIZE-z.avail_out)) break;
+	}
+
+	inflateEnd(&z);
+
+#endif
+}
+
+void Decompressor::unzstd(char* inbuf,char* outbuf) {
+
+#ifdef HAVE_ZSTD
+
+	// Frames following each other in the file are decompressed as one stream
+
+	ZSTD_DStream* zs;
+	ZSTD_inBuffer zin={inbuf,0,0};
+	ZSTD_outBuffer zout;
+	size_t ret=0;
+	bool full=false;
+
+	zs=ZSTD_createDStream();
+	if (!zs) fail();
+	ZSTD_initDStream(zs);
+
+	for (;;) {
+		if (zin.pos==zin.size && !full) {
+			zin.size=fread(inbuf,1,ZBUFSIZE,src);
+			srcread+=zin.size;
+			zin.pos=0;
+			if (!zin.size) {
+				if (ret) error="unexpected end of compressed data";
+				break;
+			}
+		}
+
+		zout.dst=outbuf;
+		zout.size=ZBUFSIZE;
+		zout.pos=0;
+		ret=ZSTD_decompressStream(zs,&zout,&zin);
+		if (ZSTD_isError(ret)) {
+			error.printf("corrupt zstd data (%s)",ZSTD_getErrorName(ret));
+			break;
+		}
+		full=zout.pos==zout.size;
+		if (!put(outbuf,zout.pos)) break;
+	}
+
+	ZSTD_freeDStream(zs);
+
+#endif
+}
+
+
+InputFile::InputFile() {
+
+	in=NULL;
+	data=NULL;
+	size=0;
+	decomp=NULL;
+	passstart=0;
+	disksize=0;
+}
+
+InputFile::~InputFile() {
+
+	close();
+}
+
+bool InputFile::open(const char* filename) {
+
+	close();
+
+	in=fopen(filename,"rt");
+	if (!in) return false;
+
+	passstart=0;
+
+#ifndef _WIN32
+	struct stat st;
+	if (!fstat(fileno(in),&st) && S_ISREG(st.st_mode)) disksize=st.st_size;
+#else
+	struct _stat64 st;
+	if (!_fstat64(_fileno(in),&st) && (st.st_mode&_S_IFREG)) disksize=st.st_size;
+#endif
+
+	// Compressed files are decompressed through a pipe
+
+	int format=compression(in);
+	if (format!=COMP_NONE) {
+		if (!supported(format)) {
+			::printf("%s is %s-compressed, but this program was built without %s support\n",
+				filename,format==COMP_GZIP?"gzip":"zstd",format==COMP_GZIP?"zlib":"zstd");
+			fclose(in);
+			in=NULL;
+			return false;
+		}
+
+		FILE* src=freopen(filename,"rb",in);
+		if (!src) {
+			in=NULL;
+			return false;
+		}
+		decomp=new Decompressor(src,format,filename);
+		if (!decomp) fail();
+		in=decomp->start();
+		if (!in) {
+			delete decomp;
+			decomp=NULL;
+			fclose(src);
+			return false;
+		}
+		reader.attach(in);
+		return true;
+	}
+
+#ifndef _WIN32
+
+	// Map regular files into memory, advising the system that the file will be
+	// read sequentially (for aggressive read-ahead)
+
+	void* pmap;
+
+	if (disksize>0 &&
+		(off_t)(size_t)st.st_size==st.st_size) { // must fit in address space
+		pmap=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fileno(in),0);
+		if (pmap!=MAP_FAILED) {
+			madvise(pmap,st.st_size,MADV_SEQUENTIAL);
+			data=(const char*)pmap;
+			size=st.st_size;
+			fclose(in);
+			in=NULL;
+			reader.attach(data,data+size);
+			return true;
+		}
+	}
+
+#endif
+
+	reader.attach(in);
+	return true;
+}
+
+void InputFile::stopdecomp() {
+
+	// Makes the decompressing thread quit, reading any text it is still
+	// writing to the pipe so that it is not left waiting
+
+	char scratch[4096];
+
+	decomp->stop=true;
+	while (fread(scratch,1,sizeof(scratch),in));
+	fclose(in);
+	in=NULL;
+	decomp->finish();
+}
+
+void InputFile::checkdecomp() const {
+
+	decomp->finish();
+}
+
+void InputFile::account() {
+
+	// Adds the text consumed since the file was opened or last repositioned to
+	// the count of bytes read. Text handed over to a ChunkedReader is counted
+	// by the ChunkedReader
+
+	if (data) runstats.bytesread+=reader.tell()-data-passstart;
+	else if (in) runstats.bytesread+=reader.streampos();
+}
+
+void InputFile::close() {
+
+	account();
+
+#ifndef _WIN32
+	if (data) munmap((void*)data,size);
+#endif
+	if (decomp) {
+		stopdecomp();
+		fclose(decomp->src);
+		delete decomp;
+		decomp=NULL;
+	}
+	if (in) fclose(in);
+	in=NULL;
+	data=NULL;
+	size=0;
+	disksize=0;
+	reader.attach((const char*)NULL,NULL);
+}
+
+unsigned long InputFile::tell() {
+
+	if (data) return reader.tell()-data;
+	else if (decomp) return decomp->base+reader.streampos();
+	else if (in) return ftell(in);
+	return 0;
+}
+
+void InputFile::seek(unsigned long pos) {
+
+	if (data) {
+		account();
+		if (pos>size) pos=size;
+		passstart=pos;
+		reader.attach(data+pos,data+size);
+	}
+	else if (decomp) {
+
+		// The stream cannot be repositioned: decompression is restarted, and
+		// the text up to pos skipped
+
+		char scratch[4096];
+		unsigned long at=0,n;
+
+		if (pos==decomp->base+reader.streampos()) return;
+
+		account();
+		stopdecomp();
+		in=decomp->start();
+		if (!in) fail();
+		reader.attach(in);
+		reader.reset();
+		while (at<pos) {
+			n=pos-at;
+			if (n>sizeof(scratch)) n=sizeof(scratch);
+			n=fread(scratch,1,n,in);
+			if (!n) break;
+			at+=n;
+		}
+		decomp->base=at;
+	}
+	else if (in) {
+		account();
+		fseek(in,pos,SEEK_SET);
+		passstart=pos;
+		reader.reset();
+	}
+}
+
+unsigned long long InputFile::consumed() const {
+
+	if (data) return reader.tell()-data;
+	else if (decomp) return decomp->srcread;
+	else if (in) return passstart+reader.streampos();
+	return 0;
+}
+
+bool InputFile::read(const char* fmt, ...) {
+
+	va_list v;
+	va_start(v,fmt);
+	bool ok=reader.vread(fmt,v);
+	va_end(v);
+	return ok;
+}
+
+bool InputFile::vread(const char* fmt,va_list& v) {
+
+	return reader.vread(fmt,v);
+}
+
+bool InputFile::read(const ReadFormat& format) {
+
+	return reader.read(format);
+}
+
+bool readfor(InputFile& in,const char* fmt, ...) {
+
+	va_list v;
+	va_start(v,fmt);
+	bool ok=in.vread(fmt,v);
+	va_end(v);
+	return ok;
+}
+
+bool readfor(InputFile& in,const ReadFormat& format) {
+
+	return in.read(format);
+}
+
+
+// Powers of ten that fit in 64 bits, for NumberFormat
+const unsigned long long IPOW10[20]={1ULL,10ULL,100ULL,1000ULL,10000ULL,100000ULL,
+	1000000ULL,10000000ULL,100000000ULL,1000000000ULL,10000000000ULL,
+	100000000000ULL,1000000000000ULL,10000000000000ULL,100000000000000ULL,
+	1000000000000000ULL,10000000000000000ULL,100000000000000000ULL,
+	1000000000000000000ULL,10000000000000000000ULL};
+
+static bool scaleround(unsigned long long mant,int exp,int k,unsigned long long& q) {
+
+	// Rounds mant*2^exp*10^k (-19<=k<=19) to the nearest integer, ties to even
+	// (as printf rounds the exact binary value of a double), in integer
+	// arithmetic. Returns false if the result does not fit in 64 bits, or
+	// 128-bit arithmetic is not available
+
+#ifdef __SIZEOF_INT128__
+
+	unsigned __int128 n,d,r,half;
+	int shift;
+
+	if (k<-19 || k>19) return false;
+
+	if (k<0) {
+
+		// Divide by 10^-k (and 2^-exp)
+
+		if (exp>=0) {
+			if (exp>74) return false;
+			n=(unsigned __int128)mant<<exp;
+			d=IPOW10[-k];
+		}
+		else {
+			if (-exp>=64) { // less than a half
+				q=0;
+				return true;
+			}
+			n=mant;
+			d=(unsigned __int128)IPOW10[-k]<<-exp;
+		}
+		r=n%d;
+		n/=d;
+		if (2*r>d || (2*r==d && (n&1))) n++;
+	}
+	else {
+		n=(unsigned __int128)mant*IPOW10[k];
+		if (exp>=0) {
+			if (exp>=64 || n>>(64-exp)) return false;
+			q=(unsigned long long)(n<<exp);
+			return true;
+		}
+		shift=-exp;
+		if (shift>=128) { // less than a half
+			q=0;
+			return true;
+		}
+		r=n&(((unsigned __int128)1<<shift)-1);
+		half=(unsigned __int128)1<<(shift-1);
+		n>>=shift;
+		if (r>half || (r==half && (n&1))) n++;
+	}
+
+	if (n>>64) return false;
+	q=(unsigned long long)n;
+	return true;
+
+#else
+	return false;
+#endif
+}
+
+static bool roundsig(unsigned long long mant,int exp,int p,int& x,unsigned long long& q) {
+
+	// Rounds mant*2^exp (non-zero) to p significant digits (1<=p<=17): on
+	// return, the rounded value is q*10^(x-p+1) with q having exactly p
+	// digits. x is an estimate of the decimal exponent on entry (corrected if
+	// off by up to 2)
+
+	unsigned long long qlow;
+	int i;
+
+	for (i=0;i<3;i++) {
+		if (!scaleround(mant,exp,p-1-x,q)) return false;
+		if (q>IPOW10[p]) x++;
+		else if (q<IPOW10[p-1]) x--;
+		else {
+			if (q==IPOW10[p]) { // rounded up to the next power of ten
+				q=IPOW10[p-1];
+				x++;
+			}
+			else if (q==IPOW10[p-1]) {
+
+				// May be a value below 10^x rounded up at too coarse a scale
+
+				if (!scaleround(mant,exp,p-x,qlow)) return false;
+				if (qlow<IPOW10[p]) {
+					q=qlow;
+					x--;
+				}
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+static void putsig(char*& ptext,unsigned long long q,int p,int x) {
+
+	// Writes the number with the p significant digits q and decimal exponent x
+	// backwards from ptext, as printf's %.<p>g
+
+	char digits[20];
+	int i,n;
+
+	for (i=p-1;i>=0;i--) {
+		digits[i]='0'+q%10;
+		q/=10;
+	}
+
+	if (x<-4 || x>=p) {
+
+		// Exponential notation, e.g. 1.5e+07
+
+		n=p;
+		while (n>1 && digits[n-1]=='0') n--; // trailing zeros
+		i=x<0?-x:x;
+		do {
+			*--ptext='0'+i%10;
+			i/=10;
+		} while (i);
+		if (x>-10 && x<10) *--ptext='0';
+		*--ptext=x<0?'-':'+';
+		*--ptext='e';
+		for (i=n-1;i>0;i--) *--ptext=digits[i];
+		if (n>1) *--ptext='.';
+		*--ptext=digits[0];
+	}
+	else {
+
+		// Fixed-point notation, trailing zeros removed
+
+		n=p;
+		while (n>x+1 && n>1 && digits[n-1]=='0') n--;
+		if (x>=0) {
+			for (i=n-1;i>x;i--) *--ptext=digits[i];
+			if (n>x+1) *--ptext='.';
+			for (i=x;i>=0;i--) *--ptext=digits[i];
+		}
+		else {
+			for (i=n-1;i>=0;i--) *--ptext=digits[i];
+			for (i=x+1;i<0;i++) *--ptext='0';
+			*--ptext='.';
+			*--ptext='0';
+		}
+	}
+}
+
+static bool readsback(unsigned long long q,int x,unsigned long long mant,int exp,
+	double value) {
+
+	// Whether the decimal number q*10^x is read in (as by strtod) as value,
+	// which is mant*2^exp
+
+	double dval;
+
+#ifdef __SIZEOF_INT128__
+	if (x<=0 && x>=-19 && exp<=0 && 2-exp<128 && (2-exp<=64 || !(q>>(126+exp)))) {
+
+		// The number must lie within half a unit in the last place of
+		// value (the interval includes its ends if mant is even, as ties are
+		// rounded to even). Compared exactly, scaled by 2^(2-exp)*10^-x
+
+		unsigned __int128 lhs=(unsigned __int128)q<<(2-exp);
+		unsigned __int128 pow=IPOW10[-x];
+		unsigned __int128 centre=(unsigned __int128)(4*mant)*pow;
+		unsigned __int128 below=mant==1ULL<<52 && exp>-1074?pow:2*pow; // narrower gap below a power of two
+
+		if (mant&1) return lhs>centre-below && lhs<centre+2*pow;
+		return lhs>=centre-below && lhs<=centre+2*pow;
+	}
+#endif
+
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD==0
+	// One correctly rounded operation on exact operands
+	if (q<=(1ULL<<53) && x>=-22 && x<=22) {
+		if (x<0) dval=(double)q/POW10[-x];
+		else dval=(double)q*POW10[x];
+		return dval==value;
+	}
+#endif
+
+	char text[32];
+	int len=sprintf(text,"%llue%d",q,x);
+	return parsefloat(text,len,dval) && dval==value;
+}
+
+void NumberFormat::setfixed(int w,int p) {
+
+	width=w;
+	places=p;
+	style=FIXED;
+
+	// Up to 309 integer digits, sign and decimal point
+	maxlength=places+311;
+	if (maxlength<width) maxlength=width;
+}
+
+void NumberFormat::setgeneral(int w) {
+
+	width=w;
+	places=0;
+	style=GENERAL;
+
+	// e.g. -1.23457e+308
+	maxlength=13;
+	if (maxlength<width) maxlength=width;
+}
+
+void NumberFormat::setshortest(int w) {
+
+	width=w;
+	places=0;
+	style=SHORTEST;
+
+	// e.g. -2.2250738585072014e-308
+	maxlength=24;
+	if (maxlength<width) maxlength=width;
+}
+
+int NumberFormat::format(char* dest,double value) const {
+
+	// Numbers are converted in integer arithmetic, and printf only called for
+	// cases that rarely arise in model output (infinity, NaN, very large or
+	// small numbers, and more than 19 decimal places)
+
+	char text[48],*ptext=text+sizeof(text);
+	unsigned long long bits,mant,q,qbest;
+	int exp,i,n,x,p,lo,hi,xbest;
+	bool neg;
+
+	memcpy(&bits,&value,sizeof(bits));
+	neg=(bits>>63)!=0;
+	exp=(int)(bits>>52)&0x7ff;
+	mant=bits&((1ULL<<52)-1);
+
+	n=-1;
+	if (exp!=0x7ff) { // not infinity or NaN
+
+		if (exp) mant|=1ULL<<52;
+		else exp=1; // subnormal
+		exp-=1075; // value=mant*2^exp
+
+		// Estimate of the decimal exponent (log10(2) ~ 1233/4096)
+		x=(exp+52)*1233/4096;
+
+		if (style==FIXED) {
+
+			// %w.pf: integer part, and fraction part of p digits
+
+			if (places<=19 && scaleround(mant,exp,places,q)) {
+				for (i=0;i<places;i++) {
+					*--ptext='0'+q%10;
+					q/=10;
+				}
+				if (places) *--ptext='.';
+				do {
+					*--ptext='0'+q%10;
+					q/=10;
+				} while (q);
+				n=0;
+			}
+		}
+		else if (!mant) {
+			*--ptext='0';
+			n=0;
+		}
+		else if (style==GENERAL) {
+
+			// %wg: 6 significant digits
+
+			if (roundsig(mant,exp,6,x,q)) {
+				putsig(ptext,q,6,x);
+				n=0;
+			}
+		}
+		else {
+
+			// Shortest: as %.<p>g with the fewest digits p that read back as
+			// the same value. 17 digits always do; if p digits do, so do p+1
+
+			lo=1;
+			hi=17;
+			xbest=x;
+			qbest=0;
+			while (lo<hi) {
+				p=(lo+hi)/2;
+				if (!roundsig(mant,exp,p,x,q)) break;
+				if (readsback(q,x-p+1,mant,exp,neg?-value:value)) {
+					hi=p;
+					qbest=q;
+					xbest=x;
+				}
+				else lo=p+1;
+			}
+			if (lo==hi) {
+				if (!qbest) qbest=roundsig(mant,exp,17,xbest,q)?q:0;
+				if (qbest) {
+					putsig(ptext,qbest,hi,xbest);
+					n=0;
+				}
+			}
+		}
+	}
+
+	if (n<0) {
+		if (style==FIXED) return sprintf(dest,"%*.*f",width,places,value);
+		if (style==GENERAL) return sprintf(dest,"%*g",width,value);
+		for (p=1;p<17;p++) {
+			n=sprintf(dest,"%*.*g",width,p,value);
+			if (strtod(dest,NULL)==value) return n;
+		}
+		return sprintf(dest,"%*.17g",width,value);
+	}
+
+	if (neg) *--ptext='-';
+	n=text+sizeof(text)-ptext;
+	for (i=n;i<width;i++) *dest++=' ';
+	memcpy(dest,ptext,n);
+	dest[n]='\0';
+	return n>width?n:width;
+}
+
+
+struct Compressor {
+
+	// Compresses the text written to a pipe into a file, on a background thread
+
+	FILE* dest;               ///< compressed file
+	int format;               ///< compression format (COMP_GZIP or COMP_ZSTD)
+	xtring filename;
+	int fdin;                 ///< read end of the pipe
+	std::thread worker;
+	xtring error;             ///< description of any error writing the file
+
+	Compressor(FILE* dest,int format,const char* filename) {
+		this->dest=dest;
+		this->format=format;
+		this->filename=filename;
+		fdin=-1;
+	}
+
+	FILE* start();
+	void finish();
+	void run();
+	unsigned long get(char* text,unsigned long size);
+	bool write(const char* data,unsigned long len);
+	void gzip(char* inbuf,char* outbuf);
+	void zstd(char* inbuf,char* outbuf);
+};
+
+FILE* Compressor::start() {
+
+	// Starts compressing into dest; returns the write end of the pipe the text
+	// is to be written to
+
+	int fd[2];
+	FILE* in;
+
+	if (!makepipe(fd)) return NULL;
+	in=fdopen(fd[1],"w");
+	if (!in) {
+		close(fd[0]);
+		close(fd[1]);
+		return NULL;
+	}
+	setvbuf(in,NULL,_IOFBF,ZBUFSIZE);
+
+	fdin=fd[0];
+	worker=std::thread(&Compressor::run,this);
+	return in;
+}
+
+void Compressor::finish() {
+
+	// Waits for the worker to compress the rest of the text (the write end of
+	// the pipe must have been closed) and closes the file; terminates the
+	// program if the file could not be written
+
+	if (worker.joinable()) worker.join();
+	if (fclose(dest) && error=="") error="could not write file";
+	dest=NULL;
+	if (error!="") {
+		::printf("Error in GUTIL library: %s: %s\n",(char*)filename,(char*)error);
+		fprintf(stderr,"Error in GUTIL library: %s: %s\n",(char*)filename,(char*)error);
+		exit(99);
+	}
+}
+
+void Compressor::run() {
+
+	std::vector<char> inbuf(ZBUFSIZE),outbuf(ZBUFSIZE);
+
+	if (format==COMP_GZIP) gzip(&inbuf[0],&outbuf[0]);
+	else if (format==COMP_ZSTD) zstd(&inbuf[0],&outbuf[0]);
+
+	// If compression failed, the rest of the text is discarded, so that the
+	// writer is not left waiting
+
+	while (get(&inbuf[0],ZBUFSIZE));
+	close(fdin);
+	fdin=-1;
+}
+
+unsigned long Compressor::get(char* text,unsigned long size) {
+
+	// Reads text from the pipe, waiting until some is available.
+	// Returns 0 when the write end has been closed
+
+	long n;
+
+	do n=read(fdin,text,size);
+	while (n<0 && errno==EINTR);
+	return n>0?n:0;
+}
+
+bool Compressor::write(const char* data,unsigned long len) {
+
+	if (len && fwrite(data,1,len,dest)!=len) {
+		error="could not write file";
+		return false;
+	}
+	return true;
+}
+
+void Compressor::gzip(char* inbuf,char* outbuf) {
+
+#ifdef HAVE_ZLIB
+
+	z_stream z;
+	int flush;
+
+	memset(&z,0,sizeof(z));
+	if (deflateInit2(&z,Z_DEFAULT_COMPRESSION,Z_DEFLATED,15+16,8,
+		Z_DEFAULT_STRATEGY)!=Z_OK) { // 15+16: gzip header
+		error="could not initialise zlib";
+		return;
+	}
+
+	do {
+		z.avail_in=get(inbuf,ZBUFSIZE);
+		z.next_in=(Bytef*)inbuf;
+		flush=z.avail_in?Z_NO_FLUSH:Z_FINISH;
+		do {
+			z.next_out=(Bytef*)outbuf;
+			z.avail_out=ZBUFSIZE;
+			deflate(&z,flush);
+			if (!write(outbuf,ZBUFSIZE-z.avail_out)) {
+				deflateEnd(&z);
+				return;
+			}
+		} while (!z.avail_out);
+	} while (flush!=Z_FINISH);
+
+	deflateEnd(&z);
+
+#endif
+}
+
+void Compressor::zstd(char* inbuf,char* outbuf) {
+
+#ifdef HAVE_ZSTD
+
+	ZSTD_CCtx* zc;
+	ZSTD_inBuffer zin;
+	ZSTD_outBuffer zout;
+	ZSTD_EndDirective mode;
+	size_t ret;
+	bool done;
+	int nthread=std::thread::hardware_concurrency();
+
+	zc=ZSTD_createCCtx();
+	if (!zc) fail();
+	ZSTD_CCtx_setParameter(zc,ZSTD_c_compressionLevel,ZSTD_CLEVEL_DEFAULT);
+
+	// Compress on the remaining processors (the one writing the text is busy
+	// formatting it); has no effect if libzstd was built without threads
+
+	if (nthread>1) ZSTD_CCtx_setParameter(zc,ZSTD_c_nbWorkers,nthread-1);
+
+	do {
+		zin.src=inbuf;
+		zin.size=get(inbuf,ZBUFSIZE);
+		zin.pos=0;
+		mode=zin.size?ZSTD_e_continue:ZSTD_e_end;
+		do {
+			zout.dst=outbuf;
+			zout.size=ZBUFSIZE;
+			zout.pos=0;
+			ret=ZSTD_compressStream2(zc,&zout,&zin,mode);
+			if (ZSTD_isError(ret)) {
+				error.printf("zstd compression failed (%s)",ZSTD_getErrorName(ret));
+				ZSTD_freeCCtx(zc);
+				return;
+			}
+			if (!write(outbuf,zout.pos)) {
+				ZSTD_freeCCtx(zc);
+				return;
+			}
+			done=mode==ZSTD_e_end?!ret:zin.pos==zin.size;
+		} while (!done);
+	} while (mode!=ZSTD_e_end);
+
+	ZSTD_freeCCtx(zc);
+
+#endif
+}
+
+
+static bool hassuffix(const char* filename,const char* suffix) {
+
+	unsigned long len=strlen(filename),slen=strlen(suffix);
+	return len>slen && !strcmp(filename+len-slen,suffix);
+}
+
+const unsigned long OUTBUFSIZE=1<<18;
+	// Size of the buffer in which an OutputFile collects text
+
+OutputFile::OutputFile() {
+
+	out=NULL;
+	comp=NULL;
+	buf=pos=bufend=NULL;
+}
+
+OutputFile::~OutputFile() {
+
+	close();
+	delete[] buf;
+}
+
+bool OutputFile::open(const char* filename,bool append) {
+
+	int format=COMP_NONE;
+	FILE* dest;
+
+	close();
+
+	if (!buf) {
+		buf=new char[OUTBUFSIZE];
+		if (!buf) fail();
+		pos=buf;
+		bufend=buf+OUTBUFSIZE;
+	}
+
+	if (hassuffix(filename,".gz")) format=COMP_GZIP;
+	else if (hassuffix(filename,".zst")) format=COMP_ZSTD;
+
+	if (format==COMP_NONE) {
+		out=fopen(filename,append?"at":"wt");
+		return out!=NULL;
+	}
+
+	if (!supported(format)) {
+		::printf("Cannot write %s: this program was built without %s support\n",
+			filename,format==COMP_GZIP?"zlib":"zstd");
+		return false;
+	}
+
+	dest=fopen(filename,append?"ab":"wb");
+	if (!dest) return false;
+	comp=new Compressor(dest,format,filename);
+	if (!comp) fail();
+	out=comp->start();
+	if (!out) {
+		delete comp;
+		comp=NULL;
+		fclose(dest);
+		return false;
+	}
+	return true;
+}
+
+void OutputFile::close() {
+
+	if (out) {
+		flush();
+		fclose(out);
+	}
+	out=NULL;
+	if (comp) {
+		comp->finish();
+		delete comp;
+		comp=NULL;
+	}
+}
+
+void OutputFile::flush() {
+
+	if (out && pos>buf) {
+		int prev=runstats.setphase(RunStats::PHASE_WRITE);
+		fwrite(buf,1,pos-buf,out);
+		runstats.byteswritten+=pos-buf;
+		runstats.setphase(prev);
+	}
+	pos=buf;
+}
+
+void OutputFile::put(const char* text) {
+
+	unsigned long len=strlen(text);
+
+	if (len>(unsigned long)(bufend-pos)) {
+		flush();
+		if (len>OUTBUFSIZE) {
+			if (out) {
+				int prev=runstats.setphase(RunStats::PHASE_WRITE);
+				fwrite(text,1,len,out);
+				runstats.byteswritten+=len;
+				runstats.setphase(prev);
+			}
+			return;
+		}
+	}
+	memcpy(pos,text,len);
+	pos+=len;
+}
+
+void OutputFile::printf(const char* fmt, ...) {
+
+	va_list v,v2;
+	int n;
+
+	va_start(v,fmt);
+	va_copy(v2,v);
+	n=vsnprintf(pos,bufend-pos,fmt,v);
+	if (n>=0 && n<bufend-pos) pos+=n;
+	else {
+		flush();
+		if (n>=0 && n<(long)OUTBUFSIZE) pos+=vsnprintf(pos,OUTBUFSIZE,fmt,v2);
+		else if (out) {
+			int prev=runstats.setphase(RunStats::PHASE_WRITE);
+			if (n>0) runstats.byteswritten+=n;
+			vfprintf(out,fmt,v2);
+			runstats.setphase(prev);
+		}
+	}
+	va_end(v2);
+	va_end(v);
+}
+
+const unsigned long CHUNKSIZE=1<<20;
+	// Nominal size of the blocks read in by the worker threads of a ChunkedReader
+
+struct ChunkBatch {
+
+	// A block of whole lines of the input file and the rows read from it
+
+	struct Row {
+		const char* start;
+		const char* end;
+		bool ok;
+	};
+
+	char* buf;         // text read in from a stream
+	unsigned long size;
+	const char* text;  // the block (in buf, or in a mapped file)
+	unsigned long len;
+	std::vector<Row> rows;
+	std::vector<double> values;
+	bool ready;  // rows have been read and are waiting for the caller
+	bool last;   // block reaches end of file
+
+	ChunkBatch() {
+		buf=NULL;
+		size=0;
+		text=NULL;
+		len=0;
+		ready=last=false;
+	}
+
+	~ChunkBatch() {
+		if (buf) delete[] buf;
+	}
+
+	void reserve(unsigned long n) {
+		if (n<=size) return;
+		if (!size) size=CHUNKSIZE;
+		while (size<n) size*=2;
+		char* pnew=new char[size];
+		if (!pnew) fail();
+		if (buf) {
+			memcpy(pnew,buf,len);
+			delete[] buf;
+		}
+		text=buf=pnew;
+	}
+};
+
+struct ChunkedReaderState {
+
+	FILE* in;
+	const char* mapnext; // next block of a mapped file (if in is NULL)
+	const char* mapend;
+	xtring fmt;
+	int nvalue;
+	int window;        // number of blocks that may be in memory at once
+	ChunkBatch* batch; // window blocks, block n in batch[n%window]
+	long nextblock;    // next block to be read in by a worker
+	long consumed;     // number of blocks finished by the caller
+	bool fileend;      // end of file has been read
+	bool stop;
+	char* carry;       // incomplete line at end of last block read in
+	unsigned long ncarry;
+	unsigned long maxcarry;
+	std::mutex lock;
+	std::condition_variable changed;
+	std::vector<std::thread> workers;
+	ChunkBatch* current;
+	unsigned long currow;
+	unsigned long long textpos; // offset in the file of the end of the current block
+	const Decompressor* decomp; // decompressor of the file, if compressed
+
+	ChunkedReaderState(FILE* strm,const char* begin,const char* end,const char* format,
+		int nval,int nthread) {
+		in=strm;
+		mapnext=begin;
+		mapend=end;
+		fmt=format;
+		nvalue=nval;
+		window=nthread*2;
+		batch=new ChunkBatch[window];
+		if (!batch) fail();
+		nextblock=consumed=0;
+		fileend=stop=false;
+		maxcarry=4096;
+		carry=new char[maxcarry];
+		if (!carry) fail();
+		ncarry=0;
+		current=NULL;
+		currow=0;
+		textpos=0;
+		decomp=NULL;
+	}
+
+	~ChunkedReaderState() {
+		delete[] batch;
+		delete[] carry;
+	}
+
+	void readblock(ChunkBatch& b) {
+
+		// Reads the next block of whole lines from the file (called with lock held)
+		// The file is read strictly sequentially: an incomplete line at the end of
+		// one block is carried over to the start of the next
+
+		unsigned long n,i;
+		const char* pchar;
+
+		if (!in) {
+
+			// Mapped file: the block is used where it lies
+
+			b.text=mapnext;
+			if ((unsigned long)(mapend-mapnext)>CHUNKSIZE) {
+				pchar=mapnext+CHUNKSIZE;
+				while (pchar>mapnext && pchar[-1]!='\n') pchar--;
+				if (pchar==mapnext) {
+					pchar=(const char*)memchr(mapnext+CHUNKSIZE,'\n',mapend-mapnext-CHUNKSIZE);
+					pchar=pchar?pchar+1:mapend;
+				}
+			}
+			else pchar=mapend;
+			b.len=pchar-mapnext;
+			mapnext=pchar;
+			fileend=b.last=mapnext==mapend;
+			return;
+		}
+
+		b.len=0;
+		b.reserve(ncarry+CHUNKSIZE);
+		memcpy(b.buf,carry,ncarry);
+		b.len=ncarry;
+		ncarry=0;
+		b.last=false;
+
+		while (true) {
+			n=fread(b.buf+b.len,1,CHUNKSIZE,in);
+			b.len+=n;
+			if (n<CHUNKSIZE) {
+				fileend=b.last=true;
+				return;
+			}
+			i=b.len;
+			while (i>b.len-n && b.buf[i-1]!='\n') i--;
+			if (i>b.len-n) {
+				ncarry=b.len-i;
+				if (ncarry>maxcarry) {
+					delete[] carry;
+					while (maxcarry<ncarry) maxcarry*=2;
+					carry=new char[maxcarry];
+					if (!carry) fail();
+				}
+				memcpy(carry,b.buf+i,ncarry);
+				b.len=i;
+				return;
+			}
+			b.reserve(b.len+CHUNKSIZE); // no newline yet - line is longer than a block
+		}
+	}
+
+	void readrows(ChunkBatch& b,ReadFormat& format,GuessReader& reader,
+		std::vector<int>& offset) {
+
+		// Reads the rows of a block (called without lock held)
+
+		ChunkBatch::Row row;
+		const char* end=b.text+b.len;
+		unsigned long base;
+		int i;
+
+		b.rows.clear();
+		b.values.clear();
+		reader.attach(b.text,end);
+		row.start=b.text;
+		while (row.start<end) {
+			base=b.values.size();
+			b.values.resize(base+nvalue);
+			for (i=0;i<format.nargs();i++) format.bind(i,&b.values[base+offset[i]]);
+			row.ok=reader.read(format);
+			row.end=reader.tell();
+			if (row.end<=row.start) {
+				b.values.resize(base);
+				break;
+			}
+			b.rows.push_back(row);
+			row.start=row.end;
+		}
+	}
+
+	void work() {
+
+		// Worker thread: reads and converts blocks until end of file
+
+		ReadFormat format(fmt);
+		GuessReader reader;
+		std::vector<int> offset;
+		int i,n=0;
+
+		for (i=0;i<format.size();i++) {
+			if (format[i].type==ReadFormat::OP_FLOAT) {
+				offset.push_back(n);
+				n+=format[i].nitem?format[i].nitem:1;
+			}
+		}
+
+		std::unique_lock<std::mutex> guard(lock);
+		while (true) {
+			while (!stop && !fileend && nextblock-consumed>=window) changed.wait(guard);
+			if (stop || fileend) return;
+			ChunkBatch& b=batch[nextblock++%window];
+			readblock(b);
+			guard.unlock();
+			readrows(b,format,reader,offset);
+			guard.lock();
+			b.ready=true;
+			changed.notify_all();
+		}
+	}
+};
+
+ChunkedReader::ChunkedReader() {
+
+	state=NULL;
+	rowvalues=NULL;
+	rowstart=rowend=NULL;
+	rowread=false;
+	ateof=true;
+}
+
+ChunkedReader::~ChunkedReader() {
+
+	close();
+}
+
+bool ChunkedReader::open(FILE* in,const char* fmt,int nthread) {
+
+	return start(in,NULL,NULL,fmt,nthread);
+}
+
+bool ChunkedReader::open(InputFile& in,const char* fmt,int nthread) {
+
+	bool ok;
+	unsigned long long pos=in.consumed();
+
+	if (in.mapped()) {
+		ok=start(NULL,in.reader.tell(),in.data+in.size,fmt,nthread);
+		in.seek(in.size);
+	}
+	else ok=start(in.in,NULL,NULL,fmt,nthread);
+
+	if (ok) {
+		state->textpos=pos;
+		state->decomp=in.decomp;
+	}
+
+	return ok;
+}
+
+bool ChunkedReader::start(FILE* in,const char* begin,const char* end,const char* fmt,
+	int nthread) {
+
+	int i,n=0;
+
+	close();
+
+	ReadFormat format(fmt);
+	for (i=0;i<format.size();i++) {
+		if (format[i].type==ReadFormat::OP_INT || format[i].type==ReadFormat::OP_CHAR) {
+			printf("ChunkedReader: format \"%s\" may only contain F specifiers\n",fmt);
+			return false;
+		}
+		if (format[i].type==ReadFormat::OP_FLOAT) n+=format[i].nitem?format[i].nitem:1;
+	}
+
+	if (nthread<=0) nthread=std::thread::hardware_concurrency();
+	if (nthread<=0) nthread=1;
+
+	state=new ChunkedReaderState(in,begin,end,fmt,n,nthread);
+	if (!state) fail();
+	for (i=0;i<nthread;i++)
+		state->workers.push_back(std::thread(&ChunkedReaderState::work,state));
+
+	ateof=false;
+	return true;
+}
+
+void ChunkedReader::close() {
+
+	unsigned int i;
+
+	if (!state) return;
+
+	{
+		std::lock_guard<std::mutex> guard(state->lock);
+		state->stop=true;
+		state->changed.notify_all();
+	}
+	for (i=0;i<state->workers.size();i++) state->workers[i].join();
+
+	delete state;
+	state=NULL;
+	rowvalues=NULL;
+	rowstart=rowend=NULL;
+	rowread=false;
+	ateof=true;
+}
+
+bool ChunkedReader::nextrow() {
+
+	ChunkBatch* b;
+	bool last;
+
+	if (!state || ateof) {
+		ateof=true;
+		rowvalues=NULL;
+		return false;
+	}
+
+	b=state->current;
+	if (b && state->currow+1<b->rows.size()) state->currow++;
+	else {
+
+		// Finished with the current block (if any), wait for the next one
+
+		std::unique_lock<std::mutex> guard(state->lock);
+		while (true) {
+			if (b) {
+				last=b->last;
+				b->ready=false;
+				state->current=NULL;
+				state->consumed++;
+				state->changed.notify_all();
+				if (last) {
+					ateof=true;
+					rowvalues=NULL;
+					return false;
+				}
+			}
+			b=&state->batch[state->consumed%state->window];
+			while (!b->ready) state->changed.wait(guard);
+			runstats.bytesread+=b->len;
+			state->textpos+=b->len;
+			state->current=b;
+			state->currow=0;
+			if (b->rows.size()) break;
+		}
+	}
+
+	const ChunkBatch::Row& row=b->rows[state->currow];
+	rowstart=row.start;
+	rowend=row.end;
+	rowread=row.ok;
+	rowvalues=state->nvalue?&b->values[state->currow*state->nvalue]:NULL;
+	return true;
+}
+
+int ChunkedReader::nvalue() const {
+
+	return state?state->nvalue:0;
+}
+
+unsigned long long ChunkedReader::consumed() const {
+
+	if (!state) return 0;
+	if (state->decomp) return state->decomp->srcread;
+	return state->textpos;
+}
+
+bool ChunkedReader::read(const ReadFormat& format) {
+
+	rowreader.attach(rowstart,rowend);
+	return rowreader.read(format);
+}
+
+
+const char GBIN_MAGIC[4]={'G','B','I','N'};
+const unsigned int GBIN_VERSION=2;
+const unsigned int GBIN_BYTEORDER=0x01020304;
+	// Reads back differently on a machine of the other byte order
+
+struct ColumnCacheHeader {
+
+	// Start of a .gbin file. It is followed, for each column, by the length of
+	// the label, the label, places, digits, ifsign and ifnum; and then by the
+	// values of each column in turn
+
+	char magic[4];
+	unsigned int version;
+	unsigned int byteorder;
+	int ncol;
+	unsigned long long nrow;
+	unsigned long long srcsize; // size of the text file
+	long long srctime;          // modification time of the text file (ns)
+	unsigned long long srchash; // hash of the first and last blocks of the text file
+};
+
+static bool filestamp(const char* filename,unsigned long long& size,long long& mtime,
+	unsigned long long& hash) {
+
+	// Size, modification time (in nanoseconds where the system records them)
+	// and a hash of the first and last blocks of a regular file; the hash tells
+	// apart files rewritten at the same size within the resolution of the time
+
+	const unsigned long long BLOCK=65536;
+	unsigned char buffer[4096];
+	unsigned long long pos,end,n;
+	int pass,i;
+
+#ifndef _WIN32
+	struct stat st;
+	if (stat(filename,&st) || !S_ISREG(st.st_mode)) return false;
+#if defined(__APPLE__)
+	mtime=st.st_mtimespec.tv_sec*1000000000LL+st.st_mtimespec.tv_nsec;
+#else
+	mtime=st.st_mtim.tv_sec*1000000000LL+st.st_mtim.tv_nsec;
+#endif
+#else
+	struct _stat64 st;
+	if (_stat64(filename,&st) || !(st.st_mode&_S_IFREG)) return false;
+	mtime=st.st_mtime*1000000000LL;
+#endif
+	size=st.st_size;
+
+	// FNV-1a over the first BLOCK bytes and the last BLOCK bytes (the whole
+	// file if it is no longer than two blocks)
+
+	FILE* in=fopen(filename,"rb");
+	if (!in) return false;
+
+	hash=14695981039346656037ULL;
+	for (pass=0;pass<2;pass++) {
+		if (!pass) {
+			pos=0;
+			end=size<BLOCK?size:BLOCK;
+		}
+		else {
+			pos=size>2*BLOCK?size-BLOCK:BLOCK;
+			end=size;
+			if (pos>=end) break;
+			if (fseek(in,(long)pos,SEEK_SET)) {
+				fclose(in);
+				return false;
+			}
+		}
+		while (pos<end) {
+			n=end-pos;
+			if (n>sizeof(buffer)) n=sizeof(buffer);
+			n=fread(buffer,1,n,in);
+			if (!n) break;
+			for (i=0;i<(int)n;i++) {
+				hash^=buffer[i];
+				hash*=1099511628211ULL;
+			}
+			pos+=n;
+		}
+	}
+
+	fclose(in);
+	return true;
+}
+
+ColumnCache::ColumnCache() {
+
+	labels=NULL;
+	maxplaces=maxdigits=NULL;
+	anysign=allplain=NULL;
+	rowvalues=NULL;
+	currow=0;
+	ateof=false;
+}
+
+ColumnCache::~ColumnCache() {
+
+	close();
+}
+
+void ColumnCache::allocate(int ncol) {
+
+	close();
+	table.init(ncol);
+	labels=new xtring[ncol];
+	maxplaces=new int[ncol];
+	maxdigits=new int[ncol];
+	anysign=new bool[ncol];
+	allplain=new bool[ncol];
+	rowvalues=new double[ncol];
+	if (!labels || !maxplaces || !maxdigits || !anysign || !allplain || !rowvalues) fail();
+
+	for (int c=0;c<ncol;c++) {
+		maxplaces[c]=maxdigits[c]=0;
+		anysign[c]=false;
+		allplain[c]=true;
+	}
+}
+
+void ColumnCache::close() {
+
+	table.init(0);
+	if (labels) delete[] labels;
+	if (maxplaces) delete[] maxplaces;
+	if (maxdigits) delete[] maxdigits;
+	if (anysign) delete[] anysign;
+	if (allplain) delete[] allplain;
+	if (rowvalues) delete[] rowvalues;
+	labels=NULL;
+	maxplaces=maxdigits=NULL;
+	anysign=allplain=NULL;
+	rowvalues=NULL;
+	rewind();
+}
+
+bool ColumnCache::open(const xtring& filename) {
+
+	unsigned long long srcsize,srchash;
+	long long srctime;
+	xtring cachefile;
+
+	close();
+
+	// Only regular files can be recognised again by their size, time and hash
+	if (!filestamp(filename,srcsize,srctime,srchash)) return false;
+
+	cachefile.printf("%s.gbin",(const char*)filename);
+	if (load(cachefile,srcsize,srctime,srchash)) {
+		::printf("Reading cached data from %s\n",(char*)cachefile);
+		return true;
+	}
+
+	if (!build(filename)) {
+		close();
+		return false;
+	}
+
+	if (save(cachefile,srcsize,srctime,srchash))
+		::printf("Data of %s cached in %s\n",(const char*)filename,(char*)cachefile);
+	else
+		::printf("Warning: could not write cache file %s\n",(char*)cachefile);
+
+	return true;
+}
+
+bool ColumnCache::load(const xtring& cachefile,unsigned long long srcsize,long long srctime,
+	unsigned long long srchash) {
+
+	// Reads a cache file, provided it was made for a text file of the given
+	// size, modification time and hash
+
+	ColumnCacheHeader head;
+	unsigned long long nbyte;
+	int c,len,places,digits;
+	unsigned char flags[2];
+	bool ok;
+
+	FILE* in=fopen(cachefile,"rb");
+	if (!in) return false;
+
+	ok=fread(&head,sizeof(head),1,in)==1 && !memcmp(head.magic,GBIN_MAGIC,4) &&
+		head.version==GBIN_VERSION && head.byteorder==GBIN_BYTEORDER &&
+		head.srcsize==srcsize && head.srctime==srctime && head.srchash==srchash &&
+		head.ncol>0;
+
+	if (ok) {
+		allocate(head.ncol);
+		for (c=0;c<head.ncol && ok;c++) {
+			if (fread(&len,sizeof(int),1,in)!=1 || len<0) ok=false;
+			else {
+				labels[c].reserve(len);
+				ok=fread((char*)labels[c],1,len,in)==(size_t)len;
+				if (ok) ((char*)labels[c])[len]='\0';
+				ok=ok && fread(&places,sizeof(int),1,in)==1 &&
+					fread(&digits,sizeof(int),1,in)==1 && fread(flags,1,2,in)==2;
+				maxplaces[c]=places;
+				maxdigits[c]=digits;
+				anysign[c]=flags[0]!=0;
+				allplain[c]=flags[1]!=0;
+			}
+		}
+	}
+
+	if (ok) {
+		table.addrows(head.nrow);
+		nbyte=head.nrow*sizeof(double);
+		for (c=0;c<head.ncol && ok;c++)
+			ok=fread(table.column(c),1,nbyte,in)==nbyte;
+	}
+
+	fclose(in);
+	if (!ok) close();
+	return ok;
+}
+
+bool ColumnCache::build(const xtring& filename) {
+
+	// Parses the text file into the table, as the programs would read it from
+	// the text (items separated by blanks and tabs, converted by strtod). A
+	// carriage return is left in the last item of a line, so that files with
+	// DOS line endings are not cached, and are read as the programs would
+	// otherwise read them
+
+	InputFile in;
+	ChunkedReader rows;
+	ReadFormat linefmt;
+	std::vector<xtring> header;
+	xtring line;
+	ScannedItem item;
+	const char* pchar;
+	const char* pstart;
+	unsigned long row;
+	int lineno=0,c,ncol;
+
+	if (!in.open(filename)) return false;
+
+	// Header row (the first that is not blank)
+
+	while (header.empty() && !in.eof()) {
+		readfor(in,"a#",&line);
+		lineno++;
+		pchar=line;
+		while (*pchar) {
+			while (*pchar==' ' || *pchar=='\t') pchar++;
+			pstart=pchar;
+			while (*pchar && *pchar!=' ' && *pchar!='\t') pchar++;
+			if (pchar>pstart) header.push_back(line.mid(pstart-(const char*)line,pchar-pstart));
+		}
+	}
+
+	ncol=header.size();
+	if (!ncol) return false;
+
+	allocate(ncol);
+	for (c=0;c<ncol;c++) labels[c]=header[c];
+
+	// Data rows
+
+	if (!rows.open(in,"")) return false;
+	linefmt.compile("a#");
+	linefmt.bind(0,&line);
+
+	while (rows.nextrow()) {
+		rows.read(linefmt);
+		lineno++;
+		row=table.addrow();
+		pchar=line;
+		c=0;
+		while (true) {
+			while (*pchar==' ' || *pchar=='\t') pchar++;
+			if (!*pchar) break;
+			pstart=pchar;
+			while (*pchar && *pchar!=' ' && *pchar!='\t') pchar++;
+			scannumber(pstart,pchar-pstart,item);
+			if (c==ncol || !item.isnum) {
+				c=-1;
+				break;
+			}
+			table(row,c)=item.value;
+			if (item.ifplain) {
+				if (item.places>maxplaces[c]) maxplaces[c]=item.places;
+				if (item.digits>maxdigits[c]) maxdigits[c]=item.digits;
+				if (item.ifsign) anysign[c]=true;
+			}
+			else allplain[c]=false;
+			c++;
+		}
+		if (c!=ncol) {
+			::printf("%s not cached: line %d is blank, non-numeric or not %d items long\n",
+				(const char*)filename,lineno,ncol);
+			return false;
+		}
+	}
+
+	rows.close();
+	in.close();
+	rewind();
+
+	return true;
+}
+
+bool ColumnCache::save(const xtring& cachefile,unsigned long long srcsize,long long srctime,
+	unsigned long long srchash) {
+
+	// Writes to a temporary file first, so that other programs never see a
+	// partly written cache
+
+	ColumnCacheHeader head;
+	xtring tempfile;
+	unsigned long long nbyte;
+	int c,len;
+	unsigned char flags[2];
+	bool ok=true;
+
+	memset(&head,0,sizeof(head));
+	memcpy(head.magic,GBIN_MAGIC,4);
+	head.version=GBIN_VERSION;
+	head.byteorder=GBIN_BYTEORDER;
+	head.ncol=table.ncolumn();
+	head.nrow=table.size();
+	head.srcsize=srcsize;
+	head.srctime=srctime;
+	head.srchash=srchash;
+
+	tempfile.printf("%s.tmp",(const char*)cachefile);
+	FILE* out=fopen(tempfile,"wb");
+	if (!out) return false;
+
+	ok=fwrite(&head,sizeof(head),1,out)==1;
+	for (c=0;c<head.ncol && ok;c++) {
+		len=labels[c].len();
+		flags[0]=anysign[c];
+		flags[1]=allplain[c];
+		ok=fwrite(&len,sizeof(int),1,out)==1 &&
+			fwrite((const char*)labels[c],1,len,out)==(size_t)len &&
+			fwrite(maxplaces+c,sizeof(int),1,out)==1 &&
+			fwrite(maxdigits+c,sizeof(int),1,out)==1 && fwrite(flags,1,2,out)==2;
+	}
+
+	nbyte=head.nrow*sizeof(double);
+	for (c=0;c<head.ncol && ok;c++)
+		ok=fwrite(table.column(c),1,nbyte,out)==nbyte;
+
+	if (fclose(out)) ok=false;
+	if (ok) {
+		remove(cachefile);
+		ok=!rename(tempfile,cachefile);
+	}
+	if (!ok) remove(tempfile);
+
+	return ok;
+}
+
+
+const int PROGRESS_SAMPLE=256;
+	// Rows read between updates of the position passed to the reporting thread
+
+struct ProgressReporterState {
+
+	// The reading loop stores the row count and file position; the reporting
+	// thread picks them up once a second
+
+	std::atomic<unsigned long long> nrow;
+	std::atomic<unsigned long long> pos;
+	unsigned long long startpos; // position when reporting started
+	unsigned long long total;    // size of the file
+	bool stop;
+	int width;                   // length of the status line last written
+	std::mutex lock;
+	std::condition_variable changed;
+	std::thread worker;
+
+	void run();
+	void report(Timer& timer);
+};
+
+void ProgressReporterState::run() {
+
+	Timer timer;
+	std::unique_lock<std::mutex> guard(lock);
+
+	while (!changed.wait_for(guard,std::chrono::seconds(1),[this]{return stop;}))
+		report(timer);
+}
+
+void ProgressReporterState::report(Timer& timer) {
+
+	unsigned long long n=nrow.load(std::memory_order_relaxed);
+	unsigned long long p=pos.load(std::memory_order_relaxed);
+	double done,passdone,rate;
+	char line[100];
+	int len;
+
+	if (p>total) p=total;
+	done=(double)p/(double)total;
+	passdone=total>startpos?(double)(p-startpos)/(double)(total-startpos):1.0;
+
+	// Time remaining is extrapolated from progress since reporting started
+
+	timer.setprogress(passdone);
+	rate=timer.elapsed.time>0.0?n/timer.elapsed.time:0.0;
+
+	len=snprintf(line,sizeof(line),"%5.1f%%  %llu rows  %.0f rows/s  %s remaining",
+		done*100.0,n,rate,passdone>1.0e-10?timer.remaining.str:"--:--:--");
+	fprintf(stderr,"\r%s%*s",line,width>len?width-len:0,"");
+	fflush(stderr);
+	width=len;
+}
+
+ProgressReporter progress;
+
+ProgressReporter::ProgressReporter() {
+
+	state=NULL;
+	nrow=0;
+	countdown=PROGRESS_SAMPLE;
+}
+
+ProgressReporter::~ProgressReporter() {
+
+	stop();
+}
+
+void ProgressReporter::start(InputFile& in) {
+
+	stop();
+
+	// Reporting is only for the benefit of someone watching the terminal; it
+	// goes to stderr so that it cannot break into lines the program prints on
+	// stdout while the reporting thread is running
+
+#ifndef _WIN32
+	if (!isatty(fileno(stderr))) return;
+#else
+	if (!_isatty(_fileno(stderr))) return;
+#endif
+	if (!in.filesize()) return;
+
+	state=new ProgressReporterState;
+	if (!state) fail();
+	state->total=in.filesize();
+	state->startpos=in.consumed();
+	state->pos=state->startpos;
+	state->nrow=0;
+	state->stop=false;
+	state->width=0;
+	nrow=0;
+	countdown=PROGRESS_SAMPLE;
+
+	fflush(stdout);
+	state->worker=std::thread(&ProgressReporterState::run,state);
+}
+
+void ProgressReporter::stop() {
+
+	if (!state) return;
+
+	{
+		std::lock_guard<std::mutex> guard(state->lock);
+		state->stop=true;
+		state->changed.notify_all();
+	}
+	state->worker.join();
+
+	if (state->width) {
+		fprintf(stderr,"\r%*s\r",state->width,"");
+		fflush(stderr);
+	}
+
+	delete state;
+	state=NULL;
+}
+
+void ProgressReporter::sample(unsigned long long pos) {
+
+	state->nrow.store(nrow,std::memory_order_relaxed);
+	state->pos.store(pos,std::memory_order_relaxed);
+	countdown=PROGRESS_SAMPLE;
 }
 
 
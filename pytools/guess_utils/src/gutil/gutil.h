@@ -26,6 +26,8 @@
 #include <time.h>
 #include <string.h>
 #include <stdarg.h>
+#include <new>
+#include <utility>
 
 void fail();
 
@@ -74,6 +76,12 @@ void fail();
  *  Note that some of the member functions of xtring can cause the size and memory
  *  position of the internal buffer to change.
  *
+ *  Strings shorter than 16 characters are stored inside the xtring object itself;
+ *  longer strings go to a heap buffer that grows geometrically, so that repeated
+ *  concatenation (e.g. appending a character at a time) has amortised constant
+ *  cost. The buffer is never shrunk, so reassigning a short string to an xtring
+ *  which once held a long one does not reallocate.
+ *
  *  \section ops Operators
  *
  *  Operator functionality is described mainly by code examples. The examples below
@@ -135,19 +143,28 @@ class xtring {
 	 // MEMBER VARIABLES
 
 private:
+	 /// Size of the inline buffer used for short strings (including the trailing \0)
+	 static const unsigned long SSOSIZE=16;
+
 	 char *ptext;
-	 unsigned long nxegment;
-	 char *buf;
+	 union {
+		  char sso[SSOSIZE]; // string buffer while ptext==sso
+		  unsigned long capacity; // size of heap buffer otherwise
+	 };
 
 	 // MEMBER FUNCTIONS
 
 private:
 	 void init();
+	 void release();
+	 unsigned long bufsize() const { return ptext==sso?SSOSIZE:capacity; }
+	 void grow(unsigned long nbyte,unsigned long ncopy);
 	 void resize(unsigned long nchar);
 	 void expand(unsigned long nchar);
 
 public:
 	 xtring(const xtring& s);
+	 xtring(xtring&& s);
 	 xtring();
 	 xtring(char* text);
 	 xtring(const char* inittext);
@@ -275,6 +292,7 @@ public:
 	 void printf(const char* fmt,...);
 
 	 xtring& operator=(xtring& s);
+	 xtring& operator=(xtring&& s);
 	 xtring& operator=(const char* s);
 	 xtring& operator=(char c);
 	 xtring operator+(xtring& s2);
@@ -1446,338 +1464,2078 @@ public:
 };
 
 
-/// Functionality for relating runtime "progress" to real time
-/** The computer model for which gutil was developed can sometimes take many
- *  hours to complete a simulation. It is desirable for users to obtain an
- *  ongoing estimate of progress and remaining simulation time. This class
- *  provides the necessary functionality.
- *
- *  Sample program:
- *
- *  \code
- *  void slow(int i) {
- *    // Do some number crunching
- *  }
- *
- *  int main() {
- *    const int STEPS=1e10;
- *    const int REPORT=1e9;
- *    int i;
- *
- *    Timer t;
- *    t.init();
- *
- *    t.settimer();
- *
- *    for (i=0;i<STEPS;i++) {
- *      t.setprogress(double(i)/double(STEPS));
- *
- *      if (!(i%REPORT)) {
- *        printf("Elapsed time: %s\n",t.elapsed.str);
- *        printf("Remaining time: %s\n",t.remaining.str);
- *      }
+constexpr unsigned int vectorarray_shift(unsigned long size,unsigned int s=0) {
+	// log2 of the number of objects of the given size per VectorArray block
+	return s<12 && (size<<(s+1))<=16384 ? vectorarray_shift(size,s+1) : s;
+}
+
+
+/// Contiguous-storage counterparts of the ListArray templates
+/** VectorArray, VectorArray_id and VectorArray_idin1/2/3 have the same public
+ *  interface as ListArray, ListArray_id and ListArray_idin1/2/3 respectively
+ *  (createobj, initarray where applicable, firstobj/nextobj/getobj, operator[],
+ *  killobj, killall, isobj, nobj). They are not drop-in replacements where
+ *  objects are removed while references to others are held (see killobj below).
  *
- *      slow(i);
- *    }
+ *  Objects are stored consecutively in blocks of around 16 kB rather than
+ *  in separately allocated list nodes, so that sequential traversal touches
+ *  memory in order and operator[] is a shift and a mask rather than a pointer
+ *  lookup.
  *
- *    return 0;
- *  }
- *  \endcode
+ *  Blocks are never moved once allocated, so a reference returned by
+ *  createobj or operator[] stays valid as further objects are created (as it
+ *  does for a ListArray). Unlike ListArray::killobj, which unlinks just the
+ *  one node, killobj closes the gap by moving each later object down one
+ *  position: references to, and indices of, objects after the one removed
+ *  then refer to their successors, and the last reference becomes invalid.
+ *  killobj requires MyObjectType to be move or copy constructible.
  */
-class Timer {
+template<class tdata> class VectorArrayBase {
+
+	 static const unsigned int SHIFT=vectorarray_shift(sizeof(tdata));
+	 static const unsigned int MASK=(1u<<SHIFT)-1;
+
 private:
-	 long m_clock;
-	 long lastclock;
-	 double start_t;
-	 double finish_t;
-	 unsigned long timebase;
-	 double progress;
+	 tdata** block;
+	 unsigned int nblock;
+	 unsigned int maxblock;
+
+	 VectorArrayBase(const VectorArrayBase&)=delete;
+	 VectorArrayBase& operator=(const VectorArrayBase&)=delete;
+
+protected:
+	 unsigned int thisobj;
+
+	 /// Constructs a new object at the end of the array from the given arguments
+	 template<class... targs> tdata& construct(targs&&... args) {
+		  if (nobj>>SHIFT==nblock) {
+				if (nblock==maxblock) {
+					 maxblock=maxblock?maxblock*2:4;
+					 tdata** newblock=new tdata*[maxblock];
+					 if (!newblock) fail();
+					 if (nblock) memcpy(newblock,block,nblock*sizeof(tdata*));
+					 delete[] block;
+					 block=newblock;
+				}
+				block[nblock++]=(tdata*)::operator new(sizeof(tdata)<<SHIFT);
+		  }
+		  tdata* pobj=new(block[nobj>>SHIFT]+(nobj&MASK)) tdata(std::forward<targs>(args)...);
+		  thisobj=nobj++;
+		  isobj=true;
+		  return *pobj;
+	 }
+
 public:
-	 struct {
-		  int hours;          ///< elapsed full hours since timer set
-		  int minutes;        ///< elapsed full minutes past the hour since timer set
-		  int seconds;        ///< elapsed full seconds past the minute since timer set
-		  int milliseconds;   ///< elapsed milliseconds past the second since timer set
-		  double time;
-		  char str[12];       ///< elapsed time in the form "hh:mm:ss"
-	 } elapsed;
+	 /// Whether the internal object pointer points to an object
+	 /** This variable (NB: not a function) is true whenever the internal object
+	  *  pointer points to a MyObjectType object, false otherwise (including
+	  *  when the array is empty).
+	  */
+	 bool isobj;
 
-	 struct {
-		  int hours;          ///< full hours remaining to "finished" status
-		  int minutes;        ///< full minutes past the hour remaining
-		  int seconds;        ///< full seconds past the minute remaining
-		  int milliseconds;   ///< milliseconds past the second remaining
-		  double time;
-		  char str[12];       ///< remaining time in the form "hh:mm:ss"
-	 } remaining;
+	 /// The number of objects currently stored in the array.
+	 unsigned int nobj;
 
-private:
-	 void print() {
-		  if (elapsed.minutes>59 || elapsed.seconds>59 || elapsed.hours>9999) strcpy(elapsed.str,"#time_err#");
-		  else sprintf(elapsed.str,"%d%d:%d%d:%d%d",
-							elapsed.hours/10,elapsed.hours%10,elapsed.minutes/10,
-							elapsed.minutes%10,elapsed.seconds/10,elapsed.seconds%10);
-		  if (remaining.minutes>59 || remaining.seconds>59 || remaining.hours>9999) strcpy(remaining.str,"#time_err#");
-		  sprintf(remaining.str,"%d%d:%d%d:%d%d",
-					 remaining.hours/10,remaining.hours%10,remaining.minutes/10,
-					 remaining.minutes%10,remaining.seconds/10,remaining.seconds%10);
+public:
+	 VectorArrayBase() {
+		  block=NULL;
+		  nblock=0;
+		  maxblock=0;
+		  thisobj=0;
+		  isobj=false;
+		  nobj=0;
+	 }
+
+	 /// Clears the entire array, releasing dynamic memory.
+	 void killall() {
+		  unsigned int i;
+		  for (i=0;i<nobj;i++) (*this)[i].~tdata();
+		  for (i=0;i<nblock;i++) ::operator delete(block[i]);
+		  delete[] block;
+		  block=NULL;
+		  nblock=0;
+		  maxblock=0;
+		  thisobj=0;
+		  isobj=false;
+		  nobj=0;
+	 }
+
+	 ~VectorArrayBase() {
+		  killall();
+	 }
+
+	 /// Go to the first object
+	 /** Causes the internal object pointer to point to the first MyObjectType
+	  *  object in the array. Returns false if the array is empty.
+	  */
+	 bool firstobj() {
+		  thisobj=0;
+		  isobj=nobj>0;
+		  return isobj;
+	 }
+
+	 /// Go to the next object
+	 /** Causes the internal object pointer to point to the next MyObjectType
+	  *  object in the array. Returns false if the last item has already been
+	  *  reached.
+	  */
+	 bool nextobj() {
+		  if (isobj) isobj=++thisobj<nobj;
+		  return isobj;
+	 }
+
+	 /// Returns current object
+	 /** Returns a reference to the object currently pointed to by the internal
+	  *  object pointer. Do not call this function unless the pointer is
+	  *  pointing to a valid object (isobj=true).
+	  */
+	 tdata& getobj() {
+		  return (*this)[thisobj];
+	 }
+
+	 /// Returns i'th object
+	 /** Returns a reference to the i'th MyObjectType item in the array. Does
+	  *  NOT affect the value of the internal pointer.
+	  */
+	 tdata& operator[](unsigned int i) {
+		  return block[i>>SHIFT][i&MASK];
+	 }
+
+	 /// Removes the object currently pointed to by the internal pointer.
+	 /** The internal pointer is left pointing to the object that followed the
+	  *  one removed, if any. Later objects are moved down one position, so
+	  *  (unlike ListArray) references held to them no longer refer to them.
+	  */
+	 void killobj() {
+		  unsigned int i;
+		  if (!isobj) return;
+		  (*this)[thisobj].~tdata();
+		  for (i=thisobj+1;i<nobj;i++) {
+				new(&(*this)[i-1]) tdata(std::move((*this)[i]));
+				(*this)[i].~tdata();
+		  }
+		  nobj--;
+		  isobj=thisobj<nobj;
 	 }
+};
+
+
+/// Contiguous-storage counterpart of ListArray (see VectorArrayBase)
+template<class tdata> class VectorArray : public VectorArrayBase<tdata> {
 
 public:
-	 /// Returns time since start of process in milliseconds
-	 long timemilli() {
-		  long newclock=(long)((double)clock()/(double)CLOCKS_PER_SEC*1000.0);
-		  if (newclock>=lastclock) m_clock+=newclock-lastclock;
-		  lastclock=newclock;
-		  return m_clock;
+	 /// Clears array (if not empty) and fills it with nitem MyObjectType objects.
+	 void initarray(unsigned int nitem) {
+		  unsigned int i;
+		  this->killall();
+		  for (i=0;i<nitem;i++) createobj();
+		  this->firstobj();
 	 }
 
-	 /// Initialises the timer, called by the constructor
-	 void init() {
-		  m_clock=0;
-		  lastclock=(long)((double)clock()/(double)CLOCKS_PER_SEC*1000.0);
-		  timebase=timemilli();
-		  settimer(3600.0);
+	 /// Creates a new object of type MyObjectType and returns a reference to it.
+	 tdata& createobj() {
+		  return this->construct();
 	 }
+};
 
-	 Timer() {
-		  init();
+
+/// Contiguous-storage counterpart of ListArray_id (see VectorArrayBase)
+template<class tdata> class VectorArray_id : public VectorArrayBase<tdata> {
+
+	 unsigned int id;
+
+public:
+	 VectorArray_id() {
+		  id=0;
 	 }
 
-	 void update() {
-		  unsigned long time=timemilli();
-		  elapsed.time=(double)(time-timebase-start_t)/1000.0;
-		  elapsed.hours=(int)(elapsed.time/3600.0);
-		  elapsed.minutes=(int)(elapsed.time-elapsed.hours*3600)/60;
-		  elapsed.seconds=(int)(elapsed.time-elapsed.hours*3600-
-										elapsed.minutes*60);
-		  elapsed.milliseconds=(int)(elapsed.time-elapsed.hours*3600-elapsed.minutes*60-
-				elapsed.seconds);
-		  remaining.time=(double)(finish_t-time+timebase)/1000.0;
-		  if (remaining.time<0.0) remaining.time=0.0;
-		  remaining.hours=(int)(remaining.time/3600.0);
-		  remaining.minutes=(int)(remaining.time-remaining.hours*3600)/60;
-		  remaining.seconds=(int)(remaining.time-remaining.hours*3600-
-										  remaining.minutes*60);
-		  remaining.milliseconds=(int)(remaining.time-remaining.hours*3600-
-				remaining.minutes*60-remaining.seconds);
-		  progress=elapsed.time*1000.0/(finish_t-start_t);
-		  print();
+	 /// Clears the entire array, releasing dynamic memory.
+	 /** Resets the id counter to 0.
+	  */
+	 void killall() {
+		  VectorArrayBase<tdata>::killall();
+		  id=0;
 	 }
 
-	 /// Commences timing
-	 /**
-	  *  \param duration gives number of seconds to "finished" status
+	 /// Clears array (if not empty)
+	 /** Clears array (if not empty), resets id counter to 0 and fills array
+	  *  with nitem MyObjectType objects.
 	  */
-	 void settimer(double duration) {
-		  unsigned long time=timemilli();
-		  start_t=time-timebase;
-		  finish_t=start_t+duration*1000.0;
-		  update();
+	 void initarray(unsigned int nitem) {
+		  unsigned int i;
+		  killall();
+		  for (i=0;i<nitem;i++) createobj();
+		  this->firstobj();
 	 }
 
-	 /// Sets one hour to "finished" status
-	 void settimer() {
-		  settimer(3600.0);
+	 /// Creates a new object of type MyObjectType and returns a reference to it.
+	 /** The id member of the new object is set to the value of a counter
+	  *  which has initial value 0 and is incremented (by 1) on each subsequent
+	  *  call to createobj.
+	  */
+	 tdata& createobj() {
+		  tdata& obj=this->construct();
+		  obj.id=id++;
+		  return obj;
 	 }
+};
 
-	 /// Specifies fractional progress (in range 0-1) towards "finished" status
-	 /** Modifies time remaining to "finished"
+
+/// Contiguous-storage counterpart of ListArray_idin1 (see VectorArrayBase)
+template<class tdata,class tref> class VectorArray_idin1 :
+	 public VectorArrayBase<tdata> {
+
+	 unsigned int id;
+
+public:
+	 VectorArray_idin1() {
+		  id=0;
+	 }
+
+	 /// Clears the entire array, releasing dynamic memory.
+	 /** Resets the id counter to 0.
 	  */
-	 void setprogress(double p) {
-		  if (p>1.0) p=1.0;
-		  update();
-		  if (p>1.0e-10) finish_t=start_t+elapsed.time*1000.0/p;
-		  update();
+	 void killall() {
+		  VectorArrayBase<tdata>::killall();
+		  id=0;
 	 }
 
-	 /// Returns fractional progress (in range 0-1) towards "finished" status
-	 double getprogress() {
-		  update();
-		  return progress;
+	 /// Creates a new object of type MyObjectType and returns a reference to it.
+	 /** Calls the constructor MyObjectType(unsigned int,MyRefType&) with the
+	  *  value of the id counter (initially 0, incremented on each call) and ref.
+	  */
+	 tdata& createobj(tref& ref) {
+		  return this->construct(id++,ref);
 	 }
 };
 
 
-/// Writes date and time in standard Unix format to an xtring argument
-/** e.g. "Tue Nov 06 10:17:47 2001"
- */
-void unixtime(xtring& result);
+/// Contiguous-storage counterpart of ListArray_idin2 (see VectorArrayBase)
+template<class tdata,class tref1,class tref2> class VectorArray_idin2 :
+	 public VectorArrayBase<tdata> {
 
+	 unsigned int id;
 
-/// Reads text according to FORTRAN-style format specification
-/** Function synopsis: bool readfor(FILE* strm, xtring format, ...)
- *
- *  Reads in ASCII text data from input stream strm, according to a FORTRAN-style
- *  format specification given in the string format. Addresses of the variables to be
- *  assigned to are listed, in order of assignment, in the ellipsis (...) argument list
- *  of the function. By default, any characters remaining on the current line are
- *  discarded when the statement terminates (this behaviour can be overridden by a $
- *  specifier in the format string - see below). The function returns true if all
- *  specified values could be read in and assigned, or false if an end-of-file
- *  condition prevented some values from being read in and assigned.
- *
- *  Version modified 2005-09-13
- *  The only change is that "a" format now reads only as far as next white space
- *  character (or comma, or separator specified in format string), instead of end of
- *  line as previously. The read to end of line specify "a#" in format string.
- *
- *  Example: The following code opens for reading a text file called "climate.txt",
- *  reads in two values of type double, one integer, and 12 further values of type
- *  double, and assigns these values, respectively, to variables lon, lat, elev, and
- *  the 12 elements of array mdata. Note that the arguments following the format
- *  string are addresses of the variables to be assigned to - use the '&' prefix for
- *  simple variables; omit the '&' if specifying an array name (a pointer).
- *
- *  \code
- *  #include <stdio.h>
- *  #include <gutil.h>
+public:
+	 VectorArray_idin2() {
+		  id=0;
+	 }
+
+	 /// Clears the entire array, releasing dynamic memory.
+	 /** Resets the id counter to 0.
+	  */
+	 void killall() {
+		  VectorArrayBase<tdata>::killall();
+		  id=0;
+	 }
+
+	 /// Creates a new object of type MyObjectType and returns a reference to it.
+	 /** Calls the constructor MyObjectType(unsigned int,MyRefType1&,MyRefType2&)
+	  *  with the value of the id counter (initially 0, incremented on each call),
+	  *  ref1 and ref2.
+	  */
+	 tdata& createobj(tref1& ref1,tref2& ref2) {
+		  return this->construct(id++,ref1,ref2);
+	 }
+};
+
+
+/// Contiguous-storage counterpart of ListArray_idin3 (see VectorArrayBase)
+template<class tdata,class tref1,class tref2,class tref3> class VectorArray_idin3 :
+	 public VectorArrayBase<tdata> {
+
+	 unsigned int id;
+
+public:
+	 VectorArray_idin3() {
+		  id=0;
+	 }
+
+	 /// Clears the entire array, releasing dynamic memory.
+	 /** Resets the id counter to 0.
+	  */
+	 void killall() {
+		  VectorArrayBase<tdata>::killall();
+		  id=0;
+	 }
+
+	 /// Creates a new object of type MyObjectType and returns a reference to it.
+	 /** Calls the constructor
+	  *  MyObjectType(unsigned int,MyRefType1&,MyRefType2&,MyRefType3&) with the
+	  *  value of the id counter (initially 0, incremented on each call), ref1,
+	  *  ref2 and ref3.
+	  */
+	 tdata& createobj(tref1& ref1,tref2& ref2,tref3& ref3) {
+		  return this->construct(id++,ref1,ref2,ref3);
+	 }
+};
+
+
+/// Table of records accumulated from the rows of an input file
+/** Holds one double precision value per row and column, stored column by
+ *  column: the values of each column lie in one contiguous array, so that
+ *  scanning a column touches consecutive memory. The number of columns is set
+ *  at run time (by init) to the number actually in the input, and rows are
+ *  appended as they are needed, so memory use follows the data rather than a
+ *  compile-time maximum.
  *
- *  FILE* in;
- *  double lon,lat;
- *  int elev;
- *  double mdata[12];
+ *  Each row also has a weight, the sum of the weights of the records added to
+ *  it. With the default weight of 1 this is a count of records, and average()
+ *  gives the mean of each column:
  *
- *  in=fopen("climate.txt","rt");
- *  if (!readfor(in,"f6.1,f5.1,i4,12f5.1",&lon,&lat,&elev,mdata))
- *     printf("Warning: not all values could be read in\n");
+ *  \code
+ *    RecordTable data;
+ *    data.init(nitem);
+ *    ...
+ *    row=data.addrow();            // all values and weight 0
+ *    data.add(row,values);         // values[0] to values[nitem-1]
+ *    ...
+ *    data.average();
+ *    mean=data(row,col);
  *  \endcode
+ */
+class RecordTable {
+
+	 // MEMBER VARIABLES
+
+private:
+	 double* values;        ///< column c is values[c*maxrow] to values[c*maxrow+nrow-1]
+	 double* weights;       ///< summed weight of each row
+	 int ncol;
+	 unsigned long nrow;
+	 unsigned long maxrow;  ///< rows allocated
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 RecordTable();
+	 ~RecordTable();
+
+	 /// Empties the table and sets the number of columns
+	 void init(int ncolumn);
+
+	 /// Empties the table, releasing dynamic memory
+	 void clear();
+
+	 /// Number of columns
+	 int ncolumn() const {
+		  return ncol;
+	 }
+
+	 /// Number of rows
+	 unsigned long size() const {
+		  return nrow;
+	 }
+
+	 /// Appends a row with all values and the weight zero, returning its index
+	 unsigned long addrow() {
+		  if (nrow==maxrow) grow();
+		  for (int c=0;c<ncol;c++) values[c*maxrow+nrow]=0.0;
+		  weights[nrow]=0.0;
+		  return nrow++;
+	 }
+
+	 /// Appends n rows with all values and weights zero, returning the index of the first
+	 unsigned long addrows(unsigned long n);
+
+	 /// Value in a given row and column
+	 double& operator()(unsigned long row,int col) {
+		  return values[col*maxrow+row];
+	 }
+
+	 double operator()(unsigned long row,int col) const {
+		  return values[col*maxrow+row];
+	 }
+
+	 /// Values of a column (size() of them)
+	 double* column(int col) {
+		  return values+col*maxrow;
+	 }
+
+	 const double* column(int col) const {
+		  return values+col*maxrow;
+	 }
+
+	 /// Summed weight of a row
+	 double& weight(unsigned long row) {
+		  return weights[row];
+	 }
+
+	 double weight(unsigned long row) const {
+		  return weights[row];
+	 }
+
+	 /// Adds a record to a row
+	 /** \param val values of the record, one per column
+	  *  \param w weight of the record; val is multiplied by w before being added
+	  */
+	 void add(unsigned long row,const double* val,double w=1.0) {
+		  double* pval=values+row;
+		  for (int c=0;c<ncol;c++,pval+=maxrow) *pval+=val[c]*w;
+		  weights[row]+=w;
+	 }
+
+	 /// Replaces the values and weight of a row
+	 void set(unsigned long row,const double* val,double w=1.0) {
+		  double* pval=values+row;
+		  for (int c=0;c<ncol;c++,pval+=maxrow) *pval=val[c];
+		  weights[row]=w;
+	 }
+
+	 /// Divides the values of each row by its weight (rows with weight 0 are left as they are)
+	 void average();
+
+private:
+	 void grow();
+	 RecordTable(const RecordTable&);
+	 RecordTable& operator=(const RecordTable&);
+};
+
+
+/// Default memory (in bytes) used by a RowBuffer before rows go to a temporary file
+const unsigned long long ROWBUFFER_MEMORY=256*1024*1024;
+
+/// Rows of numbers kept for a second pass over them
+/** Rows, each of the same number of values, are appended during one pass over
+ *  an input file and fetched back in the same order afterwards, in place of
+ *  reading and converting the text again. Rows are held in memory up to a
+ *  limit (by default ROWBUFFER_MEMORY bytes), beyond which they are written in
+ *  binary form to a temporary file, so that files of any size can be buffered.
+ *  All rows are to be added before the first call to rewind.
  *
- *  \section format Format specifiers
- *
- *  A subset of the format specifiers defined for input in the FORTRAN-77 language are
- *  supported by function readfor. Note that there are some differences in the way
- *  these are implemented compared to FORTRAN. Specifier fields in the format string
- *  are normally separated by commas. Each instance of an F, I or A specifier is
- *  assumedto correspond to one argument in the ellipsis argument list. Specifier
- *  syntax is case-insensitive and spaces and tabs in the format string are ignored.
- *
- *  Important: a value (other than 1) for n (number of items), if specified as part of
- *  an F, I or A specification, assumes the values read are to be assigned to
- *  consecutive elements of an array, whose starting address is given by a single
- *  argument in the argument list. Do not use this feature to assign multiple values
- *  with the same input format to multiple consective arguments.
- *
- *  \subsection float Floating point specifier: nFw.dEe
- *
- *    Reads one or more floating point numbers, assigning each value to a variable of
- *    type double.
+ *  \code
+ *    RowBuffer rows;
+ *    rows.init(nitem);
+ *    while (...) rows.add(values);    // values[0] to values[nitem-1]
+ *    rows.rewind();
+ *    while ((row=rows.next())) ...    // row[0] to row[nitem-1]
+ *  \endcode
+ */
+class RowBuffer {
+
+	 // MEMBER VARIABLES
+
+private:
+	 double* mem;           ///< rows held in memory
+	 double* readbuf;       ///< block of rows read back from the temporary file
+	 FILE* spill;           ///< temporary file for the rows that do not fit in memory
+	 int nval;
+	 unsigned long nmem;    ///< rows in memory
+	 unsigned long maxmem;  ///< rows allocated in memory
+	 unsigned long memlimit; ///< most rows to hold in memory
+	 unsigned long long nrow;
+	 unsigned long long nread; ///< rows fetched since rewind
+	 unsigned long nreadbuf; ///< rows in readbuf
+	 unsigned long readpos;  ///< next row of readbuf to fetch
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 RowBuffer();
+	 ~RowBuffer();
+
+	 /// Empties the buffer and sets the number of values in each row
+	 /** \param maxmemory bytes of memory to use before rows go to a temporary file */
+	 void init(int nvalue,unsigned long long maxmemory=ROWBUFFER_MEMORY);
+
+	 /// Empties the buffer, releasing memory and removing any temporary file
+	 void clear();
+
+	 /// Number of rows in the buffer
+	 unsigned long long size() const {
+		  return nrow;
+	 }
+
+	 /// Appends a row of nvalue values
+	 void add(const double* values);
+
+	 /// Continues fetching from the first row
+	 void rewind();
+
+	 /// Fetches the next row
+	 /** \returns the values of the row (valid until the next call), or NULL
+	  *           after the last row
+	  */
+	 const double* next();
+
+private:
+	 RowBuffer(const RowBuffer&);
+	 RowBuffer& operator=(const RowBuffer&);
+};
+
+
+/// Index of the grid cells (longitude-latitude pairs) found in an input file
+/** Each distinct pair of coordinates is given a cell number, counting from 0
+ *  in the order in which the cells are added. Cells are found with a hash
+ *  table using open addressing, keyed on the coordinates rounded to hundredths
+ *  of a degree, so that a lookup takes constant time whatever the order of the
+ *  rows in the file. Coordinates are still compared exactly: two cells closer
+ *  together than the rounding are kept apart.
  *
- *    - n - the number of items to read in; if n is not specified, one value is assumed.
- *          See cautionary note above.
- *    - w - the number of characters to read in for each item; if not specified,
- *          characters are read up to the next space, tab, end-of-line, or the next
- *          instance on the current line of a separator character appearing immediately
- *          after the specifier in the format string (see below).
- *    - d - the number of digits in the fractional part of the number; if a decimal point
- *          is encountered, this overrides the specified value. If d is omitted and no
- *          decimal point is encountered, the input string is interpreted as a whole
- *          number.
- *    - e - the number of digits in the exponent part of the number; if the character 'E'
- *          or 'e' is encountered, this overrides the specified value. If e is omitted,
- *          the exponent 0 (i.e., 10^0 = 1) is assumed.
+ *  \code
+ *    CellIndex cells;
+ *    cells.reserve(ncell);           // optional, e.g. the size of a gridlist
+ *    ...
+ *    cell=cells.find(lon,lat);
+ *    if (cell<0) cell=cells.add(lon,lat);
+ *    ...
+ *    for (cell=0;cell<cells.size();cell++) ... cells.lon(cell) ...
+ *  \endcode
+ */
+class CellIndex {
+
+	 // MEMBER VARIABLES
+
+private:
+	 struct Slot {
+		  float lon,lat;
+		  int cell;            ///< -1 if the slot is empty
+	 };
+	 Slot* slots;
+	 unsigned long nslot;      ///< slots allocated, a power of two
+	 float* lons;
+	 float* lats;
+	 int ncell;
+	 int maxcell;              ///< cells allocated in lons and lats
+	 mutable int last;         ///< cell found or added most recently
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 CellIndex();
+	 ~CellIndex();
+
+	 /// Empties the index, releasing dynamic memory
+	 void clear();
+
+	 /// Allocates room for a given number of cells, so that the index is not rebuilt as it fills
+	 void reserve(int n);
+
+	 /// Number of cells
+	 int size() const {
+		  return ncell;
+	 }
+
+	 /// Cell number of a longitude and latitude, or -1 if not in the index
+	 int find(float lon,float lat) const {
+		  // Rows are usually ordered by cell, so the last cell is checked first
+		  if (last>=0 && lons[last]==lon && lats[last]==lat) return last;
+		  return lookup(lon,lat);
+	 }
+
+	 /// Adds a cell not already in the index, returning its number
+	 int add(float lon,float lat);
+
+	 /// Longitude of a cell
+	 float lon(int cell) const {
+		  return lons[cell];
+	 }
+
+	 /// Latitude of a cell
+	 float lat(int cell) const {
+		  return lats[cell];
+	 }
+
+private:
+	 int lookup(float lon,float lat) const;
+	 unsigned long hash(float lon,float lat) const;
+	 void rehash(unsigned long newslot);
+	 CellIndex(const CellIndex&);
+	 CellIndex& operator=(const CellIndex&);
+};
+
+
+/// Default accuracy parameter k of a QuantileSketch
+const int QUANTILESKETCH_K=200;
+
+/// Approximate quantiles of a stream of numbers in bounded memory
+/** A KLL sketch (Karnin, Lang and Liberty 2016). Values are kept in a stack
+ *  of levels, each value at level h standing for 2^h values of the stream.
+ *  When a level fills up it is sorted and every other value is moved up a
+ *  level. Capacities shrink by a factor 2/3 for each level below the top, so
+ *  that a sketch holds about 3k values however long the stream, and the rank
+ *  of a quantile is accurate to around 2/k of the number of values (about 1%
+ *  with the default k of 200).
  *
- *    Examples:
+ *  Quantiles are exact as long as no more than k values have been added, and
+ *  always with k=0, which keeps every value. Exact quantiles interpolate
+ *  linearly between the nearest values, as R's default quantile().
  *
- *    \verbatim
-      Input stream: 1234 5.67
-      Format spec    Strings read    Values assigned
-      F              "1234"          1234.0
-      F3             "123"           123.0
-      F3.1           "123"           12.3
-      F4.2E1         "1234"          1.23E+04
-      2F4.2          "1234", " 5.6"  12.34, 5.6
-      \endverbatim
+ *  \code
+ *    QuantileSketch sketch;
+ *    sketch.init();                  // or init(0) for exact quantiles
+ *    while (...) sketch.add(value);
+ *    median=sketch.quantile(0.5);
+ *  \endcode
  *
- *  \subsection integer Integer specifier: nIw
+ *  Sketches of parts of a stream (e.g. read on separate threads) may be
+ *  combined with merge.
+ */
+class QuantileSketch {
+
+	 // MEMBER VARIABLES
+
+private:
+	 double** levels;
+	 int* nval;                ///< values in each level
+	 int* maxval;              ///< values allocated for each level
+	 int nlevel;
+	 int k;
+	 int cap0;                 ///< capacity of level 0
+	 unsigned int random;      ///< state of the generator choosing the values compactions keep
+	 unsigned long long count;
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 QuantileSketch();
+	 ~QuantileSketch();
+
+	 /// Empties the sketch and sets its accuracy parameter (0 to keep every value)
+	 void init(int kvalue=QUANTILESKETCH_K);
+
+	 /// Empties the sketch, releasing dynamic memory
+	 void clear();
+
+	 /// Number of values added
+	 unsigned long long size() const {
+		  return count;
+	 }
+
+	 /// Adds a value
+	 void add(double value) {
+		  if (nval[0]==maxval[0]) reserve(0,nval[0]+1);
+		  levels[0][nval[0]++]=value;
+		  count++;
+		  if (nval[0]>cap0) compress();
+	 }
+
+	 /// Adds the values summarised by another sketch
+	 /** The levels of other are appended to those of this sketch and then
+	  *  compacted, so that the result is as accurate as a sketch to which all
+	  *  values had been added. The accuracy parameter of this sketch is kept.
+	  */
+	 void merge(const QuantileSketch& other);
+
+	 /// Value of quantile q (0 to 1) of the values added, 0 if there are none
+	 double quantile(double q) const;
+
+private:
+	 int capacity(int h) const;
+	 void reserve(int h,int n);
+	 void addlevel();
+	 void compress();
+	 void compact(int h);
+	 QuantileSketch(const QuantileSketch&);
+	 QuantileSketch& operator=(const QuantileSketch&);
+};
+
+
+/// Functionality for relating runtime "progress" to real time
+/** The computer model for which gutil was developed can sometimes take many
+ *  hours to complete a simulation. It is desirable for users to obtain an
+ *  ongoing estimate of progress and remaining simulation time. This class
+ *  provides the necessary functionality.
  *
- *    Reads one or more integers, assigning each value to a variable of type int.
+ *  Sample program:
  *
- *    - n -  the number of items to read in; if n is not specified, one value is assumed.
- *           See cautionary note above.
- *    - w -  the number of characters to read in for each item; if not specified,
- *           characters are read up to the next space, tab, end-of-line, or the next
- *           instance on the current line of a separator character appearing immediately
- *           after the specifier in the format string (see below).
+ *  \code
+ *  void slow(int i) {
+ *    // Do some number crunching
+ *  }
  *
- *    Examples:
+ *  int main() {
+ *    const int STEPS=1e10;
+ *    const int REPORT=1e9;
+ *    int i;
  *
- *    \verbatim
-      Input stream: 123 4567
-      Format spec    Strings read    Values assigned
-      I              "123"           123
-      I2             "12"            12
-      2I4            "123 ", "4567"  123, 4567
-      \endverbatim
- *  \subsection char Character string specifier: nAw
+ *    Timer t;
+ *    t.init();
  *
- *    Reads one or more character strings, assigning each to a variable of type xtring.
+ *    t.settimer();
  *
- *    - n -  the number of items to read in; if n is not specified, one value is assumed.
+ *    for (i=0;i<STEPS;i++) {
+ *      t.setprogress(double(i)/double(STEPS));
  *
- *    - w -  the number of characters to read for each item; if not specified, characters
- *           are read up to the next white space character, comma, or the next instance of
- *           a separator character appearing immediately after the specifier in the format
- *           string (see below).
+ *      if (!(i%REPORT)) {
+ *        printf("Elapsed time: %s\n",t.elapsed.str);
+ *        printf("Remaining time: %s\n",t.remaining.str);
+ *      }
  *
- *    Specify # after specified to read to end of line (see below)
+ *      slow(i);
+ *    }
  *
- *    Examples:
+ *    return 0;
+ *  }
+ *  \endcode
+ */
+class Timer {
+private:
+	 unsigned long long origin;
+	 double start_t;
+	 double finish_t;
+	 unsigned long timebase;
+	 double progress;
+public:
+	 struct {
+		  int hours;          ///< elapsed full hours since timer set
+		  int minutes;        ///< elapsed full minutes past the hour since timer set
+		  int seconds;        ///< elapsed full seconds past the minute since timer set
+		  int milliseconds;   ///< elapsed milliseconds past the second since timer set
+		  double time;
+		  char str[12];       ///< elapsed time in the form "hh:mm:ss"
+	 } elapsed;
+
+	 struct {
+		  int hours;          ///< full hours remaining to "finished" status
+		  int minutes;        ///< full minutes past the hour remaining
+		  int seconds;        ///< full seconds past the minute remaining
+		  int milliseconds;   ///< milliseconds past the second remaining
+		  double time;
+		  char str[12];       ///< remaining time in the form "hh:mm:ss"
+	 } remaining;
+
+private:
+	 void print() {
+		  if (elapsed.hours<0 || elapsed.hours>9999 || elapsed.minutes<0 || elapsed.minutes>59 ||
+			   elapsed.seconds<0 || elapsed.seconds>59)
+				strcpy(elapsed.str,"#time_err#");
+		  else snprintf(elapsed.str,sizeof(elapsed.str),"%d%d:%d%d:%d%d",
+							elapsed.hours/10,elapsed.hours%10,elapsed.minutes/10,
+							elapsed.minutes%10,elapsed.seconds/10,elapsed.seconds%10);
+		  if (remaining.hours<0 || remaining.hours>9999 || remaining.minutes<0 || remaining.minutes>59 ||
+			   remaining.seconds<0 || remaining.seconds>59)
+				strcpy(remaining.str,"#time_err#");
+		  else snprintf(remaining.str,sizeof(remaining.str),"%d%d:%d%d:%d%d",
+					 remaining.hours/10,remaining.hours%10,remaining.minutes/10,
+					 remaining.minutes%10,remaining.seconds/10,remaining.seconds%10);
+	 }
+
+public:
+	 /// Reads a monotonic clock with nanosecond resolution
+	 /** Returns nanoseconds since an arbitrary (but fixed) point in time.
+	  *  Unlike clock(), which measures processor time of the calling process,
+	  *  this measures real time, and is unaffected by changes to the system
+	  *  clock.
+	  */
+	 static unsigned long long nanotime();
+
+	 /// Returns real time in milliseconds since the timer was initialised
+	 long timemilli() {
+		  return (long)((nanotime()-origin)/1000000);
+	 }
+
+	 /// Initialises the timer, called by the constructor
+	 void init() {
+		  origin=nanotime();
+		  timebase=timemilli();
+		  settimer(3600.0);
+	 }
+
+	 Timer() {
+		  init();
+	 }
+
+	 void update() {
+		  unsigned long time=timemilli();
+		  elapsed.time=(double)(time-timebase-start_t)/1000.0;
+		  elapsed.hours=(int)(elapsed.time/3600.0);
+		  elapsed.minutes=(int)(elapsed.time-elapsed.hours*3600)/60;
+		  elapsed.seconds=(int)(elapsed.time-elapsed.hours*3600-
+										elapsed.minutes*60);
+		  elapsed.milliseconds=(int)(elapsed.time-elapsed.hours*3600-elapsed.minutes*60-
+				elapsed.seconds);
+		  remaining.time=(double)(finish_t-time+timebase)/1000.0;
+		  if (remaining.time<0.0) remaining.time=0.0;
+		  remaining.hours=(int)(remaining.time/3600.0);
+		  remaining.minutes=(int)(remaining.time-remaining.hours*3600)/60;
+		  remaining.seconds=(int)(remaining.time-remaining.hours*3600-
+										  remaining.minutes*60);
+		  remaining.milliseconds=(int)(remaining.time-remaining.hours*3600-
+				remaining.minutes*60-remaining.seconds);
+		  progress=elapsed.time*1000.0/(finish_t-start_t);
+		  print();
+	 }
+
+	 /// Commences timing
+	 /**
+	  *  \param duration gives number of seconds to "finished" status
+	  */
+	 void settimer(double duration) {
+		  unsigned long time=timemilli();
+		  start_t=time-timebase;
+		  finish_t=start_t+duration*1000.0;
+		  update();
+	 }
+
+	 /// Sets one hour to "finished" status
+	 void settimer() {
+		  settimer(3600.0);
+	 }
+
+	 /// Specifies fractional progress (in range 0-1) towards "finished" status
+	 /** Modifies time remaining to "finished"
+	  */
+	 void setprogress(double p) {
+		  if (p>1.0) p=1.0;
+		  update();
+		  if (p>1.0e-10) finish_t=start_t+elapsed.time*1000.0/p;
+		  update();
+	 }
+
+	 /// Returns fractional progress (in range 0-1) towards "finished" status
+	 double getprogress() {
+		  update();
+		  return progress;
+	 }
+};
+
+
+/// Phase timings and throughput counters for one run of a program
+/** The time spent in each phase of processing is measured with the monotonic
+ *  clock of Timer::nanotime(). A program announces the phase it is entering with
+ *  setphase(); the time since the previous call is charged to the phase that
+ *  was then current. Library code which does work on behalf of a phase (e.g.
+ *  OutputFile writing its buffer to disk) switches to that phase and back:
  *
- *    \verbatim
-      Input stream: BERT HIGGINS
-      Format spec    Strings read and assigned
-      A              "BERT"
-      A#             "BERT HIGGINS"
-      A2             "BE"
-      2A6            "BERT H", "IGGINS"
-      \endverbatim
+ *  \code
+ *    int prev=runstats.setphase(RunStats::PHASE_WRITE);
+ *    fwrite(...);
+ *    runstats.setphase(prev);
+ *  \endcode
  *
- *  \subsection pos Position specifier: nX
+ *  Phases are timed only after enable() has been called (typically in
+ *  response to a -stats command line option), so that setphase costs no more
+ *  than a test otherwise. The counters are maintained regardless: bytesread
+ *  and byteswritten by InputFile, ChunkedReader and OutputFile, and the row
+ *  counters by the programs themselves.
  *
- *    Advances one or more characters on the input stream.
+ *  print() writes the timings and counters as a single line of JSON to
+ *  stderr, e.g. (all on one line):
  *
- *    - n - The number of characters to read and discard; if n is omitted, a single
- *          character is read in and discarded.
+ *  \code
+ *    {"tool":"tslice","wall_s":1.834,"phase_s":{"header":0.0001,"read":1.21,
+ *     "aggregate":0.41,"format":0.012,"write":0.0009,"other":0.2},
+ *     "bytes_read":48000109,"rows_parsed":200000,"rows_blank":0,
+ *     "rows_nonnumeric":0,"bytes_written":120911,"rows_per_s":109051,
+ *     "read_mb_per_s":26.17,"write_mb_per_s":0.06593}
+ *  \endcode
  *
- *  \subsection eol End-of-line specifier: /
+ *  Byte counts are of uncompressed text.
+ */
+class RunStats {
+
+public:
+	 /// Phases of processing (PHASE_NONE covers everything else)
+	 enum {PHASE_NONE,PHASE_HEADER,PHASE_READ,PHASE_AGGREGATE,PHASE_FORMAT,
+		  PHASE_WRITE,NPHASE};
+
+	 // MEMBER VARIABLES
+
+	 unsigned long long bytesread;      ///< bytes of input text consumed
+	 unsigned long long rowsparsed;     ///< data rows read successfully
+	 unsigned long long rowsblank;      ///< rows skipped as blank
+	 unsigned long long rowsnonnumeric; ///< rows flagged as containing non-numeric data
+	 unsigned long long byteswritten;   ///< bytes of output text produced
+
+private:
+	 bool timing;
+	 int current;
+	 unsigned long long start;
+	 unsigned long long last;
+	 unsigned long long elapsed[NPHASE];
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 RunStats();
+
+	 /// Starts timing phases; the wall time reported by print is measured from here
+	 void enable();
+
+	 /// Whether enable has been called
+	 bool enabled() const {
+		  return timing;
+	 }
+
+	 /// Enters phase p, returning the phase that was current
+	 int setphase(int p) {
+		  int prev=current;
+		  if (timing && p!=current) {
+				unsigned long long now=Timer::nanotime();
+				elapsed[current]+=now-last;
+				last=now;
+		  }
+		  current=p;
+		  return prev;
+	 }
+
+	 /// Writes timings and counters to stderr as JSON (if enabled)
+	 /** \param tool name of the program, included in the output
+	  */
+	 void print(const char* tool);
+};
+
+/// Statistics for the current program
+extern RunStats runstats;
+
+
+/// Writes date and time in standard Unix format to an xtring argument
+/** e.g. "Tue Nov 06 10:17:47 2001"
+ */
+void unixtime(xtring& result);
+
+
+/// Block-buffered line reader used by readfor
+/** Fetches whole lines from a stream into an internal buffer and exposes the
+ *  unread part of the current line as a pointer/length view, so that fields can
+ *  be located with memchr and converted in place instead of being pulled one
+ *  character at a time through getc.
  *
- *    Advances to the end of the current line on the input stream. Input continues from
- *    the start of the next line.
+ *  Lines are fetched with fgets, which copies out of the stream's own buffer and
+ *  stops at the newline. The stream is therefore never read beyond the current
+ *  line, and feof(), rewind() etc. on the FILE* behave between calls to readfor
+ *  exactly as they did with character-at-a-time input.
  *
- *  \subsection suppress Suppress line feed specifier: $
+ *  \code
+ *     LineReader lr;
+ *     lr.attach(in);
+ *     while (lr.fill()) {
+ *       // characters lr.pos .. lr.end-1 are the unread part of the line
+ *       lr.takeeol();
+ *     }
+ *  \endcode
+ */
+class LineReader {
+
+	 // MEMBER VARIABLES
+
+private:
+	 FILE* in;
+	 char* buf;
+	 unsigned long size;
+	 bool havenl;
+	 const char* mem; ///< next line of a memory block being read (if in is NULL)
+	 const char* memend;
+	 unsigned long nread; ///< characters read from the stream since the last reset
+
+public:
+	 char* pos;       ///< next unread character of the current line
+	 char* end;       ///< end of the current line (position of the newline, if any)
+	 char* pushed;    ///< position of a character returned to the stream, or NULL
+	 bool haveline;   ///< whether a line is loaded (false once its newline is consumed)
+	 bool ateof;      ///< whether an attempt to read past the end of the stream was made
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 LineReader();
+	 ~LineReader();
+
+	 /// Switches input to stream strm
+	 /** Discards any buffered input if strm is not the stream currently
+	  *  attached, or if the end-of-file condition on strm has been cleared
+	  *  (e.g. by rewind) since it was last reached.
+	  */
+	 void attach(FILE* strm);
+
+	 /// Switches input to the memory block begin .. end-1
+	 /** Lines are then delimited in place, without copying. The block is
+	  *  treated like a complete stream (the end of the block is end of file).
+	  */
+	 void attach(const char* begin,const char* end);
+
+	 /// Returns the next unread character of the memory block being read
+	 const char* tell() const {
+		  return haveline?pos:mem;
+	 }
+
+	 /// Returns the number of characters of the stream consumed since the last reset
+	 unsigned long streampos() const {
+		  return haveline?nread-(end-pos)-havenl:nread;
+	 }
+
+	 /// Discards any buffered input
+	 void reset();
+
+	 /// Loads the next line if the current one is finished
+	 /** Returns false (and sets ateof) if the end of the stream is reached.
+	  */
+	 bool fill() {
+		  if (haveline) return true;
+		  return nextline();
+	 }
+
+	 /// Consumes the end of the current line
+	 /** Equivalent to reading the newline character (or end of file, if the
+	  *  last line of the stream is not terminated by a newline).
+	  */
+	 void takeeol() {
+		  haveline=false;
+		  if (!havenl) ateof=true;
+	 }
+
+private:
+	 bool nextline();
+	 LineReader(const LineReader&);
+	 LineReader& operator=(const LineReader&);
+};
+
+
+/// Reads text according to FORTRAN-style format specification
+/** Function synopsis: bool readfor(FILE* strm, xtring format, ...)
  *
- *    If given as the last significant character in the format string, suppresses
- *    reading and discarding of the remainder of the current line on the input stream.
+ *  Reads in ASCII text data from input stream strm, according to a FORTRAN-style
+ *  format specification given in the string format. Addresses of the variables to be
+ *  assigned to are listed, in order of assignment, in the ellipsis (...) argument list
+ *  of the function. By default, any characters remaining on the current line are
+ *  discarded when the statement terminates (this behaviour can be overridden by a $
+ *  specifier in the format string - see below). The function returns true if all
+ *  specified values could be read in and assigned, or false if an end-of-file
+ *  condition prevented some values from being read in and assigned.
  *
- *  \subsection readeol Read to end of line specifier: #
+ *  Version modified 2005-09-13
+ *  The only change is that "a" format now reads only as far as next white space
+ *  character (or comma, or separator specified in format string), instead of end of
+ *  line as previously. The read to end of line specify "a#" in format string.
  *
- *    Continues reading to end of line (intended for use with character string (A)
- *    specifier).
+ *  Example: The following code opens for reading a text file called "climate.txt",
+ *  reads in two values of type double, one integer, and 12 further values of type
+ *  double, and assigns these values, respectively, to variables lon, lat, elev, and
+ *  the 12 elements of array mdata. Note that the arguments following the format
+ *  string are addresses of the variables to be assigned to - use the '&' prefix for
+ *  simple variables; omit the '&' if specifying an array name (a pointer).
  *
- *  \subsection sep Separator character specifier:
+ *  \code
+ *  #include <stdio.h>
+ *  #include <gutil.h>
  *
- *    Any character other than a space, tab or comma, that cannot be interpreted as part
- *    of one of the specifiers above, is interpreted as a separator character, and
- *    causes input up to and including the first instance of the specified separator
- *    character on the current line. If given immediately following a variable-width F,
- *    I or A specification, input continues, for each item, until an instance of the
- *    specified separator character is encountered, or the end of the current line is
- *    reached (otherwise input continues until a space, tab or the end of the line is
- *    reached). If the separator character follows a fixed-width F, I or A specification,
- *    or forms a separate specification field, the characters read are discarded.
+ *  FILE* in;
+ *  double lon,lat;
+ *  int elev;
+ *  double mdata[12];
  *
- *    Examples:
+ *  in=fopen("climate.txt","rt");
+ *  if (!readfor(in,"f6.1,f5.1,i4,12f5.1",&lon,&lat,&elev,mdata))
+ *     printf("Warning: not all values could be read in\n");
+ *  \endcode
  *
- *    \verbatim
-      Input stream: 123; Hello World!; 3.142
-      Format spec    Strings read                     Values assigned
-      I;A;F          "123", " Hello World!", "3.142"  123, " Hello World!", 3.142
-      F2.1;;I2,A     "12", " 3", ".142"               1.2, 3, ".142"
-		\endverbatim
+ *  \section format Format specifiers
  *
- */
-bool readfor(FILE* in, const char* fmt, ...);
+ *  A subset of the format specifiers defined for input in the FORTRAN-77 language are
+ *  supported by function readfor. Note that there are some differences in the way
+ *  these are implemented compared to FORTRAN. Specifier fields in the format string
+ *  are normally separated by commas. Each instance of an F, I or A specifier is
+ *  assumedto correspond to one argument in the ellipsis argument list. Specifier
+ *  syntax is case-insensitive and spaces and tabs in the format string are ignored.
+ *
+ *  Important: a value (other than 1) for n (number of items), if specified as part of
+ *  an F, I or A specification, assumes the values read are to be assigned to
+ *  consecutive elements of an array, whose starting address is given by a single
+ *  argument in the argument list. Do not use this feature to assign multiple values
+ *  with the same input format to multiple consective arguments.
+ *
+ *  \subsection float Floating point specifier: nFw.dEe
+ *
+ *    Reads one or more floating point numbers, assigning each value to a variable of
+ *    type double.
+ *
+ *    - n - the number of items to read in; if n is not specified, one value is assumed.
+ *          See cautionary note above.
+ *    - w - the number of characters to read in for each item; if not specified,
+ *          characters are read up to the next space, tab, end-of-line, or the next
+ *          instance on the current line of a separator character appearing immediately
+ *          after the specifier in the format string (see below).
+ *    - d - the number of digits in the fractional part of the number; if a decimal point
+ *          is encountered, this overrides the specified value. If d is omitted and no
+ *          decimal point is encountered, the input string is interpreted as a whole
+ *          number.
+ *    - e - the number of digits in the exponent part of the number; if the character 'E'
+ *          or 'e' is encountered, this overrides the specified value. If e is omitted,
+ *          the exponent 0 (i.e., 10^0 = 1) is assumed.
+ *
+ *    Examples:
+ *
+ *    \verbatim
+      Input stream: 1234 5.67
+      Format spec    Strings read    Values assigned
+      F              "1234"          1234.0
+      F3             "123"           123.0
+      F3.1           "123"           12.3
+      F4.2E1         "1234"          1.23E+04
+      2F4.2          "1234", " 5.6"  12.34, 5.6
+      \endverbatim
+ *
+ *  \subsection integer Integer specifier: nIw
+ *
+ *    Reads one or more integers, assigning each value to a variable of type int.
+ *
+ *    - n -  the number of items to read in; if n is not specified, one value is assumed.
+ *           See cautionary note above.
+ *    - w -  the number of characters to read in for each item; if not specified,
+ *           characters are read up to the next space, tab, end-of-line, or the next
+ *           instance on the current line of a separator character appearing immediately
+ *           after the specifier in the format string (see below).
+ *
+ *    Examples:
+ *
+ *    \verbatim
+      Input stream: 123 4567
+      Format spec    Strings read    Values assigned
+      I              "123"           123
+      I2             "12"            12
+      2I4            "123 ", "4567"  123, 4567
+      \endverbatim
+ *  \subsection char Character string specifier: nAw
+ *
+ *    Reads one or more character strings, assigning each to a variable of type xtring.
+ *
+ *    - n -  the number of items to read in; if n is not specified, one value is assumed.
+ *
+ *    - w -  the number of characters to read for each item; if not specified, characters
+ *           are read up to the next white space character, comma, or the next instance of
+ *           a separator character appearing immediately after the specifier in the format
+ *           string (see below).
+ *
+ *    Specify # after specified to read to end of line (see below)
+ *
+ *    Examples:
+ *
+ *    \verbatim
+      Input stream: BERT HIGGINS
+      Format spec    Strings read and assigned
+      A              "BERT"
+      A#             "BERT HIGGINS"
+      A2             "BE"
+      2A6            "BERT H", "IGGINS"
+      \endverbatim
+ *
+ *  \subsection pos Position specifier: nX
+ *
+ *    Advances one or more characters on the input stream.
+ *
+ *    - n - The number of characters to read and discard; if n is omitted, a single
+ *          character is read in and discarded.
+ *
+ *  \subsection eol End-of-line specifier: /
+ *
+ *    Advances to the end of the current line on the input stream. Input continues from
+ *    the start of the next line.
+ *
+ *  \subsection suppress Suppress line feed specifier: $
+ *
+ *    If given as the last significant character in the format string, suppresses
+ *    reading and discarding of the remainder of the current line on the input stream.
+ *
+ *  \subsection readeol Read to end of line specifier: #
+ *
+ *    Continues reading to end of line (intended for use with character string (A)
+ *    specifier).
+ *
+ *  \subsection sep Separator character specifier:
+ *
+ *    Any character other than a space, tab or comma, that cannot be interpreted as part
+ *    of one of the specifiers above, is interpreted as a separator character, and
+ *    causes input up to and including the first instance of the specified separator
+ *    character on the current line. If given immediately following a variable-width F,
+ *    I or A specification, input continues, for each item, until an instance of the
+ *    specified separator character is encountered, or the end of the current line is
+ *    reached (otherwise input continues until a space, tab or the end of the line is
+ *    reached). If the separator character follows a fixed-width F, I or A specification,
+ *    or forms a separate specification field, the characters read are discarded.
+ *
+ *    Examples:
+ *
+ *    \verbatim
+      Input stream: 123; Hello World!; 3.142
+      Format spec    Strings read                     Values assigned
+      I;A;F          "123", " Hello World!", "3.142"  123, " Hello World!", 3.142
+      F2.1;;I2,A     "12", " 3", ".142"               1.2, 3, ".142"
+		\endverbatim
+ *
+ */
+bool readfor(FILE* in, const char* fmt, ...);
+
+
+/// Format string for readfor, compiled for repeated use
+/** Translates a format string (see readfor) into a list of read operations once,
+ *  so that reading each line only carries out these operations instead of
+ *  interpreting the format string again.
+ *
+ *  Instead of passing addresses in an ellipsis argument list, the destination of
+ *  each F, I or A specifier is bound before reading by calling bind with the
+ *  number of the specifier (counting from 0 in the order the specifiers appear in
+ *  the format string). The type of the destination is checked when it is bound.
+ *  Destinations stay bound until bound again or the format is recompiled.
+ *
+ *  \code
+ *     ReadFormat format("f6.1,f5.1,i4,12f5.1");
+ *     format.bind(0,&lon);
+ *     format.bind(1,&lat);
+ *     format.bind(2,&elev);
+ *     format.bind(3,mdata);
+ *     while (readfor(in,format)) {
+ *       ...
+ *     }
+ *  \endcode
+ */
+class ReadFormat {
+
+	 // MEMBER TYPES
+
+public:
+	 enum optype {
+		  OP_FLOAT,    ///< F specifier
+		  OP_INT,      ///< I specifier
+		  OP_CHAR,     ///< A specifier
+		  OP_SKIP,     ///< X specifier
+		  OP_TOCHAR,   ///< separator character forming a field of its own
+		  OP_EOL,      ///< / following a specifier (does not skip a line already ended)
+		  OP_NEXTLINE, ///< / forming a field of its own
+		  OP_SKIPFIELD ///< free-format F fields passed over unconverted (see project)
+	 };
+
+	 struct Op {
+		  optype type;
+		  int nitem;
+		  int width;
+		  int dec;          ///< decimal places for F specifier, -1 if not specified
+		  int exp;          ///< exponent width for F specifier, -1 if not specified
+		  char termch;      ///< separator terminating each item, 0 if none
+		  bool read_to_eol; ///< # specifier given
+		  void* dest;       ///< bound destination for F, I and A specifiers
+		  int argno;        ///< number of the specifier read by this operation, -1 if none
+		  int offset;       ///< index in the destination of the first item read
+	 };
+
+	 // MEMBER VARIABLES
+
+private:
+	 Op* ops;
+	 int nop;
+	 int maxop;
+	 int narg;
+	 bool croff;
+
+	 friend class GuessReader;
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 ReadFormat();
+	 ReadFormat(const char* fmt);
+	 ~ReadFormat();
+
+	 /// Compiles format string fmt (any previous format and bindings are discarded)
+	 void compile(const char* fmt);
+
+	 /// Number of F, I and A specifiers (destinations to be bound)
+	 int nargs() const {
+		  return narg;
+	 }
+
+	 /// Binds a destination (variable or start of array) to specifier number argno
+	 void bind(int argno,double* dest);
+	 void bind(int argno,int* dest);
+	 void bind(int argno,xtring* dest);
+
+	 /// Limits conversion to the fields that are actually needed
+	 /** Fields are numbered from 0 across the F specifiers of the format that
+	  *  have no width, for as long as nothing else intervenes. Each such field i
+	  *  (i<nfield) for which need[i] is false is passed over by a scan for its
+	  *  delimiter instead of being converted, and the element of the destination
+	  *  for it is left unchanged. Fields after the last one needed are not
+	  *  scanned at all, unless the format ends with $. Bindings are kept.
+	  *
+	  *  \code
+	  *     ReadFormat format;
+	  *     format.compile("20f");
+	  *     format.project(20,need); // e.g. only lon, lat, year and Total
+	  *     format.bind(0,dval);
+	  *  \endcode
+	  */
+	 void project(int nfield,const bool* need);
+
+	 /// Number of read operations
+	 int size() const {
+		  return nop;
+	 }
+
+	 /// Read operation number n
+	 const Op& operator[](int n) const {
+		  return ops[n];
+	 }
+
+	 /// Whether the remainder of the line is left unread ($ specifier)
+	 bool keepline() const {
+		  return croff;
+	 }
+
+private:
+	 void add(optype type,int nitem,int width,int dec,int exp,char termch,bool read_to_eol);
+	 void append(const Op& op,int nitem,int offset);
+	 void bindarg(int argno,optype type,void* dest,int size);
+	 ReadFormat(const ReadFormat&);
+	 ReadFormat& operator=(const ReadFormat&);
+};
+
+
+/// Reentrant reader for FORTRAN-style formatted input
+/** Holds all the state needed to read a stream with readfor-style format strings
+ *  (the line buffer, the current field and the end-of-line flag), so that several
+ *  streams can be read at the same time, each from its own thread. A GuessReader
+ *  object must not itself be used from more than one thread at a time.
+ *
+ *  Format strings are interpreted exactly as by readfor (see above). Function
+ *  readfor is equivalent to calling read on a single GuessReader shared by the
+ *  whole process, and should not be used by programs reading on several threads.
+ *
+ *  \code
+ *     GuessReader reader(in);
+ *     double lon,lat;
+ *     while (reader.read("f,f",&lon,&lat)) {
+ *       ...
+ *     }
+ *  \endcode
+ */
+class GuessReader {
+
+	 // MEMBER VARIABLES
+
+private:
+	 FILE* in;
+	 LineReader linein;
+	 xtring inxtr;
+	 bool iseol;
+	 const char* field;  ///< start of the last field read (not null-terminated)
+	 int fieldlen;       ///< length of the last field read
+	 ReadFormat vformat; ///< format compiled by the last call to vread
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 GuessReader();
+	 GuessReader(FILE* strm);
+
+	 /// Switches input to stream strm
+	 void attach(FILE* strm);
+
+	 /// Switches input to the text in the memory block begin .. end-1
+	 void attach(const char* begin,const char* end);
+
+	 /// Discards any partly read line (e.g. after repositioning the stream)
+	 void reset();
+
+	 /// Whether an attempt to read past the end of the input was made
+	 bool eof() const {
+		  return linein.ateof;
+	 }
+
+	 /// Returns the position in the memory block of the next unread character
+	 const char* tell() const {
+		  return linein.tell();
+	 }
+
+	 /// Returns the number of characters of the stream consumed since the last reset
+	 unsigned long streampos() const {
+		  return linein.streampos();
+	 }
+
+	 /// Reads from the attached stream according to format string fmt
+	 /** Arguments and return value as for readfor.
+	  */
+	 bool read(const char* fmt, ...);
+
+	 /// As read, but taking the argument list as a va_list
+	 bool vread(const char* fmt,va_list& v);
+
+	 /// Reads the rest of the current line, or the next line, into text
+	 /** \returns false (and sets text to "") at end of file
+	  */
+	 bool readline(xtring& text);
+
+	 /// Reads from the attached stream according to a compiled format
+	 /** Values are assigned to the destinations bound to format.
+	  *  \returns false if an end-of-file condition prevented some values from
+	  *           being read in and assigned
+	  */
+	 bool read(const ReadFormat& format);
+
+private:
+	 int readfixedwidth(int& width);
+	 int readtoeol(bool breakcomma);
+	 void readtocomma();
+	 int readtowhitespace(bool& breakcomma);
+	 int readtochar(char sep);
+	 void skipwhitespace();
+	 void assignfield(xtring& dest);
+	 bool readfloat(int nitem,int& width,int dec,int exp,char termch,double* parg);
+	 bool readint(int& nitem,int& width,char termch,int* parg);
+	 bool readchar(int nitem,int& width,char termch,xtring* parg,bool read_to_eol);
+	 bool skipfields(int nitem,char termch);
+	 GuessReader(const GuessReader&);
+	 GuessReader& operator=(const GuessReader&);
+};
+
+
+/// Reads text according to a compiled format specification
+/** As readfor, but values are assigned to the destinations bound to format
+ *  (see class ReadFormat). Reads through the same shared reader as readfor.
+ */
+bool readfor(FILE* in,const ReadFormat& format);
+
+
+struct Decompressor;
+
+/// Input file for reading with readfor
+/** Regular files are mapped into memory (where the operating system allows),
+ *  so that lines are read directly from the page cache without being copied,
+ *  and a second pass over the file (after rewind or seek) costs no more than
+ *  moving a pointer. Other inputs (pipes, terminals, or if mapping fails) are
+ *  read through a buffered stream.
+ *
+ *  Files compressed with gzip or zstd (recognised by their contents, whatever
+ *  the file name, but not if read from a pipe) are decompressed on the fly by a
+ *  background thread, while the text is being read. This requires the library to be compiled with HAVE_ZLIB
+ *  (linking with -lz) and/or HAVE_ZSTD (linking with -lzstd) defined. Seeking
+ *  back in a compressed file restarts decompression from the beginning.
+ *
+ *  Each InputFile has its own GuessReader, so several files can be read in
+ *  turn without disturbing each other.
+ *
+ *  \code
+ *     InputFile in;
+ *     if (!in.open("cpool.out")) ...
+ *     readfor(in,"a#",&header);
+ *     unsigned long data=in.tell();
+ *     while (!in.eof()) {
+ *       readfor(in,"12f",mdata);
+ *       ...
+ *     }
+ *     in.seek(data); // back to the first line after the header
+ *  \endcode
+ */
+class InputFile {
+
+	 // MEMBER VARIABLES
+
+private:
+	 FILE* in;           ///< stream, if the file is not mapped
+	 const char* data;   ///< contents of mapped file
+	 unsigned long size; ///< size of mapped file
+	 Decompressor* decomp; ///< decompression of a compressed file into in
+	 unsigned long passstart; ///< offset at which reading of mapped or plain file last started
+	 unsigned long long disksize; ///< size of the file on disk (0 if not a regular file)
+	 GuessReader reader;
+
+	 friend class ChunkedReader;
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 InputFile();
+	 ~InputFile();
+
+	 /// Opens a file for input
+	 /** \returns false if the file could not be opened (or is compressed in a
+	  *           format the library was compiled without support for)
+	  */
+	 bool open(const char* filename);
+
+	 /// Closes the file
+	 void close();
+
+	 /// Whether the file has been mapped into memory
+	 bool mapped() const {
+		  return data!=NULL;
+	 }
+
+	 /// Whether an attempt to read past the end of the file was made (cf. feof)
+	 /** Terminates the program with a message if the end of a compressed file
+	  *  was reached because its data are corrupt or truncated.
+	  */
+	 bool eof() const {
+		  if (!reader.eof()) return false;
+		  if (decomp) checkdecomp();
+		  return true;
+	 }
+
+	 /// Returns the position (offset from the start of the file) of the next line
+	 /** Only valid if the last read finished at the end of a line.
+	  */
+	 unsigned long tell();
+
+	 /// Continues reading at a position previously returned by tell
+	 void seek(unsigned long pos);
+
+	 /// Continues reading from the start of the file
+	 void rewind() {
+		  seek(0);
+	 }
+
+	 /// Reads according to format string fmt (see readfor)
+	 bool read(const char* fmt, ...);
+
+	 /// As read, but taking the argument list as a va_list
+	 bool vread(const char* fmt,va_list& v);
+
+	 /// Reads according to a compiled format
+	 bool read(const ReadFormat& format);
+
+	 /// Reads the rest of the current line, or the next line, into text
+	 /** \returns false (and sets text to "") at end of file
+	  */
+	 bool readline(xtring& text) {
+		  return reader.readline(text);
+	 }
+
+	 /// Returns how far reading has got through the file, in bytes on disk
+	 /** For a compressed file this is the amount of compressed data taken in by
+	  *  the decompressor, which runs a little ahead of the text read.
+	  */
+	 unsigned long long consumed() const;
+
+	 /// Size of the file on disk in bytes (0 if unknown, e.g. for a pipe)
+	 unsigned long long filesize() const {
+		  return disksize;
+	 }
+
+private:
+	 void account();
+	 void stopdecomp();
+	 void checkdecomp() const;
+	 InputFile(const InputFile&);
+	 InputFile& operator=(const InputFile&);
+};
+
+
+/// Reads text from an InputFile according to FORTRAN-style format specification
+/** As readfor above.
+ */
+bool readfor(InputFile& in,const char* fmt, ...);
+
+/// Reads text from an InputFile according to a compiled format specification
+bool readfor(InputFile& in,const ReadFormat& format);
+
+
+
+/// Format for writing numbers in a field of fixed width
+/** Equivalent to the printf conversions "%w.pf" (fixed-point notation with p
+ *  decimal places) or "%wg" (general notation, 6 significant digits), or to
+ *  "%w.<p>g" with the fewest significant digits p needed for the value to be
+ *  read back exactly (shortest round-trip representation). The layout of the
+ *  field is worked out once, so that numbers can be converted without a format
+ *  string being interpreted for each value. The text produced is identical to
+ *  that printf would produce.
+ */
+class NumberFormat {
+
+	 // MEMBER VARIABLES
+
+private:
+	 enum {FIXED,GENERAL,SHORTEST};
+	 int style;
+	 int width;
+	 int places;
+	 int maxlength;
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 NumberFormat() {
+		  setfixed(1,0);
+	 }
+
+	 /// Sets the format to "%w.pf"
+	 void setfixed(int w,int p);
+
+	 /// Sets the format to "%wg"
+	 void setgeneral(int w);
+
+	 /// Sets the format to the shortest representation that reads back exactly
+	 /** As "%w.<p>g", with p (at most 17) chosen for each value, e.g.
+	  *  0.1+0.2 is written as 0.30000000000000004, but 0.3 as 0.3.
+	  */
+	 void setshortest(int w=0);
+
+	 /// Converts value to text
+	 /** Writes no more than maxlen() characters to dest, plus a terminating
+	  *  null character.
+	  *  \returns number of characters written (excluding the null character)
+	  */
+	 int format(char* dest,double value) const;
+
+	 /// Maximum number of characters written by format
+	 int maxlen() const {
+		  return maxlength;
+	 }
+};
+
+
+struct Compressor;
+
+/// Output file, optionally compressed
+/** Text is collected in a large buffer and written to the file in big blocks.
+ *  If the file name ends in .gz or .zst, the text is compressed in gzip or
+ *  zstd format by a background thread while it is being written, so that
+ *  formatting and compression overlap. This requires the library to be
+ *  compiled with HAVE_ZLIB (linking with -lz) or HAVE_ZSTD (linking with
+ *  -lzstd) defined respectively.
+ *
+ *  \code
+ *     OutputFile out;
+ *     NumberFormat fmt;
+ *     if (!out.open("total.out.gz")) ...
+ *     fmt.setfixed(8,2);
+ *     out.printf("%8s","Total");
+ *     out.put('\n');
+ *     out.put(total,fmt); // as out.printf("%8.2f",total)
+ *     out.close();
+ *  \endcode
+ */
+class OutputFile {
+
+	 // MEMBER VARIABLES
+
+private:
+	 FILE* out;          ///< stream text is written to
+	 Compressor* comp;   ///< compression of text written to out into the file
+	 char* buf;          ///< text not yet written to out
+	 char* pos;          ///< end of text in buf
+	 char* bufend;
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 OutputFile();
+	 ~OutputFile();
+
+	 /// Opens a file for output
+	 /** \param append whether to append to an existing file rather than
+	  *         replacing it (compressed text is appended as a new gzip member
+	  *         or zstd frame, so that the file decompresses as a whole)
+	  *  \returns false if the file could not be opened (or is to be compressed
+	  *           in a format the library was compiled without support for)
+	  */
+	 bool open(const char* filename,bool append=false);
+
+	 /// Closes the file, waiting for any compression to finish
+	 /** Terminates the program with a message if the compressed file could not
+	  *  be written.
+	  */
+	 void close();
+
+	 /// Whether the file is open
+	 bool isopen() const {
+		  return out!=NULL;
+	 }
+
+	 /// Writes text formatted as by printf
+	 void printf(const char* fmt, ...);
+
+	 /// Writes a null-terminated string
+	 void put(const char* text);
+
+	 /// Writes a single character
+	 void put(char ch) {
+		  if (pos==bufend) flush();
+		  *pos++=ch;
+	 }
+
+	 /// Writes a number according to format
+	 void put(double value,const NumberFormat& format) {
+		  if (bufend-pos<=format.maxlen()) flush();
+		  pos+=format.format(pos,value);
+	 }
+
+	 /// Writes any buffered text to the file
+	 void flush();
+
+private:
+	 OutputFile(const OutputFile&);
+	 OutputFile& operator=(const OutputFile&);
+};
+
+
+struct ChunkedReaderState;
+
+/// Reads the rows of a large file in parallel, delivering them in order
+/** The remainder of a file (from the current position of the stream) is split
+ *  into blocks of whole lines. The blocks are read in and converted to numbers on
+ *  a number of worker threads, and the resulting batches of rows handed to the
+ *  caller strictly in the order of the file, one row at a time, so that the
+ *  caller processes the data exactly as if reading the file sequentially.
+ *
+ *  Each row is read from the text by a format string as used by readfor, which
+ *  must contain only F specifiers. The values of each row are available as an
+ *  array of doubles (the values assigned by each F specifier following those of
+ *  the preceding specifiers). The text of the row can be read again on the
+ *  calling thread with any other format (e.g. to inspect individual items as
+ *  strings).
+ *
+ *  Rows are read with the same results as calling readfor on the stream line by
+ *  line, provided that the format reads each row from a single line (no /
+ *  specifier, and no fixed-width items extending beyond the end of the line).
+ *
+ *  \code
+ *     ChunkedReader rows;
+ *     rows.open(in,"12f");
+ *     while (rows.nextrow()) {
+ *       if (rows.rowok()) {
+ *         const double* mdata=rows.values();
+ *         ...
+ *       }
+ *     }
+ *  \endcode
+ */
+class ChunkedReader {
+
+	 // MEMBER VARIABLES
+
+private:
+	 ChunkedReaderState* state;
+	 GuessReader rowreader;
+	 const double* rowvalues;
+	 const char* rowstart;
+	 const char* rowend;
+	 bool rowread;
+	 bool ateof;
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 ChunkedReader();
+	 ~ChunkedReader();
+
+	 /// Starts reading the rows of stream in, from its current position
+	 /** \param fmt format by which each row is read (see readfor)
+	  *  \param nthread number of worker threads; 0 for one per processor
+	  *  \returns false (with a message) if fmt contains other than F specifiers
+	  */
+	 bool open(FILE* in,const char* fmt,int nthread=0);
+
+	 /// Starts reading the rows of in, from its current position
+	 /** As above. If in is mapped into memory, the rows are read where they
+	  *  lie in the mapping. The rest of in is taken over by the ChunkedReader
+	  *  (in is left positioned at its end).
+	  */
+	 bool open(InputFile& in,const char* fmt,int nthread=0);
+
+	 /// Stops reading (any rows not yet fetched are discarded)
+	 void close();
+
+	 /// Fetches the next row
+	 /** \returns false at end of file
+	  */
+	 bool nextrow();
+
+	 /// Whether the end of the file has been reached (nextrow returned false)
+	 bool eof() const {
+		  return ateof;
+	 }
+
+	 /// Whether all values of the current row could be read (readfor's result)
+	 bool rowok() const {
+		  return rowread;
+	 }
+
+	 /// Values of the current row
+	 const double* values() const {
+		  return rowvalues;
+	 }
+
+	 /// Number of values in each row
+	 int nvalue() const;
+
+	 /// Reads the text of the current row again according to another format
+	 /** Arguments and return value as for readfor. */
+	 bool read(const ReadFormat& format);
+
+	 /// Text of the current row, including its newline (if it has one)
+	 /** The text is not null-terminated; its length is returned in len. */
+	 const char* rowtext(int& len) const {
+		  len=rowend-rowstart;
+		  return rowstart;
+	 }
+
+	 /// Returns how far reading has got through the file, in bytes on disk
+	 /** Advances a block at a time (see InputFile::consumed).
+	  */
+	 unsigned long long consumed() const;
+
+private:
+	 bool start(FILE* in,const char* begin,const char* end,const char* fmt,int nthread);
+	 ChunkedReader(const ChunkedReader&);
+	 ChunkedReader& operator=(const ChunkedReader&);
+};
+
+
+/// Binary cache of the data rows of an LPJ-GUESS output file
+/** The first time a file is read with caching requested, its data rows are
+ *  parsed once and written in binary form, column by column, to a sidecar file
+ *  next to it (the name of the input file with ".gbin" appended). Later runs
+ *  load the columns straight into memory with no text parsing. The cache holds
+ *  the labels of the header row, the values of each column (as the double
+ *  precision numbers the text converts to) and, for each column, the largest
+ *  number of digits before and after the decimal point and whether any value
+ *  is signed or not in plain decimal notation, for formatting output as if the
+ *  text had been scanned.
+ *
+ *  The cache is valid while the size, modification time (to the nanosecond
+ *  where the system records it) and a hash of the first and last 64 kB of the
+ *  input file are those recorded in it; otherwise it is rebuilt. The hash
+ *  catches a file rewritten at the same size within the resolution of its
+ *  time stamp, as when a short simulation is rerun. Only files in which
+ *  every row after the header consists of the same number of numeric items
+ *  are cached, so that the rows a program gets from the cache are exactly
+ *  those it would have read from the text. For other files (e.g. with blank or
+ *  non-numeric lines to be reported) open returns false and the text should be
+ *  read as usual.
+ *
+ *  The header row itself is not among the cached rows, and should still be
+ *  read from the text file. Rows are then fetched as from a ChunkedReader:
+ *
+ *  \code
+ *     ColumnCache cache;
+ *     if (cache.open(filename) && cache.ncolumn()==ncol) {
+ *       while (cache.nextrow()) {
+ *         const double* mdata=cache.values();
+ *         ...
+ *       }
+ *     }
+ *  \endcode
+ */
+class ColumnCache {
+
+	 // MEMBER VARIABLES
+
+private:
+	 RecordTable table;    ///< one column per column of the file
+	 xtring* labels;       ///< items of the header row
+	 int* maxplaces;       ///< most digits after the decimal point in each column
+	 int* maxdigits;       ///< most digits before the decimal point in each column
+	 bool* anysign;        ///< whether any value in each column has a sign
+	 bool* allplain;       ///< whether all values in each column are plain decimals
+	 double* rowvalues;    ///< values of the current row
+	 unsigned long currow; ///< index of the next row to fetch
+	 bool ateof;
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 ColumnCache();
+	 ~ColumnCache();
+
+	 /// Loads the cache for a text file, building it first if necessary
+	 /** \returns false (with a message if the file could have been read but
+	  *           is unsuitable for caching) if the rows are not available from
+	  *           the cache
+	  */
+	 bool open(const xtring& filename);
+
+	 /// Discards the cached rows
+	 void close();
+
+	 /// Number of columns
+	 int ncolumn() const {
+		  return table.ncolumn();
+	 }
+
+	 /// Number of cached rows (not including the header row)
+	 unsigned long nrow() const {
+		  return table.size();
+	 }
+
+	 /// Label of a column in the header row
+	 const xtring& label(int col) const {
+		  return labels[col];
+	 }
+
+	 /// Largest number of digits after the decimal point in a column
+	 int places(int col) const {
+		  return maxplaces[col];
+	 }
+
+	 /// Largest number of digits before the decimal point in a column
+	 int digits(int col) const {
+		  return maxdigits[col];
+	 }
+
+	 /// Whether any value in a column has a sign
+	 bool ifsign(int col) const {
+		  return anysign[col];
+	 }
+
+	 /// Whether all values in a column are plain decimal numbers (no exponent)
+	 bool ifnum(int col) const {
+		  return allplain[col];
+	 }
+
+	 /// Values of a column (nrow() of them)
+	 const double* column(int col) const {
+		  return table.column(col);
+	 }
+
+	 /// Fetches the next row
+	 /** \returns false after the last row
+	  */
+	 bool nextrow() {
+		  if (currow==table.size()) {
+			   ateof=true;
+			   return false;
+		  }
+		  for (int c=0;c<table.ncolumn();c++) rowvalues[c]=table(currow,c);
+		  currow++;
+		  return true;
+	 }
+
+	 /// Whether all rows have been fetched (nextrow returned false)
+	 bool eof() const {
+		  return ateof;
+	 }
+
+	 /// Values of the current row
+	 const double* values() const {
+		  return rowvalues;
+	 }
+
+	 /// Starts fetching again from the first row
+	 void rewind() {
+		  currow=0;
+		  ateof=false;
+	 }
+
+private:
+	 void allocate(int ncol);
+	 bool load(const xtring& cachefile,unsigned long long srcsize,long long srctime,
+		  unsigned long long srchash);
+	 bool build(const xtring& filename);
+	 bool save(const xtring& cachefile,unsigned long long srcsize,long long srctime,
+		  unsigned long long srchash);
+	 ColumnCache(const ColumnCache&);
+	 ColumnCache& operator=(const ColumnCache&);
+};
+
+
+struct ProgressReporterState;
+
+/// Reports progress through an input file on the terminal
+/** While active, a background thread rewrites a status line on stderr once a
+ *  second, showing the percentage of the file read, the number of rows and
+ *  rows per second so far, and the time remaining (estimated by
+ *  Timer::setprogress). The reading loop calls tick() once per row, which
+ *  costs a test and an increment; the position in the file is passed to the
+ *  reporting thread every few hundred rows.
+ *
+ *  \code
+ *    progress.start(in);
+ *    while (!in.eof()) {
+ *        ... read a row ...
+ *        progress.tick(in);
+ *    }
+ *    progress.stop();
+ *  \endcode
+ *
+ *  The status line goes to stderr so that it is kept apart from anything the
+ *  program prints on stdout meanwhile (e.g. warnings about individual rows).
+ *  Nothing is reported if stderr is not a terminal, or if the size of the
+ *  file is unknown.
+ */
+class ProgressReporter {
+
+	 // MEMBER VARIABLES
+
+private:
+	 ProgressReporterState* state;
+	 unsigned long long nrow;
+	 int countdown;
+
+	 // MEMBER FUNCTIONS
+
+public:
+	 ProgressReporter();
+	 ~ProgressReporter();
+
+	 /// Starts reporting progress through in, from its current position
+	 void start(InputFile& in);
+
+	 /// Stops reporting and clears the status line
+	 void stop();
+
+	 /// Whether progress is being reported
+	 bool active() const {
+		  return state!=NULL;
+	 }
+
+	 /// Counts a row read from in
+	 void tick(const InputFile& in) {
+		  if (state) {
+				nrow++;
+				if (!--countdown) sample(in.consumed());
+		  }
+	 }
+
+	 /// Counts a row fetched from rows
+	 void tick(const ChunkedReader& rows) {
+		  if (state) {
+				nrow++;
+				if (!--countdown) sample(rows.consumed());
+		  }
+	 }
+
+private:
+	 void sample(unsigned long long pos);
+	 ProgressReporter(const ProgressReporter&);
+	 ProgressReporter& operator=(const ProgressReporter&);
+};
+
+/// Progress reporter for the current program
+extern ProgressReporter progress;
+
+
+/// Converts a numeric field to a double precision value
+/** Converts the len characters starting at text, which need not be
+ *  null-terminated, without copying or allocating. Leading spaces and tabs and
+ *  trailing spaces, tabs and carriage returns are ignored. The remaining
+ *  characters must form a decimal number with optional sign, fractional part
+ *  and exponent, e.g. "0.123", "-5", "1.5E-03".
+ *
+ *  The result is correctly rounded (the same value strtod would give).
+ *
+ *  \returns false (value unchanged) if the field is blank or not a well-formed
+ *           number
+ */
+bool parsefloat(const char* text,int len,double& value);
+
+
+/// Value and notation of an item of text, as found by scannumber
+struct ScannedItem {
+	 double value; ///< value of the item (0 if it is not a number)
+	 int places;   ///< digits after the decimal point
+	 int digits;   ///< digits before the decimal point
+	 bool ifsign;  ///< whether the item has a sign
+	 bool isnum;   ///< whether the whole item is a number (as xtring::isnum)
+	 bool ifplain; ///< whether the item is written in plain decimal notation
+
+	 /// An empty item (a number, 0)
+	 ScannedItem() {
+		  value=0.0;
+		  places=digits=0;
+		  ifsign=false;
+		  isnum=ifplain=true;
+	 }
+};
+
+/// Tests, converts and finds the notation of an item of text in one go
+/** The len characters at text (which need not be null-terminated) are examined
+ *  as xtring::isnum and xtring::num would examine them, and as the programs
+ *  examine an item to find the format for writing its column: places and
+ *  digits count the digits after and before the decimal point, until a
+ *  character other than a digit, a single sign or a single decimal point is
+ *  met, in which case ifplain is false (e.g. "1.5E-03"). Plain numbers are
+ *  converted without copying, as by parsefloat.
+ */
+void scannumber(const char* text,int len,ScannedItem& item);
 
 
 /// Used by functions with variable number of arguments to print to a string
@@ -14,34 +14,18 @@
 #include <time.h>
 #include <string.h>
 #include <gutil.h>
+#include <vector>
+
+using std::vector;
 
 const int MAXINDEX=8;
 	// Maximum number of index items (e.g. longitude, latitude, year)
-const int MAXITEM=60;
-	// Maximum number of items in a record (row) of an input file
-const int MAXGRID=65000;
-	// Maximum number of grid cells / records in input files
-
-class Record {
-
-public:
-	int nrec;
-	float val[MAXITEM];
-	
-	Record() {
-	
-		int i;
-		
-		nrec=0;
-		
-		for (i=0;i<MAXITEM;i++) val[i]=0.0;
-	}
-};
 
 class Item {
 
 public:
 	xtring label,fmt,lfmt;
+	NumberFormat nfmt;
 	bool ifnum;
 	bool ifsign;
 	int indexitemno;
@@ -71,16 +55,23 @@ public:
 		
 		if (label.len()>w) w=label.len();
 		
-		if (ifnum)
+		if (ifnum) {
 			fmt.printf("%%%d.%df",w,places);
-		else fmt.printf("%%%dg",w);
+			nfmt.setfixed(w,places);
+		}
+		else {
+			fmt.printf("%%%dg",w);
+			nfmt.setgeneral(w);
+		}
 		
 		lfmt.printf("%%%ds",w);
 	}
 };
 
-// Global matrix to store data from files
-Record data[MAXGRID];
+// Global table of records from the second input file, one column per output
+// item. Columns from the first input file are filled in as matching records are
+// found; the weight of a row counts the records merged into it
+RecordTable data;
 
 bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
 
@@ -114,14 +105,15 @@ bool scanitem(xtring text,int& places,int& digits,bool& ifsign) {
 }
 
 
-bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
+bool readheader(InputFile& in,vector<Item>& items,int& ncol,int& nindexitem,
 	xtring indexitem[MAXINDEX],int indexitemno[MAXINDEX],xtring filename,int fileno,
-	double values[MAXITEM],bool& ifvalues,bool relax,int& lineno) {
+	vector<double>& values,bool& ifvalues,bool relax,int& lineno) {
 
 	// Reads header row of an LPJ-GUESS output file
 	// label = array of header labels
 	// ncol  = number of columns (labels)
-	// Returns false if too many items in file
+	// items and values are extended to the number of columns
+	// Returns false if file contains no data or index items are missing
 	
 	xtring line,item;
 	int pos,i,j,idindex[MAXINDEX],lonpos,latpos;
@@ -132,7 +124,7 @@ bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
 	lonpos=-1;
 	latpos=-1;
 
-	while (!ncol && !feof(in)) {
+	while (!ncol && !in.eof()) {
 	
 		readfor(in,"a#",&line);
 		lineno++;
@@ -141,9 +133,9 @@ bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
 		while (pos!=-1) {
 			line=line.mid(pos);
 			pos=line.findoneof(" \t\r");
-			if (ncol>MAXITEM) {
-				printf("Too many columns (>%d) in %s\n",MAXITEM,(char*)filename);
-				return false;
+			if (ncol==(int)items.size()) {
+				items.resize(ncol+1);
+				values.resize(ncol+1);
 			}
 			if (pos>0) {
 				item=line.left(pos);
@@ -180,6 +172,15 @@ bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
 		}
 	}
 
+	if (!ncol) {
+		printf("%s contains no data\n",(char*)filename);
+		return false;
+	}
+	else if (ncol<2) {
+		printf("At least three columns expected in %s\n",(char*)filename);
+		return false;
+	}
+
 	for (i=0;i<nindexitem;i++) {
 		if (idindex[i]<0) {
 			if (indexitem[i]=="") {
@@ -224,86 +225,82 @@ bool readheader(FILE*& in,Item* items,int& ncol,int& nindexitem,
 			items[1].label="Lat";
 		}
 	}
-	
-	if (!ncol) {
-		printf("%s contains no data\n",(char*)filename);
-		return false;
-	}
-	else if (ncol<2) {
-		printf("At least three columns expected in %s\n",(char*)filename);
-		return false;
-	}
 
 	return true;
 }
 
-bool readrecord(FILE*& in,Record& rec,int ncol,int nitem,Item* items,xtring sfmt,xtring dfmt,
+bool readrecord(InputFile& in,double* val,int ncol,int nitem,Item* items,xtring sfmt,ReadFormat& dfmt,
 	int nrec,bool iffast,int fileno,int& lineno,xtring& filename) {
 
-	// Reads one record (row) in output file
+	// Reads one record (row) in output file into val (one value per item;
+	// items not present in this file are left unchanged)
 	// Returns false on end of file
 	// ncol = total number of items/columns in this file including index items
 	// nitem = number of items to assign data to
 	// fileno = file number
 	
-	xtring sval[MAXITEM],sval_curr,whole_line,line;
-	double dval[MAXITEM];
-	int i,places,digits,pos;
-	bool ifsign,searching=true,blank,isnum;
+	static vector<ScannedItem> sval; // static to avoid reallocating in each call
+	static vector<double> dval;
+	xtring whole_line;
+	const char* pchar;
+	const char* pstart;
+	int i;
+	bool searching=true,blank;
+
+	if ((int)sval.size()<ncol || (int)sval.size()<nitem) sval.resize(ncol>nitem?ncol:nitem);
+	if ((int)dval.size()<ncol) dval.resize(ncol);
 
 	while (searching) {
 	
 		if (nrec<100 || !(nrec%10) || !iffast) {
 
 			if (!readfor(in,"a#",&whole_line)) return false;
-			if (feof(in)) return false;
-			line=whole_line;
+			if (in.eof()) return false;
 			lineno++;
-			i=0;
 			
+			// Items are separated by blanks, tabs and carriage returns; each is
+			// tested, converted and scanned for its format in one go (items
+			// missing from a short line, or following a non-numeric item, are
+			// empty and so read as 0)
+			
+			pchar=whole_line;
+			i=0;
 			blank=true;
-			isnum=true;
-			pos=line.findnotoneof(" \t\r");
-			while (pos!=-1 && i<nitem) {
-				line=line.mid(pos);
+			while (i<nitem) {
+				while (*pchar==' ' || *pchar=='\t' || *pchar=='\r') pchar++;
+				if (!*pchar) break;
 				blank=false;
-				pos=line.findoneof(" \t\r");
-				if (pos>0) {
-					sval[i]=line.left(pos);
-					line=line.mid(pos);
-					pos=line.findnotoneof(" \t\r");
-				}
-				else {
-					sval[i]=line;
-				}
-				if (!sval[i].isnum()) {
-					isnum=false;
-					i=nitem;
-				}
-				i++;
+				pstart=pchar;
+				while (*pchar && *pchar!=' ' && *pchar!='\t' && *pchar!='\r') pchar++;
+				scannumber(pstart,pchar-pstart,sval[i]);
+				if (!sval[i++].isnum) break;
 			}
+			while (i<(int)sval.size()) scannumber(pchar,0,sval[i++]);
 
-			if (blank)
+			if (blank) {
 				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename);
+				runstats.rowsblank++;
+			}
 			else {
 				for (i=0;i<nitem;i++) {
 				
 					if (items[i].colno[fileno]!=-1) {
-						sval_curr=sval[items[i].colno[fileno]];
-						if (!sval_curr.isnum()) {
+						const ScannedItem& item=sval[items[i].colno[fileno]];
+						if (!item.isnum) {
 							printf("Line %d of %s contains non-numeric data - ignoring entire line\n",
 								lineno,(char*)filename);
+							runstats.rowsnonnumeric++;
 							searching=true;
 							i=nitem;
 						}
 						else {
-							if (scanitem(sval_curr,places,digits,ifsign)) {
-								if (places>items[i].places) items[i].places=places;
-								if (digits>items[i].digits) items[i].digits=digits;
-								if (ifsign) items[i].ifsign=true;
+							if (item.ifplain) {
+								if (item.places>items[i].places) items[i].places=item.places;
+								if (item.digits>items[i].digits) items[i].digits=item.digits;
+								if (item.ifsign) items[i].ifsign=true;
 							}
 							else items[i].ifnum=false;
-							rec.val[i]=sval_curr.num();
+							val[i]=item.value;
 							searching=false;
 						}
 					}
@@ -311,20 +308,52 @@ bool readrecord(FILE*& in,Record& rec,int ncol,int nitem,Item* items,xtring sfmt
 			}
 		}
 		else {
-			if (!readfor(in,dfmt,dval)) return false;
+			dfmt.bind(0,&dval[0]);
+			if (!readfor(in,dfmt)) return false;
 			lineno++;
 			for (i=0;i<nitem;i++)
 				if (items[i].colno[fileno]!=-1)
-					rec.val[i]=dval[items[i].colno[fileno]];
+					val[i]=dval[items[i].colno[fileno]];
 			searching=false;
 		}
 	}
+	
+	return true;
+}
 
-	rec.nrec=1;
+bool readrecord(ColumnCache& cache,double* val,int nitem,Item* items,int fileno) {
+
+	// Fetches the next record (row) from the binary cache of an input file
+	// Returns false after the last row
+	
+	int i;
+	
+	if (!cache.nextrow()) return false;
+	for (i=0;i<nitem;i++)
+		if (items[i].colno[fileno]!=-1)
+			val[i]=cache.values()[items[i].colno[fileno]];
 	
 	return true;
 }
 
+void cacheformat(ColumnCache& cache,Item* items,int nitem,int fileno) {
+
+	// Widens the format of each item to hold the values of its column in the
+	// cached rows of an input file
+	
+	int i,col;
+	
+	for (i=0;i<nitem;i++) {
+		col=items[i].colno[fileno];
+		if (col!=-1) {
+			if (cache.places(col)>items[i].places) items[i].places=cache.places(col);
+			if (cache.digits(col)>items[i].digits) items[i].digits=cache.digits(col);
+			if (cache.ifsign(col)) items[i].ifsign=true;
+			if (!cache.ifnum(col)) items[i].ifnum=false;
+		}
+	}
+}
+
 bool finditem(xtring item,int& itemno,Item* items,int nitem) {
 
 	int i;
@@ -352,10 +381,10 @@ bool finditem(xtring item,int& itemno,Item* items,int nitem) {
 	return false;
 }
 
-int findrec(Record& rec,int nrec,Item* items,int nitem,int fileno,int guess) {
+int findrec(const double* val,int nrec,Item* items,int nitem,int fileno,int guess) {
 
 	// Returns record number in global data corresponding to given values of index items
-	// in argument record
+	// in argument record val
 	// -1 if not found
 	// nrec = number of records in global data
 	// guess = guess at matching record number
@@ -367,7 +396,7 @@ int findrec(Record& rec,int nrec,Item* items,int nitem,int fileno,int guess) {
 		matches=true;
 		for (j=0;j<nitem && matches;j++) {
 			if (items[j].indexitemno!=-1) {
-				if (rec.val[items[j].colno[fileno]]!=data[guess].val[j]) matches=false;
+				if (val[items[j].colno[fileno]]!=data(guess,j)) matches=false;
 			}
 		}
 		
@@ -380,7 +409,7 @@ int findrec(Record& rec,int nrec,Item* items,int nitem,int fileno,int guess) {
 		matches=true;
 		for (j=0;j<nitem && matches;j++) {
 			if (items[j].indexitemno!=-1) {
-				if (rec.val[items[j].colno[fileno]]!=data[i].val[j]) matches=false;
+				if (val[items[j].colno[fileno]]!=data(i,j)) matches=false;
 			}
 		}
 		
@@ -390,38 +419,43 @@ int findrec(Record& rec,int nrec,Item* items,int nitem,int fileno,int guess) {
 	return -1;
 }
 
-bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int& nitem,
+bool readwritedata(xtring infile1,xtring infile2,xtring outfile,vector<Item>& items,int& nitem,
 	xtring indexitem[MAXINDEX],int indexitemno[MAXINDEX],int& nindexitem,
-	int& nrec,bool iffast,int& lonely_recs,char* sep) {
+	int& nrec,bool iffast,bool ifcache,int& lonely_recs,char* sep) {
 
 	int recno,i,j,nrec1;
-	double dval1[MAXITEM],dval2[MAXITEM];
-	bool ifvalues1,ifvalues2,warned;
-	xtring sfmt,dfmt;
-	Record rec;
-	Item items1[MAXITEM],items2[MAXITEM];
+	vector<double> dval1,dval2;
+	bool ifvalues1,ifvalues2;
+	xtring sfmt,fmt;
+	ReadFormat dfmt;
+	vector<double> rec;
+	vector<Item> items1,items2;
+	ColumnCache cache1,cache2;
+	bool ifcached1=false,ifcached2=false;
 	int nitem1,nitem2;
 	int colno;
 	int lineno1=0,lineno2=0;
 	int mismatch_recs=0,goodrecs;
 	int first_data_line;
+	unsigned long first_data_pos;
 	bool mismatch=false,ifdual=false;
 	
-	FILE* in2=fopen(infile2,"rt");
-	if (!in2) {
+	InputFile in2;
+	if (!in2.open(infile2)) {
 		printf("Could not open %s for input\n",(char*)infile2);
 		return false;
 	}
 	
 	// Read headers and find columns containing index items
 	
+	runstats.setphase(RunStats::PHASE_HEADER);
 	if (!readheader(in2,items2,nitem2,nindexitem,indexitem,indexitemno,
 		infile2,1,dval2,ifvalues2,true,lineno2)) {
 		return false;
 	}
 	
-	FILE* in1=fopen(infile1,"rt");
-	if (!in1) {
+	InputFile in1;
+	if (!in1.open(infile1)) {
 		printf("Could not open %s for input\n",(char*)infile1);
 		return false;
 	}
@@ -432,18 +466,19 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 	}
 	
 	first_data_line=lineno1;
+	first_data_pos=in1.tell();
 
 	// Produce list of items for inclusion in output file
 	
 	if (true) { 
+		items.clear();
 		nitem=0;
 		for (i=0;i<nitem1;i++) {
-			items[nitem]=items1[i];
+			items.push_back(items1[i]);
 			items[nitem].colno[0]=i;
 			items[nitem].colno[1]=-1;
 			nitem++;
 		}
-		warned=false;
 		for (i=0;i<nitem2;i++) {
 			if (items2[i].indexitemno!=-1) {
 				for (j=0;j<nitem1;j++) {
@@ -452,50 +487,59 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 				}
 			}
 			else {
-				items[nitem]=items2[i];
+				items.push_back(items2[i]);
 				items[nitem].colno[0]=-1;
 				items[nitem].colno[1]=i;
-				if (nitem==MAXITEM-1) {
-					if (!warned) {
-						printf("Warning: too many items - ignoring data past column %d in %s\n",
-							i,(char*)infile2);
-						warned=true;
-					}
-				}
-				else nitem++;
+				nitem++;
 			}
 		}
 	}
 	
+	// Record buffer is indexed by item, but also by column number in findrec
+	rec.assign(nitem>nitem2?nitem:nitem2,0.0);
+	data.init(nitem);
+	
+	// Remaining rows are fetched from binary caches of the input files if available
+	
+	if (ifcache) {
+		ifcached2=cache2.open(infile2) && cache2.ncolumn()==nitem2;
+		if (ifcached2) cacheformat(cache2,&items[0],nitem,1);
+		ifcached1=cache1.open(infile1) && cache1.ncolumn()==nitem1;
+		if (ifcached1) cacheformat(cache1,&items[0],nitem,0);
+	}
+	
 	printf("Reading data from %s ...\n",(char*)infile2);
 	
 	sfmt.printf("%da",nitem2);
-	dfmt.printf("%df",nitem2);
+	fmt.printf("%df",nitem2);
+	dfmt.compile(fmt);
 	
 	// Transfer data from first row (if all numbers)
 	
 	nrec=0;
 
+	runstats.setphase(RunStats::PHASE_READ);
 	if (ifvalues2) {
-		for (i=0;i<nitem;i++) {
-			data[nrec].val[i]=dval2[items[i].colno[1]];
-		}
-		data[nrec].nrec=1;
+		runstats.rowsparsed++;
+		for (i=0;i<nitem;i++)
+			if (items[i].colno[1]!=-1) rec[i]=dval2[items[i].colno[1]];
+		data.set(data.addrow(),&rec[0],1.0);
 		nrec++;
 	}
 		
-	while (!feof(in2)) {
+	if (!ifcached2) progress.start(in2);
+	while (ifcached2?!cache2.eof():!in2.eof()) {
 		
 		// Read next record in file
 		
-		if (readrecord(in2,rec,nitem2,nitem,items,sfmt,dfmt,nrec,iffast,1,lineno2,infile2)) {
-
-			if (nrec==MAXGRID) {
-				printf("Too many records (>%d) in %s\n",MAXGRID,(char*)infile2);
-				return false;
-			}
-
-			recno=findrec(rec,nrec,items,nitem,0,0);
+		runstats.setphase(RunStats::PHASE_READ);
+		if (!ifcached2) progress.tick(in2);
+		if (ifcached2?readrecord(cache2,&rec[0],nitem,&items[0],1):
+			readrecord(in2,&rec[0],nitem2,nitem,&items[0],sfmt,dfmt,nrec,iffast,1,lineno2,infile2)) {
+
+			runstats.rowsparsed++;
+			runstats.setphase(RunStats::PHASE_AGGREGATE);
+			recno=findrec(&rec[0],nrec,&items[0],nitem,0,0);
 			if (recno>=0) {
 				printf("Records %d and %d contain same index item values in %s\n",
 					nrec+1,recno+1,(char*)infile2);
@@ -503,27 +547,17 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 				return false;
 			}
 			
-			for (i=0;i<nitem;i++) {
-				
-				data[nrec].val[i]=rec.val[i];
-			
-//				if (items[i].indexitemno==-1) {
-//					data[nrec].val[i]=rec.val[i];
-//				}
-//				else {
-//				}
-			}
-			data[nrec].nrec=1;
+			data.set(data.addrow(),&rec[0],1.0);
 			nrec++;
-			if (!(nrec%100000)) printf("%d ...\n",nrec);
-			
 		}
 	}
+	progress.stop();
 
 	printf("Reading data from %s ...\n",(char*)infile1);
 	
 	sfmt.printf("%da",nitem1);
-	dfmt.printf("%df",nitem1);
+	fmt.printf("%df",nitem1);
+	dfmt.compile(fmt);
 
 	// Transfer data from first row (if all numbers)
 	
@@ -531,37 +565,45 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 	lonely_recs=0;
 	
 	if (ifvalues1) {
+		runstats.rowsparsed++;
+		runstats.setphase(RunStats::PHASE_AGGREGATE);
 		for (i=0;i<nitem1;i++)
-			rec.val[i]=dval1[i];
+			rec[i]=dval1[i];
 
-		recno=findrec(rec,nrec,items,nitem,0,0);
+		recno=findrec(&rec[0],nrec,&items[0],nitem,0,0);
 		if (recno<0) {
 			lonely_recs++;
 		}
 		else {
 			for (i=0;i<nitem1;i++) {
-				data[recno].val[i]=dval1[i];
+				data(recno,i)=dval1[i];
 			}
 				
-			data[recno].nrec++; // to flag that this record has been merged
+			data.weight(recno)++; // to flag that this record has been merged
 			nrec1++;
 		}
 	}
 
 	// Read in first input file
 	
-	while (!feof(in1)) {
+	if (!ifcached1) progress.start(in1);
+	while (ifcached1?!cache1.eof():!in1.eof()) {
 	
 		// Read next record in file
 		
-		if (readrecord(in1,rec,nitem1,nitem,items,sfmt,dfmt,nrec1,iffast,0,lineno1,infile1)) {
+		runstats.setphase(RunStats::PHASE_READ);
+		if (!ifcached1) progress.tick(in1);
+		if (ifcached1?readrecord(cache1,&rec[0],nitem,&items[0],0):
+			readrecord(in1,&rec[0],nitem1,nitem,&items[0],sfmt,dfmt,nrec1,iffast,0,lineno1,infile1)) {
 		
-			recno=findrec(rec,nrec,items,nitem,0,nrec1);
+			runstats.rowsparsed++;
+			runstats.setphase(RunStats::PHASE_AGGREGATE);
+			recno=findrec(&rec[0],nrec,&items[0],nitem,0,nrec1);
 			if (recno<0) {
 				lonely_recs++;
 			}
 			else {
-				if (data[recno].nrec>1 && !ifdual) {
+				if (data.weight(recno)>1 && !ifdual) {
 					
 					printf("More than one record in %s matches record #%d in %s\n",
 						(char*)infile1,recno+1,(char*)infile2);
@@ -570,21 +612,22 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 				}
 				
 				for (i=0;i<nitem1;i++) {
-					data[recno].val[i]=rec.val[i];
+					data(recno,i)=rec[i];
 				}
 				
-				data[recno].nrec++; // to flag that this record has been subtracted
+				data.weight(recno)++; // to flag that this record has been subtracted
 				
 				nrec1++;
-				if (!(nrec1%100000)) printf("%d ...\n",nrec1);
 			}
 		}
 	}
+	progress.stop();
 	
 	// Now produce output
 	
-	FILE* out=fopen(outfile,"wt");
-	if (!out) {
+	runstats.setphase(RunStats::PHASE_FORMAT);
+	OutputFile out;
+	if (!out.open(outfile)) {
 		printf("Could not open %s for output\n",(char*)outfile);
 		return false;
 	}
@@ -593,10 +636,10 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 	
 	for (i=0;i<nitem;i++) {
 		items[i].compute_fmt();
-		if (i) fprintf(out,sep);
-		fprintf(out,items[i].lfmt,(char*)items[i].label);
+		if (i) out.put(sep);
+		out.printf(items[i].lfmt,(char*)items[i].label);
 	}
-	fprintf(out,"\n");
+	out.put('\n');
 	
 	goodrecs=0;
 	
@@ -605,59 +648,64 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 		// Input file 1 contains duplicate records (e.g. same lon/lat, different years)
 		// Reread and write record by record
 		
-		rewind(in1);
-		lineno1=0;
-		for (i=0;i<first_data_line;i++) readfor(in1,"");
+		if (ifcached1) cache1.rewind();
+		else in1.seek(first_data_pos);
 		lineno1=first_data_line;
 		
 		// Transfer data from first row (if all numbers)
 		
 		if (ifvalues1) {
 			for (i=0;i<nitem1;i++)
-				rec.val[i]=dval1[i];
+				rec[i]=dval1[i];
 	
-			recno=findrec(rec,nrec,items,nitem,0,0);
+			recno=findrec(&rec[0],nrec,&items[0],nitem,0,0);
 			if (recno>=0) {
 				for (i=0;i<nitem1;i++) {
-					data[recno].val[i]=dval1[i];
+					data(recno,i)=dval1[i];
 				}
-			}
 			
-			for (j=0;j<nitem;j++) {
-				if (j) fprintf(out,sep);
-				fprintf(out,items[j].fmt,(double)data[recno].val[j]);
-			}
-			fprintf(out,"\n");
+				for (j=0;j<nitem;j++) {
+					if (j) out.put(sep);
+					out.put(data(recno,j),items[j].nfmt);
+				}
+				out.put('\n');
 			
-			goodrecs++;
+				goodrecs++;
+			}
 		}
 	
 		// Read in first input file
 		
-		while (!feof(in1)) {
+		if (!ifcached1) progress.start(in1);
+		while (ifcached1?!cache1.eof():!in1.eof()) {
 		
 			// Read next record in file
 			
-			if (readrecord(in1,rec,nitem1,nitem,items,sfmt,dfmt,nrec1,iffast,0,lineno1,infile1)) {
+			runstats.setphase(RunStats::PHASE_READ);
+			if (!ifcached1) progress.tick(in1);
+			if (ifcached1?readrecord(cache1,&rec[0],nitem,&items[0],0):
+				readrecord(in1,&rec[0],nitem1,nitem,&items[0],sfmt,dfmt,nrec1,iffast,0,lineno1,infile1)) {
 			
-				recno=findrec(rec,nrec,items,nitem,0,nrec1);
+				runstats.setphase(RunStats::PHASE_AGGREGATE);
+				recno=findrec(&rec[0],nrec,&items[0],nitem,0,nrec1);
 				if (recno>=0) {
 					
 					for (i=0;i<nitem1;i++) {
-						data[recno].val[i]=rec.val[i];
+						data(recno,i)=rec[i];
 					}
 					
+					runstats.setphase(RunStats::PHASE_FORMAT);
 					for (j=0;j<nitem;j++) {
-						if (j) fprintf(out,sep);
-						fprintf(out,items[j].fmt,(double)data[recno].val[j]);
+						if (j) out.put(sep);
+						out.put(data(recno,j),items[j].nfmt);
 					}
-					fprintf(out,"\n");
+					out.put('\n');
 
 					goodrecs++;
-					if (!(goodrecs%100000)) printf("%d ...\n",goodrecs);
 				}
 			}
 		}
+		progress.stop();
 	}
 	else {
 	
@@ -666,12 +714,12 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 		
 		for (i=0;i<nrec;i++) {
 
-			if (data[i].nrec==2) {
+			if (data.weight(i)==2) {
 				for (j=0;j<nitem;j++) {
-					if (j) fprintf(out,sep);
-					fprintf(out,items[j].fmt,(double)data[i].val[j]);
+					if (j) out.put(sep);
+					out.put(data(i,j),items[j].nfmt);
 				}
-				fprintf(out,"\n");
+				out.put('\n');
 				goodrecs++;
 			}
 			else {
@@ -681,9 +729,10 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 		}
 	}
 
-	fclose(in1);
-	fclose(in2);
-	fclose(out);
+	in1.close();
+	in2.close();
+	out.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	printf("\n");
 	if (mismatch || lonely_recs) {
@@ -700,14 +749,14 @@ bool readwritedata(xtring infile1,xtring infile2,xtring outfile,Item* items,int&
 	return true;
 }
 
-bool writedata(xtring filename,Item* items,int& nitem,int nrec,char* sep,
+bool writedata(xtring filename,vector<Item>& items,int& nitem,int nrec,char* sep,
 	xtring infile1,xtring infile2,int lonely_recs) {
 	
 	int i,j,mismatch_recs=0,good_recs=0;
 	bool mismatch=false;
 	
-	FILE* out=fopen(filename,"wt");
-	if (!out) {
+	OutputFile out;
+	if (!out.open(filename)) {
 		printf("Could not open %s for output\n",(char*)filename);
 		return false;
 	}
@@ -716,21 +765,21 @@ bool writedata(xtring filename,Item* items,int& nitem,int nrec,char* sep,
 	
 	for (i=0;i<nitem;i++) {
 		items[i].compute_fmt();
-		if (i) fprintf(out,sep);
-		fprintf(out,items[i].lfmt,(char*)items[i].label);
+		if (i) out.put(sep);
+		out.printf(items[i].lfmt,(char*)items[i].label);
 	}
-	fprintf(out,"\n");
+	out.put('\n');
 
 	// Print data
 	
 	for (i=0;i<nrec;i++) {
 
-		if (data[i].nrec==2) {
+		if (data.weight(i)==2) {
 			for (j=0;j<nitem;j++) {
-				if (j) fprintf(out,sep);
-				fprintf(out,items[j].fmt,(double)data[i].val[j]);
+				if (j) out.put(sep);
+				out.put(data(i,j),items[j].nfmt);
 			}
-			fprintf(out,"\n");
+			out.put('\n');
 			good_recs++;
 		}
 		else {
@@ -739,7 +788,7 @@ bool writedata(xtring filename,Item* items,int& nitem,int nrec,char* sep,
 		}
 	}
 	
-	fclose(out);
+	out.close();
 	
 	printf("\n");
 	if (mismatch || lonely_recs) {
@@ -802,6 +851,11 @@ void helptext(FILE* out,xtring exe) {
 	fprintf(out,"    Tab-delimited output\n");
 	fprintf(out,"-fast\n");
 	fprintf(out,"    Fast mode with tab-delimited output\n");
+	fprintf(out,"-cache\n");
+	fprintf(out,"    Read data rows from binary caches of the input files (<input-file>.gbin),\n");
+	fprintf(out,"    which are created or brought up to date by parsing the input files if necessary\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
 	fprintf(out,"-help\n");
 	fprintf(out,"    Displays this help message\n");
 }
@@ -828,6 +882,8 @@ void abort(xtring exe) {
 	printf("         -o <output-file>\n");
 	printf("         -tab\n");
 	printf("         -fast\n");
+	printf("         -cache\n");
+	printf("         -stats\n");
 	printf("         -help\n");
 
 	exit(99);
@@ -835,7 +891,7 @@ void abort(xtring exe) {
 
 bool processargs(int argc,char* argv[],xtring& infile1,xtring& infile2,xtring& outfile,
 	xtring& sep,xtring indexitem[MAXINDEX],int indexitemno[MAXINDEX],int& nindexitem,
-	bool& iffast) {
+	bool& iffast,bool& ifcache) {
 
 	int i,itemno,ninfile=0;
 	xtring arg,item;
@@ -846,6 +902,7 @@ bool processargs(int argc,char* argv[],xtring& infile1,xtring& infile2,xtring& o
 	// Defaults
 	outfile="";
 	iffast=false;
+	ifcache=false;
 	for (i=0;i<MAXINDEX;i++) {
 		indexitem[i]="";
 		indexitemno[i]=0;
@@ -876,10 +933,6 @@ bool processargs(int argc,char* argv[],xtring& infile1,xtring& infile2,xtring& o
 							dval=item.num();
 							if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 								itemno=dval;
-								if (itemno>MAXITEM) {
-									printf("Option -i: too many items (maximum allowed is %d)\n",MAXITEM);
-									return false;
-								}
 								indexitemno[nindexitem++]=itemno;
 							}
 						}
@@ -899,6 +952,8 @@ bool processargs(int argc,char* argv[],xtring& infile1,xtring& infile2,xtring& o
 				sep="\t";
 				iffast=true;
 			}
+			else if (arg=="-cache") ifcache=true;
+			else if (arg=="-stats") runstats.enable();
 			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
 			else {
 				printf("Invalid option %s\n",(char*)arg);
@@ -940,13 +995,13 @@ int main(int argc,char* argv[]) {
 	xtring infile1,infile2,outfile,header;
 	xtring indexitem[MAXINDEX];
 	int indexitemno[MAXINDEX],nindexitem;
-	bool iffast;
-	Item items[MAXITEM];
+	bool iffast,ifcache;
+	vector<Item> items;
 	int nitem,nrec,lonely_records;
 	xtring sep;
 	
 	if (!processargs(argc,argv,infile1,infile2,outfile,sep,indexitem,
-		indexitemno,nindexitem,iffast))
+		indexitemno,nindexitem,iffast,ifcache))
 			abort(argv[0]);
 
 	unixtime(header);
@@ -954,10 +1009,11 @@ int main(int argc,char* argv[]) {
 	printf("%s",(char*)header);
 	
 	if (readwritedata(infile1,infile2,outfile,items,nitem,indexitem,indexitemno,nindexitem,
-		nrec,iffast,lonely_records,sep)) {
+		nrec,iffast,ifcache,lonely_records,sep)) {
 
 		//writedata(outfile,items,nitem,nrec,sep,infile1,infile2,lonely_records);
 	} 
 	
+	runstats.print("joyn");
 	return 0;
 }
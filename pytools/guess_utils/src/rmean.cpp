@@ -0,0 +1,879 @@
+////////////////////////////////////////////////////////////////////////////////////////
+// RMEAN
+// Postprocessing utility for LPJ-GUESS
+// Takes raw ASCII output file with header row from LPJ-GUESS as input file
+// Generates output file with running means (or sums) of each item over a moving
+// window of time steps, separately for each grid cell
+//
+// rmean -help for documentation
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <math.h>
+#include <gutil.h>
+#include <vector>
+
+using namespace std;
+
+class Item {
+
+public:
+	xtring label,fmt,lfmt;
+	NumberFormat nfmt;
+	bool ifnum;
+	bool ifsign;
+	bool ifkey; // longitude, latitude or time, copied rather than averaged
+	int places;
+	int digits;
+	
+	Item() {
+		label="";
+		ifnum=true;
+		ifsign=false;
+		ifkey=false;
+		places=digits=0;
+	}
+	
+	void compute_fmt() {
+		
+		int w;
+		
+		if (digits) w=digits;
+		else w=1;
+		
+		if (places) w+=places+1;
+		if (ifsign) w++;
+		
+		if ((int)label.len()>w) w=label.len();
+		
+		if (ifnum) {
+			fmt.printf("%%%d.%df",w,places);
+			nfmt.setfixed(w,places);
+		}
+		else {
+			fmt.printf("%%%dg",w);
+			nfmt.setgeneral(w);
+		}
+		
+		lfmt.printf("%%%ds",w);
+	}
+};
+
+class Window {
+	
+	// The most recent time steps of one grid cell, in a ring buffer of
+	// window rows, and the sum of each item over them
+
+public:
+	double* rows;
+	double* sums;
+	int nrow;  // rows in the buffer, up to the window length
+	int next;  // position in the ring for the next row
+	
+	Window() {
+		rows=sums=NULL;
+		nrow=next=0;
+	}
+	
+	void init(int window,int nitem) {
+		rows=new double[(window+1)*nitem];
+		if (!rows) fail();
+		sums=rows+window*nitem;
+		for (int i=0;i<nitem;i++) sums[i]=0.0;
+	}
+	
+	~Window() {
+		if (rows) delete[] rows;
+	}
+};
+
+// Moving window of each grid cell, numbered as in cells
+vector<Window*> windows;
+
+// Longitude and latitude of each grid cell
+CellIndex cells;
+
+bool scanitem(const char* text,int& places,int& digits,bool& ifsign) {
+	
+	places=0;
+	digits=0;
+	int i;
+	bool ifnum=true;
+	ifsign=false;
+	bool ifdecimal=false;
+	char ch;
+	
+	i=0;
+	ch=text[i];
+	while (ch && ifnum) {
+		
+		if (ch>='0' && ch<='9') {
+			if (ifdecimal) places++;
+			else digits++;
+		}
+		else if ((ch=='-' || ch=='+') && !ifsign) ifsign=true;
+		else if (ch=='.' && !ifdecimal) ifdecimal=true;
+		else {
+			ifnum=false;
+		}
+		i++;
+		ch=text[i];
+	}
+	
+	return ifnum;
+}
+
+
+bool readheader(InputFile& in,vector<Item>& items,int& ncol,
+	int& lonitemno,int& latitemno,int& yearitemno,int& dayitemno,xtring filename,
+	vector<double>& values,bool& ifvalues,int& lineno) {
+	
+	// Reads header row of an LPJ-GUESS output file
+	// label = array of header labels
+	// ncol  = number of columns (labels)
+	// lonitemno = guess at column number (1-based) containing longitude
+	// latitemno = guess at column number (1-based) containing latitude
+	// yearitemno = guess at column number (1-based) containing year or time step
+	// dayitemno = column number (1-based) labelled Day, or 0 if none
+	// items and values are extended to the number of columns
+	// Returns false if file contains no data or too few columns
+	
+	xtring line,item;
+	int pos,i;
+	bool alphabetics=false;
+	ncol=0;
+	
+	while (!ncol && !in.eof()) {
+		
+		readfor(in,"a#",&line);
+		lineno++;
+		
+		lonitemno=-1;
+		latitemno=-1;
+		yearitemno=-1;
+		dayitemno=-1;
+		
+		pos=line.findnotoneof(" \t");
+		while (pos!=-1) {
+			line=line.mid(pos);
+			pos=line.findoneof(" \t");
+			if (ncol==(int)items.size()) {
+				items.resize(ncol+1);
+				values.resize(ncol+1);
+			}
+			if (pos>0) {
+				item=line.left(pos);
+				items[ncol].label=item;
+				line=line.mid(pos);
+				pos=line.findnotoneof(" \t");
+			}
+			else {
+				item=line;
+				items[ncol].label=item;
+			}
+			
+			if (item.isnum()) {
+				values[ncol]=item.num();
+				scanitem(item,items[ncol].places,items[ncol].digits,items[ncol].ifsign);
+			}
+			else
+				alphabetics=true;
+			
+			ncol++;
+			
+			if (item.lower()=="year" && yearitemno<0) yearitemno=ncol;
+			else if (item.lower()=="day" && dayitemno<0) dayitemno=ncol;
+			else if (item.len()>2) {
+				if (lonitemno<0)
+					if (item.left(3).lower()=="lon") lonitemno=ncol;
+				if (latitemno<0)
+					if (item.left(3).lower()=="lat") latitemno=ncol;
+			}
+		}
+	}
+	
+	if (!ncol) {
+		printf("%s contains no data\n",(char*)filename);
+		return false;
+	}
+	else if (ncol<3) {
+		printf("At least three columns expected in %s\n",(char*)filename);
+		return false;
+	}
+	
+	if (lonitemno<0 || latitemno<0) {
+		lonitemno=1;
+		latitemno=2;
+	}
+	
+	if (yearitemno<0) yearitemno=3;
+	if (dayitemno<0) dayitemno=0;
+	
+	if (!alphabetics) {
+		
+		for (i=0;i<ncol;i++) {
+			items[i].label.printf("Column%d",i+1);
+		}
+		
+		ifvalues=true;
+		dayitemno=0;
+	}
+	else ifvalues=false;
+	
+	return true;
+}
+
+bool readrecord(ChunkedReader& rows,double* dval,int nitem,Item* items,
+	bool iffast,int& lineno,xtring& filename) {
+	
+	// Reads one record (row) in output file into dval (nitem values)
+	// Returns false on end of file
+	// nitem = total number of items including lon, lat, year
+	
+	static vector<ScannedItem> sval; // static to avoid reallocating in each call
+	const char* pchar;
+	const char* pend;
+	const char* pstart;
+	int i,len,endat;
+	bool searching=true,blank,isnum;
+	
+	if ((int)sval.size()<nitem) sval.resize(nitem);
+	
+	while (searching) {
+		if (!iffast) {
+			
+			if (!rows.nextrow()) return false;
+			lineno++;
+			
+			// Items are separated by blanks and tabs; each is tested, converted
+			// and scanned for its format in one go, straight from the row text
+			
+			pchar=rows.rowtext(len);
+			pend=pchar+len;
+			if (pend>pchar && pend[-1]=='\n') {
+				pend--;
+				endat=nitem;
+			}
+			else endat=-1;
+			
+			blank=true;
+			isnum=true;
+			for (i=0;i<nitem;i++) {
+				while (pchar<pend && (*pchar==' ' || *pchar=='\t')) pchar++;
+				pstart=pchar;
+				while (pchar<pend && *pchar!=' ' && *pchar!='\t') pchar++;
+				if (pchar==pend && endat<0) endat=i;
+				if (!isnum) continue;
+				scannumber(pstart,pchar-pstart,sval[i]);
+				if (pchar>pstart) {
+					blank=false;
+					if (!sval[i].isnum) isnum=false;
+				}
+			}
+			
+			// A last line without a newline must hold all items
+			
+			if (endat<nitem-1) return false;
+			
+			if (blank) {
+				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename);
+				runstats.rowsblank++;
+			}
+			else if (!isnum) {
+				printf("Line %d of %s contains non-numeric data - ignoring entire line\n",
+					lineno,(char*)filename);
+				runstats.rowsnonnumeric++;
+			}
+			else {
+				for (i=0;i<nitem;i++) {
+					if (sval[i].ifplain) {
+						if (sval[i].places>items[i].places) items[i].places=sval[i].places;
+						if (sval[i].digits>items[i].digits) items[i].digits=sval[i].digits;
+						if (sval[i].ifsign) items[i].ifsign=true;
+					}
+					else items[i].ifnum=false;
+					dval[i]=sval[i].value;
+					searching=false;
+				}
+				runstats.rowsparsed++;
+			}
+		}
+		else {
+			if (!rows.nextrow() || !rows.rowok()) return false;
+			lineno++;
+			for (i=0;i<nitem;i++) dval[i]=rows.values()[i];
+			searching=false;
+			runstats.rowsparsed++;
+		}
+	}
+	
+	return true;
+}
+
+bool finditem(xtring item,int& itemno,xtring infile,Item* items,int nitem) {
+	
+	int i;
+	
+	if (itemno) {
+		// taking data from specified column number - no header assumed
+		
+		if (itemno>nitem) {
+			printf("Column %d not found in %s (%d columns)\n",itemno,(char*)infile,nitem);
+			return false;
+		}
+		itemno--; // convert to 0-based
+	}
+	else {
+		itemno=-1;
+		for (i=0;i<nitem;i++) {
+			if (items[i].label==item) {
+				itemno=i;
+				i=nitem;
+			}
+		}
+		if (itemno==-1) {
+			
+			// Not found - try case insensitive comparison
+			
+			itemno=-1;
+			for (i=0;i<nitem;i++) {
+				if (items[i].label.lower()==item.lower()) {
+					itemno=i;
+					i=nitem;
+				}
+			}
+			
+			if (itemno==-1) {
+				printf("Item %s not found in %s\n",(char*)item,(char*)infile);
+				return false;
+			}
+			else {
+				printf("Item %s not found in %s\n",(char*)item,(char*)infile);
+				printf("Choosing %s instead\n",(char*)items[itemno].label);
+			}
+		}
+	}
+	
+	return true;
+}
+
+bool addrecord(const double* dval,double* outval,int nitem,Item* items,
+	int window,bool ifsum,bool ifcentre,int lonitemno,int latitemno) {
+	
+	// Adds a record (row) to the moving window of its grid cell
+	// Returns true, with a row for output in outval, once the window is full
+	// (the items of the row are the mean or sum of the items over the window,
+	// and the longitude, latitude and time those of the last, or with ifcentre
+	// the middle, time step in the window)
+	
+	int cell,i,j,pos;
+	float lon=dval[lonitemno],lat=dval[latitemno];
+	double* row;
+	
+	cell=cells.find(lon,lat);
+	if (cell<0) {
+		cell=cells.add(lon,lat);
+		Window* w=new Window;
+		if (!w) fail();
+		w->init(window,nitem);
+		windows.push_back(w);
+	}
+	Window& w=*windows[cell];
+	
+	// The oldest row is replaced in the ring and taken from the sums
+	
+	row=w.rows+w.next*nitem;
+	if (w.nrow==window)
+		for (i=0;i<nitem;i++) w.sums[i]-=row[i];
+	else w.nrow++;
+	
+	for (i=0;i<nitem;i++) {
+		row[i]=dval[i];
+		w.sums[i]+=dval[i];
+	}
+	
+	w.next++;
+	if (w.next==window) {
+		w.next=0;
+		
+		// Each time round the ring, the sums are recalculated from the rows,
+		// so that rounding errors in adding and subtracting do not build up
+		
+		if (w.nrow==window) {
+			for (i=0;i<nitem;i++) w.sums[i]=0.0;
+			for (j=0;j<window;j++) {
+				row=w.rows+j*nitem;
+				for (i=0;i<nitem;i++) w.sums[i]+=row[i];
+			}
+		}
+	}
+	
+	if (w.nrow<window) return false;
+	
+	// The oldest row in the ring is now at next; a centred window is labelled
+	// with the row window/2 after it (for an even window, the later of the two
+	// middle rows, as in Matlab's movmean; R's filter(sides=2) takes the earlier)
+	
+	if (ifcentre) pos=(w.next+window/2)%window;
+	else pos=(w.next+window-1)%window;
+	row=w.rows+pos*nitem;
+	
+	for (i=0;i<nitem;i++) {
+		if (items[i].ifkey) outval[i]=row[i];
+		else if (ifsum) outval[i]=w.sums[i];
+		else outval[i]=w.sums[i]/(double)window;
+	}
+	
+	return true;
+}
+
+bool processdata(xtring infile,xtring outfile,int window,bool ifsum,bool ifcentre,
+	xtring lonitem,xtring latitem,xtring yearitem,int lonitemno,int latitemno,
+	int yearitemno,xtring sep,bool iffast,bool iffull,unsigned long& nrec) {
+	
+	int i,nitem,dayitemno;
+	int autolonitem,autolatitem,autoyearitem;
+	vector<Item> items;
+	vector<double> dval,outval,maxabs;
+	bool ifvalues;
+	int lineno=0;
+	xtring fmt;
+	ChunkedReader rows;
+	RowBuffer kept; // rows to be written in slow mode
+	const double* row;
+	NumberFormat fastfmt; // for all items in fast mode
+	
+	InputFile in;
+	if (!in.open(infile)) {
+		printf("Could not open %s for input\n",(char*)infile);
+		return false;
+	}
+	
+	OutputFile out;
+	if (!out.open(outfile)) {
+		printf("Could not open %s for output\n",(char*)outfile);
+		return false;
+	}
+	
+	// Read header and find columns containing lon, lat, year
+	runstats.setphase(RunStats::PHASE_HEADER);
+	if (!readheader(in,items,nitem,autolonitem,autolatitem,autoyearitem,dayitemno,
+		infile,dval,ifvalues,lineno)) {
+		return false;
+	}
+	
+	if (lonitem=="" && lonitemno==0) lonitemno=autolonitem;
+	if (latitem=="" && latitemno==0) latitemno=autolatitem;
+	if (yearitem=="" && yearitemno==0) yearitemno=autoyearitem;
+	
+	if (!finditem(lonitem,lonitemno,infile,&items[0],nitem)) return false;
+	if (!finditem(latitem,latitemno,infile,&items[0],nitem)) return false;
+	if (!finditem(yearitem,yearitemno,infile,&items[0],nitem)) return false;
+	
+	if (lonitemno==latitemno || lonitemno==yearitemno || latitemno==yearitemno) {
+		printf("Error: longitude, latitude and year expected in separate columns %d %d %d\n",
+			lonitemno,latitemno,yearitemno);
+		return false;
+	}
+	
+	items[lonitemno].ifkey=items[latitemno].ifkey=items[yearitemno].ifkey=true;
+	if (dayitemno) items[dayitemno-1].ifkey=true;
+	
+	outval.resize(nitem);
+	maxabs.assign(nitem,0.0);
+	
+	printf("%s over %d time steps%s\n",ifsum?"Running sums":"Running means",window,
+		ifcentre?", centred":"");
+	printf("Reading data from %s ...\n",(char*)infile);
+	
+	// In fast mode rows are written as they are calculated; otherwise they are
+	// kept until the formats of all items are known
+	
+	if (iffast) {
+		if (iffull) fastfmt.setshortest();
+		else fastfmt.setgeneral(1);
+		for (i=0;i<nitem;i++) {
+			if (i) out.put(sep);
+			out.printf("%s",(char*)items[i].label);
+		}
+		out.put('\n');
+	}
+	else kept.init(nitem);
+	
+	nrec=0;
+	if (ifvalues) {
+		runstats.rowsparsed++;
+		if (addrecord(&dval[0],&outval[0],nitem,&items[0],window,ifsum,ifcentre,
+			lonitemno,latitemno)) {
+			if (iffast) {
+				for (i=0;i<nitem;i++) {
+					if (i) out.put(sep);
+					out.put(outval[i],fastfmt);
+				}
+				out.put('\n');
+			}
+			else kept.add(&outval[0]);
+			nrec++;
+		}
+	}
+	
+	if (iffast) fmt.printf("%df",nitem);
+	else fmt="";
+	progress.start(in);
+	if (!rows.open(in,fmt)) return false;
+	
+	while (!rows.eof()) {
+		
+		// Read next record in file
+		
+		runstats.setphase(RunStats::PHASE_READ);
+		progress.tick(rows);
+		if (readrecord(rows,&dval[0],nitem,&items[0],iffast,lineno,infile)) {
+			
+			runstats.setphase(RunStats::PHASE_AGGREGATE);
+			if (addrecord(&dval[0],&outval[0],nitem,&items[0],window,ifsum,ifcentre,
+				lonitemno,latitemno)) {
+				
+				if (iffast) {
+					runstats.setphase(RunStats::PHASE_FORMAT);
+					for (i=0;i<nitem;i++) {
+						if (i) out.put(sep);
+						out.put(outval[i],fastfmt);
+					}
+					out.put('\n');
+				}
+				else {
+					kept.add(&outval[0]);
+					for (i=0;i<nitem;i++)
+						if (fabs(outval[i])>maxabs[i]) maxabs[i]=fabs(outval[i]);
+				}
+				nrec++;
+			}
+		}
+	}
+	
+	progress.stop();
+	
+	// Slow mode
+	
+	if (!iffast) {
+		
+		// Print header row; means keep the decimal places of their item, but
+		// sums may need more digits, and either may be negative
+		
+		runstats.setphase(RunStats::PHASE_FORMAT);
+		for (i=0;i<nitem;i++) {
+			if (!items[i].ifkey) {
+				if (maxabs[i]>=1.0 && (int)log10(maxabs[i])+1>items[i].digits)
+					items[i].digits=(int)log10(maxabs[i])+1;
+				if (ifsum) items[i].ifsign=true;
+			}
+			items[i].compute_fmt();
+			if (i) out.put(sep);
+			out.printf(items[i].lfmt,(char*)items[i].label);
+		}
+		out.put('\n');
+		
+		// Write the rows kept
+		
+		kept.rewind();
+		while ((row=kept.next())) {
+			for (i=0;i<nitem;i++) {
+				if (i) out.put(sep);
+				out.put(row[i],items[i].nfmt);
+			}
+			out.put('\n');
+		}
+	}
+	
+	rows.close();
+	in.close();
+	out.close();
+	runstats.setphase(RunStats::PHASE_NONE);
+	
+	return true;
+}
+
+
+void stripfilename(xtring& text) {
+	
+	// Extracts file part (no extension or directory part) from a pathname
+	
+	int i;
+	
+	i=text.len()-1;
+	while (i>=0) {
+		if (text[i]=='/' || text[i]=='\\') {
+			text=text.mid(i+1);
+			i=0;
+		}
+		i--;
+	}
+	
+	i=0;
+	while (i<(int)text.len()) {
+		if (text[i]=='.') {
+			text=text.left(i);
+			i=text.len();
+		}
+		i++;
+	}
+}
+
+void helptext(FILE* out,xtring exe) {
+	
+	fprintf(out,"Usage: %s <input-file> -w <window> <options>\n\n",(char*)exe);
+	fprintf(out,"Writes the running mean (or sum) of each item over a moving window of time steps,\n");
+	fprintf(out,"for each grid cell separately. Rows of each grid cell are expected in time order;\n");
+	fprintf(out,"a row is written for each time step at which the window is full. Longitude,\n");
+	fprintf(out,"latitude, year (and day, if there is a column labelled Day) are those of the\n");
+	fprintf(out,"last time step in the window, or with -centre the middle one.\n\n");
+	fprintf(out,"Options:\n\n");
+	fprintf(out,"-w <window>\n");
+	fprintf(out,"    Number of time steps (rows of each grid cell) to average over\n");
+	fprintf(out,"-o <output-file>\n");
+	fprintf(out,"    Pathname for output file\n");
+	fprintf(out,"-sum\n");
+	fprintf(out,"    Running sums instead of means\n");
+	fprintf(out,"-centre\n");
+	fprintf(out,"    Centred window: each row is labelled with the middle time step of its window\n");
+	fprintf(out,"    (for an even window, the later of the two middle time steps, as Matlab's\n");
+	fprintf(out,"    movmean)\n");
+	fprintf(out,"-lon <item-name> | <column-number>\n");
+	fprintf(out,"    Item name or 1-based column number for longitude data\n");
+	fprintf(out,"-lat <item-name> | <column-number>\n");
+	fprintf(out,"    Item name or 1-based column number for latitude data\n");
+	fprintf(out,"-y <item-name> | <column-number>\n");
+	fprintf(out,"    Item name or 1-based column number for year or time step data\n");
+	fprintf(out,"-tab\n");
+	fprintf(out,"    Tab-delimited output\n");
+	fprintf(out,"-fast\n");
+	fprintf(out,"    Fast mode: tab-delimited output, written as it is calculated rather than\n");
+	fprintf(out,"    once the formats of all items are known, with as many significant digits\n");
+	fprintf(out,"    as needed to represent each value exactly (up to 17)\n");
+	fprintf(out,"-g\n");
+	fprintf(out,"    In fast mode, write values rounded to 6 significant digits\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
+	fprintf(out,"-help\n");
+	fprintf(out,"   Displays this help message\n");
+}
+
+
+void printhelp(xtring exe) {
+	
+	helptext(stdout,exe);
+	
+	FILE* out=fopen("usage.txt","wt");
+	if (out) {
+		helptext(out,exe);
+		printf("\nHelp message is also available in the file usage.txt in this directory\n");
+		fclose(out);
+	}
+	
+	exit(99);
+}
+
+void abort(xtring exe) {
+	
+	printf("Usage: %s <input-file> -w <window> <options>\n",(char*)exe);
+	printf("Options: -o <output-file>\n");
+	printf("         -sum\n");
+	printf("         -centre\n");
+	printf("         -lon <item-name> | <column-number>\n");
+	printf("         -lat <item-name> | <column-number>\n");
+	printf("         -y <item-name> | <column-number>\n");
+	printf("         -tab\n");
+	printf("         -fast\n");
+	printf("         -g\n");
+	printf("         -stats\n");
+	printf("         -help\n");
+	
+	exit(99);
+}
+
+bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,int& window,
+	bool& ifsum,bool& ifcentre,xtring& lonitem,xtring& latitem,xtring& yearitem,
+	int& lonitemno,int& latitemno,int& yearitemno,xtring& sep,bool& iffast,bool& iffull) {
+	
+	int i;
+	xtring arg;
+	bool haveinfile=false;
+	ifsum=false;
+	ifcentre=false;
+	iffast=false;
+	iffull=true;
+	double dval;
+	sep=" ";
+	
+	// Defaults
+	outfile="";
+	window=0;
+	lonitem=latitem=yearitem="";
+	lonitemno=latitemno=yearitemno=0;
+	
+	if (argc<2) {
+		printf("Input file name or path must be specified\n");
+		return false;
+	}
+	
+	for (i=1;i<argc;i++) {
+		arg=argv[i];
+		if (arg[0]=='-') {
+			arg=arg.lower();
+			if (arg=="-o") { // output file
+				if (argc>=i+2) {
+					outfile=argv[i+1];
+				}
+				else {
+					printf("Option -o must be followed by output file name or path\n");
+					return false;
+				}
+				i+=1;
+			}
+			else if (arg=="-w") { // window length
+				if (argc>=i+2) {
+					arg=argv[i+1];
+					if (!arg.isnum() || arg.num()<1.0 || int(arg.num())!=arg.num()) {
+						printf("Option -w must be followed by a whole number of time steps\n");
+						return false;
+					}
+					window=arg.num();
+				}
+				else {
+					printf("Option -w must be followed by a whole number of time steps\n");
+					return false;
+				}
+				i+=1;
+			}
+			else if (arg=="-lon") { // longitude column label or item number
+				if (argc>=i+2) {
+					lonitem=argv[i+1];
+					if (lonitem.isnum()) {
+						dval=lonitem.num();
+						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
+							lonitemno=dval;
+							lonitem="";
+						}
+					}
+				}
+				else {
+					printf("Option -lon must be followed by label or column number\n");
+					return false;
+				}
+				i+=1;
+			}
+			else if (arg=="-lat") { // latitude column label or item number
+				if (argc>=i+2) {
+					latitem=argv[i+1];
+					if (latitem.isnum()) {
+						dval=latitem.num();
+						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
+							latitemno=dval;
+							latitem="";
+						}
+					}
+				}
+				else {
+					printf("Option -lat must be followed by label or column number\n");
+					return false;
+				}
+				i+=1;
+			}
+			else if (arg=="-y" || arg=="-year") { // year column label or item number
+				if (argc>=i+2) {
+					yearitem=argv[i+1];
+					if (yearitem.isnum()) {
+						dval=yearitem.num();
+						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
+							yearitemno=dval;
+							yearitem="";
+						}
+					}
+				}
+				else {
+					printf("Option -y must be followed by label or column number\n");
+					return false;
+				}
+				i+=1;
+			}
+			else if (arg=="-sum") ifsum=true;
+			else if (arg=="-centre" || arg=="-center") ifcentre=true;
+			else if (arg=="-tab") {
+				sep="\t";
+			}
+			else if (arg=="-fast") {
+				sep="\t";
+				iffast=true;
+			}
+			else if (arg=="-g") iffull=false;
+			else if (arg=="-stats") runstats.enable();
+			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
+			else {
+				printf("Invalid option %s\n",(char*)arg);
+				return false;
+			}
+		}
+		else {
+			if (haveinfile) {
+				printf("Only one input file may be specified\n");
+				return false;
+			}
+			else {
+				infile=arg;
+				haveinfile=true;
+			}
+		}
+	}
+	
+	if (!haveinfile) {
+		printf("Input file name or path must be specified\n");
+		return false;
+	}
+	
+	if (!window) {
+		printf("Window length must be specified with option -w\n");
+		return false;
+	}
+	
+	if (outfile=="") {
+		
+		xtring filepart=infile;
+		stripfilename(filepart);
+		
+		outfile.printf("%s_%s%d.txt",(char*)filepart,ifsum?"rsum":"rmean",window);
+	}
+	
+	return true;
+}
+
+
+int main(int argc,char* argv[]) {
+	
+	xtring infile,outfile,lonitem,latitem,yearitem,header;
+	int window,lonitemno,latitemno,yearitemno,i;
+	bool ifsum,ifcentre,iffast,iffull;
+	unsigned long nrec;
+	xtring sep;
+	
+	if (!processargs(argc,argv,infile,outfile,window,ifsum,ifcentre,lonitem,latitem,
+		yearitem,lonitemno,latitemno,yearitemno,sep,iffast,iffull))
+			abort(argv[0]);
+	
+	unixtime(header);
+	header=(xtring)"[RMEAN  "+header+"]\n\n";
+	printf("%s",(char*)header);
+	
+	if (processdata(infile,outfile,window,ifsum,ifcentre,lonitem,latitem,yearitem,
+		lonitemno,latitemno,yearitemno,sep,iffast,iffull,nrec)) {
+		
+		printf("\n%lu records written to %s\n\n",nrec,(char*)outfile);
+	}
+	
+	for (i=0;i<(int)windows.size();i++) delete windows[i];
+	
+	runstats.print("rmean");
+	return 0;
+}
@@ -14,65 +14,17 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <math.h>
 #include <gutil.h>
 #include <vector>
-#include <map>
 
 using namespace std;
 
-const int MAXITEM=380;
-	// Maximum number of items in a record (row) of an output file
-	// (not including longitude,latitude,id and year)
-
-class Record {
-
-public:
-	float lon;
-	float lat;
-	float year;
-	int nrec;
-	float val[MAXITEM];
-	
-	Record() {
-	
-		int i;
-		
-		nrec=0;
-		lon=lat=0.0;
-		year=0.0;
-		
-		for (i=0;i<MAXITEM;i++) val[i]=0.0;
-	}
-	
-	void add_record(Record& rec) {
-	
-		// Function to add another record to this record
-		
-		int i;
-		
-		if (lon!=rec.lon || lat!=rec.lat) {
-			printf("add_record: lon or lat mismatch\n");
-			exit(99);
-		}
-		
-		for (i=0;i<MAXITEM;i++) val[i]+=rec.val[i];
-		nrec+=rec.nrec;
-	}
-	
-	void average() {
-	
-		// Calculates average over number of added records
-		
-		int i;
-		if (nrec)
-			for (i=0;i<MAXITEM;i++) val[i]/=(double)nrec;
-	}
-};
-
 class Item {
 
 public:
 	xtring label,fmt,lfmt;
+	NumberFormat nfmt;
 	bool ifnum;
 	bool ifsign;
 	int places;
@@ -97,19 +49,222 @@ public:
 		
 		if (label.len()>w) w=label.len();
 		
-		if (ifnum)
+		if (ifnum) {
 			fmt.printf("%%%d.%df",w,places);
-		else fmt.printf("%%%dg",w);
+			nfmt.setfixed(w,places);
+		}
+		else {
+			fmt.printf("%%%dg",w);
+			nfmt.setgeneral(w);
+		}
 		
 		lfmt.printf("%%%ds",w);
 	}
 };
 
-// Global matrix to store data from files
-vector<Record> data;
+// Statistics that may be written for each item (percentiles are given as
+// median or p<percentile>, e.g. p95, rather than by name)
+enum {STAT_MEAN,STAT_SD,STAT_MIN,STAT_MAX,STAT_SUM,STAT_COUNT,STAT_FIRST,STAT_LAST,
+	STAT_SLOPE,STAT_INTERCEPT,STAT_R2,STAT_PERCENTILE,NSTAT};
+const char* statname[NSTAT]={"mean","sd","min","max","sum","count","first","last",
+	"slope","intercept","r2","percentile"};
+
+// Statistics to write, in the order given with -stat, with the quantile (0-1)
+// of each percentile and the name of each in column labels
+vector<int> stats;
+vector<double> statq;
+vector<xtring> statlabel;
+bool ifstat[NSTAT];
+bool iftrend; // any of slope, intercept and r2
+
+// Accuracy parameter for the sketches from which percentiles are estimated
+// (0 for exact percentiles)
+int sketchk=QUANTILESKETCH_K;
+
+class Slice {
+
+	// A time slice (range of years or time steps) to average over, with the
+	// grid cells found in it
+
+public:
+	float fromyear,toyear;
+	bool iffrom,ifto;
+	xtring outfile;
+	
+	// Table of sums for each grid cell, one column per item; the weight of
+	// each row is the number of records summed
+	RecordTable data;
+	
+	// Running mean and sum of squared deviations from it (Welford's method),
+	// minimum, maximum, first and last value for each grid cell, allocated
+	// only for the statistics selected
+	RecordTable runmean,m2,minval,maxval,firstval,lastval;
+	
+	// For the least squares trend against year: running mean and sum of
+	// squared deviations of the year (two columns), and sum of products of
+	// deviations of year and each item
+	RecordTable years,cxy;
+	
+	// For percentiles: a sketch of the distribution of each item (other than
+	// longitude, latitude and year) in each grid cell
+	vector<QuantileSketch*> sketches;
+	vector<bool> ifsketch;
+	
+	// Longitude and latitude of each grid cell, numbered as the rows of data
+	CellIndex cells;
+	
+	Slice() {
+		fromyear=toyear=0;
+		iffrom=ifto=false;
+	}
+	
+	~Slice() {
+		for (size_t i=0;i<sketches.size();i++) delete[] sketches[i];
+	}
+	
+	bool includes(double year) const {
+		return (year>=fromyear || !iffrom) && (year<=toyear || !ifto);
+	}
+	
+	void init(int nitem,int lonitemno,int latitemno,int yearitemno) {
+		data.init(nitem);
+		if (ifstat[STAT_PERCENTILE]) {
+			ifsketch.assign(nitem,true);
+			ifsketch[lonitemno]=ifsketch[latitemno]=ifsketch[yearitemno]=false;
+		}
+		if (ifstat[STAT_SD] || iftrend) {
+			runmean.init(nitem);
+			m2.init(nitem);
+		}
+		if (iftrend) {
+			years.init(2);
+			cxy.init(nitem);
+		}
+		if (ifstat[STAT_MIN]) minval.init(nitem);
+		if (ifstat[STAT_MAX]) maxval.init(nitem);
+		if (ifstat[STAT_FIRST]) firstval.init(nitem);
+		if (ifstat[STAT_LAST]) lastval.init(nitem);
+	}
+	
+	int addcell(float lon,float lat) {
+	
+		// Adds a grid cell, returning its row number
+		
+		cells.add(lon,lat);
+		if (ifstat[STAT_SD] || iftrend) {
+			runmean.addrow();
+			m2.addrow();
+		}
+		if (iftrend) {
+			years.addrow();
+			cxy.addrow();
+		}
+		if (ifstat[STAT_MIN]) minval.addrow();
+		if (ifstat[STAT_MAX]) maxval.addrow();
+		if (ifstat[STAT_FIRST]) firstval.addrow();
+		if (ifstat[STAT_LAST]) lastval.addrow();
+		if (ifstat[STAT_PERCENTILE]) {
+			QuantileSketch* sketch=new QuantileSketch[data.ncolumn()];
+			if (!sketch) fail();
+			for (int c=0;c<data.ncolumn();c++)
+				if (ifsketch[c]) sketch[c].init(sketchk);
+			sketches.push_back(sketch);
+		}
+		return data.addrow();
+	}
+	
+	void add(int cell,const double* val,double x) {
+	
+		// Adds a record (all items) for a grid cell; x is its year
+		
+		int c,ncol=data.ncolumn();
+		double n,delta,dx;
+		
+		data.add(cell,val);
+		n=data.weight(cell);
+		
+		if (iftrend) {
+			dx=x-years(cell,0);
+			years(cell,0)+=dx/n;
+			years(cell,1)+=dx*(x-years(cell,0));
+		}
+		if (ifstat[STAT_SD] || iftrend) {
+			for (c=0;c<ncol;c++) {
+				delta=val[c]-runmean(cell,c);
+				runmean(cell,c)+=delta/n;
+				m2(cell,c)+=delta*(val[c]-runmean(cell,c));
+				if (iftrend) cxy(cell,c)+=dx*(val[c]-runmean(cell,c));
+			}
+		}
+		if (ifstat[STAT_MIN]) {
+			if (n==1.0) minval.set(cell,val);
+			else for (c=0;c<ncol;c++) if (val[c]<minval(cell,c)) minval(cell,c)=val[c];
+		}
+		if (ifstat[STAT_MAX]) {
+			if (n==1.0) maxval.set(cell,val);
+			else for (c=0;c<ncol;c++) if (val[c]>maxval(cell,c)) maxval(cell,c)=val[c];
+		}
+		if (ifstat[STAT_FIRST] && n==1.0) firstval.set(cell,val);
+		if (ifstat[STAT_LAST]) lastval.set(cell,val);
+		if (ifstat[STAT_PERCENTILE]) {
+			for (c=0;c<ncol;c++)
+				if (ifsketch[c]) sketches[cell][c].add(val[c]);
+		}
+	}
+	
+	double value(int stat,double q,int cell,int item) const {
+	
+		// A statistic for one item in a grid cell (q is the quantile for a
+		// percentile)
+		
+		double n=data.weight(cell);
+		double slope=0.0;
+		
+		// With all records in the same year (or the item constant) the
+		// slope is taken as zero, as is r2
+		
+		if (iftrend && years(cell,1)>0.0) slope=cxy(cell,item)/years(cell,1);
+		
+		switch (stat) {
+			case STAT_MEAN: return n?data(cell,item)/n:data(cell,item);
+			case STAT_SD: return n>1.0?sqrt(m2(cell,item)/(n-1.0)):0.0;
+			case STAT_MIN: return minval(cell,item);
+			case STAT_MAX: return maxval(cell,item);
+			case STAT_SUM: return data(cell,item);
+			case STAT_COUNT: return n;
+			case STAT_FIRST: return firstval(cell,item);
+			case STAT_LAST: return lastval(cell,item);
+			case STAT_SLOPE: return slope;
+			case STAT_INTERCEPT: return runmean(cell,item)-slope*years(cell,0);
+			case STAT_R2:
+				if (years(cell,1)>0.0 && m2(cell,item)>0.0)
+					return cxy(cell,item)*cxy(cell,item)/(years(cell,1)*m2(cell,item));
+				return 0.0;
+			case STAT_PERCENTILE: return sketches[cell][item].quantile(q);
+		}
+		return 0.0;
+	}
+	
+	xtring name() const {
+	
+		// Years covered, as used in output file names
+		
+		xtring text;
+		
+		if (iffrom && ifto) {
+			if (fromyear==toyear) text.printf("%g",(double)fromyear);
+			else text.printf("%g-%g",(double)fromyear,(double)toyear);
+		}
+		else if (ifto) text.printf("-%g",(double)toyear);
+		else if (iffrom) text.printf("%g-",(double)fromyear);
+		else text="mean";
+		
+		return text;
+	}
+};
 
-// A map which maps from coordinates to indexes into the data vector
-map<pair<float, float>, int> coords_to_record_pos;
+// Time slices to average over, all accumulated in one pass through the input
+vector<Slice*> slices;
 
 bool scanitem(const char* text,int& places,int& digits,bool& ifsign) {
 
@@ -142,9 +297,9 @@ bool scanitem(const char* text,int& places,int& digits,bool& ifsign) {
 }
 
 
-bool readheader(FILE*& in,Item* items,int& ncol,
+bool readheader(InputFile& in,vector<Item>& items,int& ncol,
 	int& lonitemno,int& latitemno,int& yearitemno,xtring filename,
-	double values[MAXITEM],bool& ifvalues,int& lineno) {
+	vector<double>& values,bool& ifvalues,int& lineno) {
 
 	// Reads header row of an LPJ-GUESS output file
 	// label = array of header labels
@@ -152,14 +307,15 @@ bool readheader(FILE*& in,Item* items,int& ncol,
 	// lonitemno = guess at column number (1-based) containing longitude
 	// latitemno = guess at column number (1-based) containing latitude
 	// yearitemno = guess at column number (1-based) containing year or time step
-	// Returns false if too many items in file
+	// items and values are extended to the number of columns
+	// Returns false if file contains no data or too few columns
 	
 	xtring line,item;
 	int pos,i;
 	bool alphabetics=false;
 	ncol=0;
 	
-	while (!ncol && !feof(in)) {
+	while (!ncol && !in.eof()) {
 	
 		readfor(in,"a#",&line);
 		lineno++;
@@ -172,9 +328,9 @@ bool readheader(FILE*& in,Item* items,int& ncol,
 		while (pos!=-1) {
 			line=line.mid(pos);
 			pos=line.findoneof(" \t");
-			if (ncol>MAXITEM+2) {
-				printf("Too many columns (>%d) in %s\n",MAXITEM,(char*)filename);
-				return false;
+			if (ncol==(int)items.size()) {
+				items.resize(ncol+1);
+				values.resize(ncol+1);
 			}
 			if (pos>0) {
 				item=line.left(pos);
@@ -235,74 +391,121 @@ bool readheader(FILE*& in,Item* items,int& ncol,
 	return true;
 }
 
-bool readrecord(FILE*& in,Record& rec,int nitem,int lonitemno,int latitemno,int yearitemno,
-	Item* items,const char* sfmt,const char* dfmt,int nrec,bool iffast,int& lineno,xtring& filename) {
+bool readrecord(ChunkedReader& rows,double* dval,float& lon,float& lat,float& year,
+	int nitem,int lonitemno,int latitemno,int yearitemno,
+	Item* items,int nrec,bool iffast,int& lineno,xtring& filename) {
 
-	// Reads one record (row) in output file
+	// Reads one record (row) in output file into dval (nitem values)
 	// Returns false on end of file
 	// nitem = total number of items including lon, lat, year
 	// lonitemno = column number (0-based) containing longitude
 	// latitemno = column number (0-based) containing latitude
 	// yearitemno = column number (0-based) containing year or time step
 	
-	static xtring sval[MAXITEM]; // static to avoid reallocating in each call
-	double dval[MAXITEM];
-	int i,places,digits;
-	bool ifsign,searching=true,blank,isnum;
+	static vector<ScannedItem> sval; // static to avoid reallocating in each call
+	const char* pchar;
+	const char* pend;
+	const char* pstart;
+	int i,len,endat;
+	bool searching=true,blank,isnum;
+
+	if ((int)sval.size()<nitem) sval.resize(nitem);
 
 	while (searching) {
 		if (nrec<100 || !(nrec%10) || !iffast) {
 		
-			if (!readfor(in,sfmt,sval)) return false;
+			if (!rows.nextrow()) return false;
 			lineno++;
 			
+			// Items are separated by blanks and tabs; each is tested, converted
+			// and scanned for its format in one go, straight from the row text
+			
+			pchar=rows.rowtext(len);
+			pend=pchar+len;
+			if (pend>pchar && pend[-1]=='\n') {
+				pend--;
+				endat=nitem;
+			}
+			else endat=-1;
+			
 			blank=true;
 			isnum=true;
 			for (i=0;i<nitem;i++) {
-				if (sval[i]!="") {
+				while (pchar<pend && (*pchar==' ' || *pchar=='\t')) pchar++;
+				pstart=pchar;
+				while (pchar<pend && *pchar!=' ' && *pchar!='\t') pchar++;
+				if (pchar==pend && endat<0) endat=i;
+				if (!isnum) continue;
+				scannumber(pstart,pchar-pstart,sval[i]);
+				if (pchar>pstart) {
 					blank=false;
-					if (!sval[i].isnum()) {
-						isnum=false;
-						i=nitem;
-					}
+					if (!sval[i].isnum) isnum=false;
 				}
 			}
 			
-			if (blank)
+			// Like reading with readfor, a last line without a newline must
+			// hold all items
+			
+			if (endat<nitem-1) return false;
+			
+			if (blank) {
 				printf("Line %d of %s is blank - ignoring\n",lineno,(char*)filename);
+				runstats.rowsblank++;
+			}
 			else if (!isnum) {
 				printf("Line %d of %s contains non-numeric data - ignoring entire line\n",
 					lineno,(char*)filename);
+				runstats.rowsnonnumeric++;
 			}
 			else {
 				for (i=0;i<nitem;i++) {
-					 if (scanitem(sval[i],places,digits,ifsign)) {
-						if (places>items[i].places) items[i].places=places;
-						if (digits>items[i].digits) items[i].digits=digits;
-						if (ifsign) items[i].ifsign=true;
+					if (sval[i].ifplain) {
+						if (sval[i].places>items[i].places) items[i].places=sval[i].places;
+						if (sval[i].digits>items[i].digits) items[i].digits=sval[i].digits;
+						if (sval[i].ifsign) items[i].ifsign=true;
 					}
 					else items[i].ifnum=false;
-					dval[i]=sval[i].num();
+					dval[i]=sval[i].value;
 					searching=false;
 				}
+				runstats.rowsparsed++;
 			}
 		}
 		else {
-			if (!readfor(in,dfmt,dval)) return false;
+			if (!rows.nextrow() || !rows.rowok()) return false;
 			lineno++;
+			for (i=0;i<nitem;i++) dval[i]=rows.values()[i];
 			searching=false;
+			runstats.rowsparsed++;
 		}
 		
-		rec.lon=dval[lonitemno];
-		rec.lat=dval[latitemno];
-		rec.year=dval[yearitemno];
-		for (i=0;i<nitem;i++) rec.val[i]=dval[i];
-		rec.nrec=1;
+		lon=dval[lonitemno];
+		lat=dval[latitemno];
+		year=dval[yearitemno];
 	}
 	
 	return true;
 }
 
+bool readrecord(ColumnCache& cache,double* dval,float& lon,float& lat,float& year,
+	int nitem,int lonitemno,int latitemno,int yearitemno) {
+
+	// Fetches the next record (row) from the binary cache of the input file
+	// Returns false after the last row
+	
+	int i;
+	
+	if (!cache.nextrow()) return false;
+	for (i=0;i<nitem;i++) dval[i]=cache.values()[i];
+	runstats.rowsparsed++;
+	
+	lon=dval[lonitemno];
+	lat=dval[latitemno];
+	year=dval[yearitemno];
+	
+	return true;
+}
+
 bool finditem(xtring item,int& itemno,xtring infile,Item* items,int nitem) {
 
 	int i;
@@ -310,6 +513,10 @@ bool finditem(xtring item,int& itemno,xtring infile,Item* items,int nitem) {
 	if (itemno) {
 		// taking data from specified column number - no header assumed
 		
+		if (itemno>nitem) {
+			printf("Column %d not found in %s (%d columns)\n",itemno,(char*)infile,nitem);
+			return false;
+		}
 		itemno--; // convert to 0-based
 	}
 	else {
@@ -346,69 +553,66 @@ bool finditem(xtring item,int& itemno,xtring infile,Item* items,int nitem) {
 	return true;
 }
 
-int findrec(float lon,float lat) {
+int countcells(xtring filename) {
 
-	// Returns record number in global data corresponding to given longitude and latitude
-	// -1 if not found
+	// Returns the number of grid cells (non-blank lines) in a gridlist file,
+	// or -1 if the file could not be opened
 	
-	if (data.empty()) {
-		return -1;
-	}
-
-	// Start by checking the latest record, this should be a match most of the
-	// time if input is sorted by grid cell.
-	const Record& latest = data.back();
-
-	if (latest.lon == lon && latest.lat == lat) {
-		return data.size()-1;
-	}
-
-	// If no match, search the map
-	map<pair<float,float>, int>::const_iterator itr = 
-		coords_to_record_pos.find(make_pair(lon, lat));
-
-	if (itr != coords_to_record_pos.end()) {
-		return (*itr).second;
-	}
-	else {
-		return -1;
+	int ncell=0,i;
+	xtring line;
+	
+	InputFile in;
+	if (!in.open(filename)) return -1;
+	
+	while (in.readline(line)) {
+		for (i=0;i<line.len();i++) {
+			if (line[i]>' ') {
+				ncell++;
+				break;
+			}
+		}
 	}
+	
+	in.close();
+	return ncell;
 }
 
-bool readdata(xtring filename,float fromyear,float toyear,bool iffrom,bool ifto,
-	Item* items,int& nitem,int& lonitemno,int& latitemno,int& yearitemno,
-	xtring lonitem,xtring latitem,xtring yearitem,bool iffast) {
+bool readdata(xtring filename,
+	vector<Item>& items,int& nitem,int& lonitemno,int& latitemno,int& yearitemno,
+	xtring lonitem,xtring latitem,xtring yearitem,xtring gridfile,bool iffast,bool ifcache) {
 
-	int recno,i;
+	int recno,i,ncell,s,maxcell;
+	int nslice=slices.size();
 	int autolonitem,autolatitem,autoyearitem;
-	double dval[MAXITEM];
+	vector<double> dval;
 	bool ifvalues;
 	int lineno=0;
-	xtring sfmt,dfmt;
-	Record rec;
+	xtring fmt;
+	ChunkedReader rows;
+	ColumnCache cache;
+	bool ifcached=false;
+	float lon,lat,year;
 	
-	FILE* in=fopen(filename,"rt");
-	if (!in) {
+	InputFile in;
+	if (!in.open(filename)) {
 		printf("Could not open %s for input\n",(char*)filename);
 		return false;
 	}
 
 	// Read header and find columns containing lon, lat, year
+	runstats.setphase(RunStats::PHASE_HEADER);
 	if (!readheader(in,items,nitem,autolonitem,autolatitem,autoyearitem,
 		filename,dval,ifvalues,lineno)) {
 		return false;
 	}
 	
-	sfmt.printf("%da",nitem);
-	dfmt.printf("%df",nitem);
-	
 	if (lonitem=="" && lonitemno==0) lonitemno=autolonitem;
 	if (latitem=="" && latitemno==0) latitemno=autolatitem;
 	if (yearitem=="" && yearitemno==0) yearitemno=autoyearitem;
 	
-	if (!finditem(lonitem,lonitemno,filename,items,nitem)) return false;
-	if (!finditem(latitem,latitemno,filename,items,nitem)) return false;
-	if (!finditem(yearitem,yearitemno,filename,items,nitem)) return false;
+	if (!finditem(lonitem,lonitemno,filename,&items[0],nitem)) return false;
+	if (!finditem(latitem,latitemno,filename,&items[0],nitem)) return false;
+	if (!finditem(yearitem,yearitemno,filename,&items[0],nitem)) return false;
 	
 	if (lonitemno==latitemno || lonitemno==yearitemno || latitemno==yearitemno) {
 		printf("Error: longitude, latitude and year expected in separate columns %d %d %d\n",
@@ -421,117 +625,200 @@ bool readdata(xtring filename,float fromyear,float toyear,bool iffrom,bool ifto,
 	items[lonitemno].label=lonitem;
 	items[latitemno].label=latitem;
 	
-	if (iffrom && ifto) {
-		if (fromyear==toyear)
-			printf("Extracting data for time step %g\n",(double)fromyear);
-		else printf("Averaging over time slice from %g to %g\n",(double)fromyear,(double)toyear);
-	}
-	else if (iffrom) {
-		printf("Averaging over data from time step %g onwards\n",(double)fromyear);
+	for (s=0;s<nslice;s++) {
+		Slice& slice=*slices[s];
+		if (slice.iffrom && slice.ifto) {
+			if (slice.fromyear==slice.toyear)
+				printf("Extracting data for time step %g\n",(double)slice.fromyear);
+			else printf("Averaging over time slice from %g to %g\n",
+				(double)slice.fromyear,(double)slice.toyear);
+		}
+		else if (slice.iffrom) {
+			printf("Averaging over data from time step %g onwards\n",(double)slice.fromyear);
+		}
+		else if (slice.ifto) {
+			printf("Averaging over data up to time step %g\n",(double)slice.toyear);
+		}
+		else printf("Averaging over data from all time steps\n");
 	}
-	else if (ifto) {
-		printf("Averaging over data up to time step %g\n",(double)toyear);
+
+	// Size the grid cell index for the cells in the gridlist, if given
+	
+	if (gridfile!="") {
+		ncell=countcells(gridfile);
+		if (ncell<0) {
+			printf("Could not open gridlist %s for input\n",(char*)gridfile);
+			return false;
+		}
+		for (s=0;s<nslice;s++) slices[s]->cells.reserve(ncell);
 	}
-	else printf("Averaging over data from all time steps\n");
 
 	printf("Reading data from %s ...\n",(char*)filename);
+	runstats.setphase(RunStats::PHASE_READ);
 	
 	// Transfer data from first row (if all numbers)
 	
+	for (s=0;s<nslice;s++) slices[s]->init(nitem,lonitemno,latitemno,yearitemno);
+	
 	if (ifvalues) {
-		if ((dval[yearitemno]>=fromyear || !iffrom) && (dval[yearitemno]<=toyear || !ifto)) {
-			Record rec;
-			rec.lon=dval[lonitemno];
-			rec.lat=dval[latitemno];
-			rec.nrec=1;
-			for (i=0;i<nitem;i++) rec.val[i]=dval[i];
-			data.push_back(rec);
-			coords_to_record_pos[make_pair(rec.lon, rec.lat)] = data.size()-1;
+		runstats.rowsparsed++;
+		for (s=0;s<nslice;s++) {
+			Slice& slice=*slices[s];
+			if (slice.includes(dval[yearitemno])) {
+				recno=slice.addcell((float)dval[lonitemno],(float)dval[latitemno]);
+				slice.add(recno,&dval[0],dval[yearitemno]);
+			}
 		}
 	}
 		
-	while (!feof(in)) {
+	// Remaining rows are fetched from the binary cache if there is one, otherwise
+	// read and converted to numbers in parallel
+	
+	if (ifcache) ifcached=cache.open(filename) && cache.ncolumn()==nitem;
+	if (ifcached) {
+		for (i=0;i<nitem;i++) {
+			if (cache.places(i)>items[i].places) items[i].places=cache.places(i);
+			if (cache.digits(i)>items[i].digits) items[i].digits=cache.digits(i);
+			if (cache.ifsign(i)) items[i].ifsign=true;
+			if (!cache.ifnum(i)) items[i].ifnum=false;
+		}
+	}
+	else {
+		if (iffast) fmt.printf("%df",nitem);
+		else fmt="";
+		progress.start(in);
+		if (!rows.open(in,fmt)) return false;
+	}
+	
+	while (ifcached?!cache.eof():!rows.eof()) {
 		
 		// Read next record in file
+		// (fast mode samples rows for their format according to the number
+		// of grid cells in the largest slice so far)
 		
-		if (readrecord(in,rec,nitem,lonitemno,latitemno,yearitemno,items,
-							sfmt,dfmt,data.size(),iffast,lineno,filename)) {
+		runstats.setphase(RunStats::PHASE_READ);
+		if (!ifcached) progress.tick(rows);
+		maxcell=0;
+		for (s=0;s<nslice;s++)
+			if ((int)slices[s]->data.size()>maxcell) maxcell=slices[s]->data.size();
+		if (ifcached?readrecord(cache,&dval[0],lon,lat,year,nitem,lonitemno,latitemno,yearitemno):
+			readrecord(rows,&dval[0],lon,lat,year,nitem,lonitemno,latitemno,yearitemno,
+							&items[0],maxcell,iffast,lineno,filename)) {
 		
-			if ((rec.year>=fromyear || !iffrom) && (rec.year<=toyear || !ifto)) {
-			
-				recno=findrec(rec.lon,rec.lat);
-				if (recno<0) {
-					Record new_rec;
-					new_rec.lon=rec.lon;
-					new_rec.lat=rec.lat;
-					recno=data.size();
-					data.push_back(new_rec);
-					coords_to_record_pos[make_pair(new_rec.lon, new_rec.lat)] = data.size()-1;
-					if (!(data.size()%5000)) printf("%d ...\n",data.size());
+			runstats.setphase(RunStats::PHASE_AGGREGATE);
+			for (s=0;s<nslice;s++) {
+				Slice& slice=*slices[s];
+				if (slice.includes(year)) {
+					recno=slice.cells.find(lon,lat);
+					if (recno<0) recno=slice.addcell(lon,lat);
+					
+					slice.add(recno,&dval[0],dval[yearitemno]);
 				}
-				
-				data[recno].add_record(rec);
 			}
 		}
 	}
 	
-	// Now calculate averages for timeslice
-	
-	for (i = 0; i < data.size(); i++) {
-		 data[i].average();
-	}
+	progress.stop();
 	
-	fclose(in);
+	rows.close();
+	in.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 
 	return true;
 }
 
-bool writedata(xtring filename,Item* items,int& nitem,int lonitemno,int latitemno,
+bool writedata(Slice& slice,vector<Item>& items,int& nitem,int lonitemno,int latitemno,
 	int yearitemno,char* sep) {
 	
-	int i,j;
+	int i,k,ncol;
+	unsigned int stat;
+	unsigned long cell;
+	double maxcount;
+	RecordTable& data=slice.data;
+	CellIndex& cells=slice.cells;
+	vector<Item> cols; // one per statistic of each item written
+	vector<int> colitem,colstat;
+	vector<double> colq;
 	
-	FILE* out=fopen(filename,"wt");
-	if (!out) {
-		printf("Could not open %s for output\n",(char*)filename);
+	runstats.setphase(RunStats::PHASE_FORMAT);
+	OutputFile out;
+	if (!out.open(slice.outfile)) {
+		printf("Could not open %s for output\n",(char*)slice.outfile);
 		return false;
 	}
 	
 	// Print header row
 	
 	items[lonitemno].compute_fmt();
-	fprintf(out,items[lonitemno].lfmt,(char*)items[lonitemno].label);
-	fprintf(out,sep);
+	out.printf(items[lonitemno].lfmt,(char*)items[lonitemno].label);
+	out.put(sep);
 	items[latitemno].compute_fmt();
-	fprintf(out,items[latitemno].lfmt,(char*)items[latitemno].label);
+	out.printf(items[latitemno].lfmt,(char*)items[latitemno].label);
+	
+	// Columns take the format of their item, and are labelled with the name of
+	// the statistic as well if there are several
+	
+	maxcount=0.0;
+	for (cell=0;cell<data.size();cell++)
+		if (data.weight(cell)>maxcount) maxcount=data.weight(cell);
 	
 	for (i=0;i<nitem;i++) {
 		if (i!=lonitemno && i!=latitemno && i!=yearitemno) {
-			items[i].compute_fmt();
-			fprintf(out,sep);
-			fprintf(out,items[i].lfmt,(char*)items[i].label);
+			for (stat=0;stat<stats.size();stat++) {
+				Item col=items[i];
+				if (stats.size()>1) col.label+=(xtring)"_"+statlabel[stat];
+				if (stats[stat]==STAT_SD) col.ifsign=false;
+				else if (stats[stat]==STAT_COUNT) {
+					col.ifnum=true;
+					col.ifsign=false;
+					col.places=0;
+					col.digits=maxcount>=1.0?(int)log10(maxcount)+1:1;
+				}
+				else if (stats[stat]==STAT_SLOPE) {
+					// Change per year, often much smaller than the item itself
+					col.ifnum=false;
+					col.digits=7;
+				}
+				else if (stats[stat]==STAT_INTERCEPT) col.ifsign=true;
+				else if (stats[stat]==STAT_R2) {
+					col.ifnum=true;
+					col.ifsign=false;
+					col.digits=1;
+					col.places=4;
+				}
+				col.compute_fmt();
+				cols.push_back(col);
+				colitem.push_back(i);
+				colstat.push_back(stats[stat]);
+				colq.push_back(statq[stat]);
+			}
 		}
 	}
-	fprintf(out,"\n");
+	ncol=cols.size();
+	
+	for (k=0;k<ncol;k++) {
+		out.put(sep);
+		out.printf(cols[k].lfmt,(char*)cols[k].label);
+	}
+	out.put('\n');
 
 	// Print data
 
-	for (i = 0; i < data.size(); i++) {
+	for (cell=0;cell<data.size();cell++) {
 	
-		fprintf(out,items[lonitemno].fmt,(double)data[i].lon);
-		fprintf(out,sep);
-		fprintf(out,items[latitemno].fmt,(double)data[i].lat);
+		out.put((double)cells.lon(cell),items[lonitemno].nfmt);
+		out.put(sep);
+		out.put((double)cells.lat(cell),items[latitemno].nfmt);
 		
-		for (j=0;j<nitem;j++) {
-			if (j!=lonitemno && j!=latitemno && j!=yearitemno) {
-				fprintf(out,sep);
-				fprintf(out,items[j].fmt,(double)data[i].val[j]);
-			}
+		for (k=0;k<ncol;k++) {
+			out.put(sep);
+			out.put(slice.value(colstat[k],colq[k],cell,colitem[k]),cols[k].nfmt);
 		}
-		fprintf(out,"\n");
+		out.put('\n');
 	}
 	
-	fclose(out);
+	out.close();
+	runstats.setphase(RunStats::PHASE_NONE);
 	
 	return true;
 }
@@ -562,6 +849,132 @@ void stripfilename(xtring& text) {
 	}
 }
 
+void insertsuffix(xtring& text,xtring suffix) {
+
+	// Inserts suffix into a pathname before the extension(s) of the file part
+	
+	int i,start;
+	
+	start=0;
+	for (i=0;i<(int)text.len();i++)
+		if (text[i]=='/' || text[i]=='\\') start=i+1;
+	
+	for (i=start;i<(int)text.len();i++) {
+		if (text[i]=='.') {
+			text=text.left(i)+suffix+text.mid(i);
+			return;
+		}
+	}
+	
+	text+=suffix;
+}
+
+bool parseslices(xtring list) {
+
+	// Adds a slice to the global list for each period in a comma-separated
+	// list; a period is a single year (or time step) or a range "from-to"
+	
+	int i,start,dash;
+	xtring period,from,to;
+	Slice* slice;
+	
+	list+=',';
+	start=0;
+	for (i=0;i<(int)list.len();i++) {
+		if (list[i]==',') {
+			period=list.mid(start,i-start);
+			start=i+1;
+			
+			// A dash after the first character separates the years (so that
+			// the first year may be negative)
+			
+			dash=-1;
+			for (int j=1;j<(int)period.len() && dash<0;j++)
+				if (period[j]=='-') dash=j;
+			
+			if (dash<0) from=to=period;
+			else {
+				from=period.left(dash);
+				to=period.mid(dash+1);
+			}
+			
+			// (isnum accepts an empty string, so empty periods and years such
+			// as in "1901-1930," or "1901-" are rejected explicitly)
+			
+			if (from=="" || to=="" || !from.isnum() || !to.isnum()) {
+				printf("Invalid time slice \"%s\" for option -slices: expected <year> or <from-year>-<to-year>\n",
+					(char*)period);
+				return false;
+			}
+			
+			slice=new Slice;
+			if (!slice) fail();
+			slice->fromyear=from.num();
+			slice->toyear=to.num();
+			slice->iffrom=slice->ifto=true;
+			slices.push_back(slice);
+			
+			if (slice->toyear<slice->fromyear) {
+				printf("'To' year must be same as or later than 'from' year in time slice %s\n",
+					(char*)period);
+				return false;
+			}
+		}
+	}
+	
+	return true;
+}
+
+bool parsestats(xtring list) {
+
+	// Sets the statistics to write from a comma-separated list of their names
+	
+	int i,j,start,k;
+	double q;
+	xtring name,percentile;
+	bool found;
+	
+	list=list.lower()+",";
+	start=0;
+	for (i=0;i<(int)list.len();i++) {
+		if (list[i]==',') {
+			name=list.mid(start,i-start);
+			start=i+1;
+			
+			q=0.0;
+			for (k=0;k<STAT_PERCENTILE && name!=statname[k];k++);
+			if (k==STAT_PERCENTILE) {
+				if (name=="median") q=0.5;
+				else {
+					percentile=name.mid(1);
+					if (name[0]!='p' || !percentile.isnum() ||
+						percentile.num()<0.0 || percentile.num()>100.0) {
+						printf("Invalid statistic \"%s\" for option -stat: expected ",(char*)name);
+						for (k=0;k<STAT_PERCENTILE;k++) printf("%s, ",statname[k]);
+						printf("median or p<percentile>\n");
+						return false;
+					}
+					q=percentile.num()/100.0;
+				}
+			}
+			
+			found=false;
+			for (j=0;j<(int)stats.size();j++)
+				if (stats[j]==k && statq[j]==q) found=true;
+			
+			if (!found) {
+				stats.push_back(k);
+				statq.push_back(q);
+				statlabel.push_back(name);
+				ifstat[k]=true;
+			}
+			if (k==STAT_SLOPE || k==STAT_INTERCEPT || k==STAT_R2) iftrend=true;
+		}
+	}
+	
+	return true;
+}
+
 void helptext(FILE* out,xtring exe) {
 
 	fprintf(out,"Usage: %s <input-file> <options>\n\n",(char*)exe);
@@ -572,16 +985,41 @@ void helptext(FILE* out,xtring exe) {
 	fprintf(out,"    Lower bound year or time step for time slice to average over\n");
 	fprintf(out,"-t <to-year>\n");
 	fprintf(out,"    Upper bound year or time step for time slice to average over\n");
+	fprintf(out,"-slices <from-year>-<to-year>,...\n");
+	fprintf(out,"    Several time slices (or single years) to average over in one pass through the\n");
+	fprintf(out,"    input file, e.g. 1901-1930,1961-1990; each is written to its own output file,\n");
+	fprintf(out,"    named after the output file with the years of the slice inserted\n");
+	fprintf(out,"-stat <statistic>,...\n");
+	fprintf(out,"    Statistics to write for each item and grid cell (default mean): mean, sd\n");
+	fprintf(out,"    (sample standard deviation), min, max, sum, count, first or last (value in\n");
+	fprintf(out,"    the time slice), slope, intercept or r2 of the least squares linear trend\n");
+	fprintf(out,"    against year, median or p<percentile> (e.g. p5, p95); with several, each\n");
+	fprintf(out,"    item has a column per statistic, with the name of the statistic appended to\n");
+	fprintf(out,"    its label, e.g. Total_sd\n");
+	fprintf(out,"-exact\n");
+	fprintf(out,"    Exact percentiles, keeping all values of each grid cell in memory; otherwise\n");
+	fprintf(out,"    they are estimated from a sketch of bounded size, which is exact only for\n");
+	fprintf(out,"    cells with no more than %d values in the time slice and otherwise has a\n",
+		QUANTILESKETCH_K);
+	fprintf(out,"    rank error of about 1%%\n");
 	fprintf(out,"-lon <item-name> | <column-number>\n");
 	fprintf(out,"    Item name or 1-based column number for longitude data\n");
 	fprintf(out,"-lat <item-name> | <column-number>\n");
 	fprintf(out,"    Item name or 1-based column number for latitude data\n");
 	fprintf(out,"-y <item-name> | <column-number>\n");
 	fprintf(out,"    Item name or 1-based column number for year or time step data\n");
+	fprintf(out,"-gridlist <gridlist-file>\n");
+	fprintf(out,"    Gridlist of the cells in the input file (one per line), used only to\n");
+	fprintf(out,"    allocate memory for them in advance\n");
 	fprintf(out,"-tab\n");
 	fprintf(out,"    Tab-delimited output\n");
 	fprintf(out,"-fast\n");
 	fprintf(out,"    Fast mode with tab-delimited output\n");
+	fprintf(out,"-cache\n");
+	fprintf(out,"    Read data rows from a binary cache of the input file (<input-file>.gbin),\n");
+	fprintf(out,"    which is created or brought up to date by parsing the input file if necessary\n");
+	fprintf(out,"-stats\n");
+	fprintf(out,"    Write timings and throughput counters to stderr (as JSON) on completion\n");
 	fprintf(out,"-help\n");
 	fprintf(out,"   Displays this help message\n");
 }
@@ -607,11 +1045,17 @@ void abort(xtring exe) {
 	printf("Options: -o <output-file>\n");
 	printf("         -f <from-year>\n");
 	printf("         -t <to-year>\n");
+	printf("         -slices <from-year>-<to-year>,...\n");
+	printf("         -stat <statistic>,...\n");
+	printf("         -exact\n");
 	printf("         -lon <item-name> | <column-number>\n");
 	printf("         -lat <item-name> | <column-number>\n");
 	printf("         -y <item-name> | <column-number>\n");
+	printf("         -gridlist <gridlist-file>\n");
 	printf("         -tab\n");
 	printf("         -fast\n");
+	printf("         -cache\n");
+	printf("         -stats\n");
 	printf("         -help\n");
 
 	exit(99);
@@ -620,20 +1064,23 @@ void abort(xtring exe) {
 bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 	xtring& lonitem,xtring& latitem,xtring& yearitem,
 	int& lonitemno,int& latitemno,int& yearitemno,
-	float& fromyear,float& toyear,bool& iffrom,bool& ifto,xtring& sep,
-	bool& iffast) {
+	xtring& gridfile,xtring& sep,bool& iffast,bool& ifcache) {
 
-	int i;
-	xtring arg;
+	int i,s;
+	xtring arg,slicelist,statlist,suffix;
+	float fromyear,toyear;
+	bool iffrom,ifto;
 	bool haveinfile=false;
 	iffrom=false,ifto=false;
 	iffast=false;
+	ifcache=false;
 	double dval;
 	sep=" ";
 	
 	// Defaults
 	outfile="";
 	lonitem=latitem=yearitem="";
+	gridfile=slicelist=statlist="";
 	lonitemno=latitemno=yearitemno=0;
 	toyear=fromyear=0;
 	
@@ -664,10 +1111,6 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 						dval=lonitem.num();
 						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 							lonitemno=dval;
-							if (lonitemno>MAXITEM) {
-								printf("Option -lon: too many items (maximum allowed is %d)\n",MAXITEM);
-								return false;
-							}
 							lonitem="";
 						}
 					}
@@ -685,10 +1128,6 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 						dval=latitem.num();
 						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 							latitemno=dval;
-							if (latitemno>MAXITEM) {
-								printf("Option -lat: too many items (maximum allowed is %d)\n",MAXITEM);
-								return false;
-							}
 							latitem="";
 						}
 					}
@@ -706,10 +1145,6 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 						dval=yearitem.num();
 						if (dval>=1.0 && int(dval)==dval) { // seems to be an item number
 							yearitemno=dval;
-							if (yearitemno>MAXITEM) {
-								printf("Option -y: too many items (maximum allowed is %d)\n",MAXITEM);
-								return false;
-							}
 							yearitem="";
 						}
 					}
@@ -752,6 +1187,37 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 				}
 				i+=1;
 			}
+			else if (arg=="-slices") { // several time slices
+				if (argc>=i+2) {
+					slicelist=argv[i+1];
+				}
+				else {
+					printf("Option -slices must be followed by a list of time slices\n");
+					return false;
+				}
+				i+=1;
+			}
+			else if (arg=="-stat") { // statistics to write
+				if (argc>=i+2) {
+					statlist=argv[i+1];
+				}
+				else {
+					printf("Option -stat must be followed by a list of statistics\n");
+					return false;
+				}
+				i+=1;
+			}
+			else if (arg=="-exact") sketchk=0;
+			else if (arg=="-gridlist") { // gridlist, for the number of cells
+				if (argc>=i+2) {
+					gridfile=argv[i+1];
+				}
+				else {
+					printf("Option -gridlist must be followed by gridlist file name or path\n");
+					return false;
+				}
+				i+=1;
+			}
 			else if (arg=="-tab") {
 				sep="\t";
 			}
@@ -759,6 +1225,8 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 				sep="\t";
 				iffast=true;
 			}
+			else if (arg=="-cache") ifcache=true;
+			else if (arg=="-stats") runstats.enable();
 			else if (arg=="-h" || arg=="-help") printhelp(argv[0]);
 			else {
 				printf("Invalid option %s\n",(char*)arg);
@@ -787,25 +1255,52 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 		return false;
 	}
 	
-	if (outfile=="") {
-		
-		xtring filepart=infile;
-		stripfilename(filepart);
-		
-		if (ifto && iffrom) {
-			if (fromyear==toyear)
-				outfile.printf("%s_%g.txt",(char*)filepart,(double)fromyear);
-			else
-				outfile.printf("%s_%g-%g.txt",(char*)filepart,(double)fromyear,(double)toyear);
+	if (statlist!="") {
+		if (!parsestats(statlist)) return false;
+	}
+	else {
+		stats.push_back(STAT_MEAN);
+		statq.push_back(0.0);
+		statlabel.push_back(statname[STAT_MEAN]);
+		ifstat[STAT_MEAN]=true;
+	}
+	
+	if (slicelist!="") {
+		if (iffrom || ifto) {
+			printf("Option -slices may not be combined with -f or -t\n");
+			return false;
 		}
-		else if (ifto) {
-			outfile.printf("%s_-%g.txt",(char*)filepart,(double)toyear);
+		if (!parseslices(slicelist)) return false;
+	}
+	else {
+		Slice* slice=new Slice;
+		if (!slice) fail();
+		slice->fromyear=fromyear;
+		slice->toyear=toyear;
+		slice->iffrom=iffrom;
+		slice->ifto=ifto;
+		slices.push_back(slice);
+	}
+	
+	// Output file names: one slice is written to the file given with -o, and
+	// several to the same name with the years of each slice inserted before the
+	// extension, as in output_1961-1990.txt
+	
+	xtring filepart=infile;
+	stripfilename(filepart);
+	
+	for (s=0;s<(int)slices.size();s++) {
+		Slice& slice=*slices[s];
+		if (outfile=="") {
+			slice.outfile.printf("%s_%s.txt",(char*)filepart,(char*)slice.name());
 		}
-		else if (iffrom) {
-			outfile.printf("%s_%g-.txt",(char*)filepart,(double)fromyear);
+		else if (slices.size()==1) {
+			slice.outfile=outfile;
 		}
 		else {
-			outfile.printf("%s_mean.txt",(char*)filepart);
+			suffix.printf("_%s",(char*)slice.name());
+			slice.outfile=outfile;
+			insertsuffix(slice.outfile,suffix);
 		}
 	}
 	
@@ -815,30 +1310,33 @@ bool processargs(int argc,char* argv[],xtring& infile,xtring& outfile,
 
 int main(int argc,char* argv[]) {
 
-	xtring infile,outfile,lonitem,latitem,yearitem,header;
+	xtring infile,outfile,lonitem,latitem,yearitem,gridfile,header;
 	int lonitemno,latitemno,yearitemno;
-	float fromyear,toyear;
-	bool iffrom,ifto,iffast;
-	Item items[MAXITEM];
-	int nitem,nrec;
+	bool iffast,ifcache;
+	vector<Item> items;
+	int nitem,s;
 	xtring sep;
 	
 	if (!processargs(argc,argv,infile,outfile,lonitem,latitem,yearitem,
-		lonitemno,latitemno,yearitemno,fromyear,toyear,iffrom,ifto,sep,iffast))
+		lonitemno,latitemno,yearitemno,gridfile,sep,iffast,ifcache))
 			abort(argv[0]);
 
 	unixtime(header);
 	header=(xtring)"[TSLICE  "+header+"]\n\n";
 	printf("%s",(char*)header);
 
-	if (readdata(infile,fromyear,toyear,iffrom,ifto,items,nitem,
-		lonitemno,latitemno,yearitemno,lonitem,latitem,yearitem,iffast)) {
+	if (readdata(infile,items,nitem,
+		lonitemno,latitemno,yearitemno,lonitem,latitem,yearitem,gridfile,iffast,ifcache)) {
 	
-		if (writedata(outfile,items,nitem,lonitemno,latitemno,yearitemno,sep)) {
-		
-			printf("\n%d records written to %s\n\n",data.size(),(char*)outfile);
+		for (s=0;s<(int)slices.size();s++) {
+			if (!writedata(*slices[s],items,nitem,lonitemno,latitemno,yearitemno,sep)) break;
+			printf("\n%lu records written to %s\n\n",
+				(unsigned long)slices[s]->data.size(),(char*)slices[s]->outfile);
 		}
 	} 
 	
+	for (s=0;s<(int)slices.size();s++) delete slices[s];
+	
+	runstats.print("tslice");
 	return 0;
 }
@@ -0,0 +1,424 @@
+///////////////////////////////////////////////////////////////////////////////////////
+// GUTIL_TEST
+// Regression checks for the number parsing and formatting, parallel row reading
+// and binary caching of the GUTIL library
+//
+// Run through run_tests.sh, which compiles this file with gutil.cpp and runs it
+// in a scratch directory. Exits with status 1 if any check fails.
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <gutil.h>
+#include <vector>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+int nfail=0;
+
+void check(bool ok,const char* what,const char* detail="") {
+
+	if (!ok) {
+		printf("FAILED: %s %s\n",what,detail);
+		nfail++;
+	}
+}
+
+unsigned long long nextrandom(unsigned long long& state) {
+
+	// xorshift64*, so that the checks are the same on every run
+
+	state^=state>>12;
+	state^=state<<25;
+	state^=state>>27;
+	return state*2685821657736338717ULL;
+}
+
+bool samebits(double a,double b) {
+
+	return !memcmp(&a,&b,sizeof(double));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+// Parsing and formatting
+
+void checkroundtrip(double value,const NumberFormat& fmt) {
+
+	// Shortest output must read back to exactly the same value, whether by
+	// parsefloat or strtod
+
+	char text[64];
+	double parsed;
+	int len;
+
+	len=fmt.format(text,value);
+	if (!parsefloat(text,len,parsed) || !samebits(parsed,value) ||
+		!samebits(strtod(text,NULL),value))
+		check(false,"shortest output reads back exactly:",text);
+}
+
+void checkparse(const char* text) {
+
+	// parsefloat must give the correctly rounded value strtod gives
+
+	double value;
+
+	if (!parsefloat(text,strlen(text),value) || !samebits(value,strtod(text,NULL)))
+		check(false,"parsefloat agrees with strtod:",text);
+}
+
+void testnumbers() {
+
+	const double special[]={0.0,0.1,0.3,0.1+0.2,1.0/3.0,-2.5,1.0e-300,5.0e-324,
+		2.2250738585072014e-308,DBL_MAX,-DBL_MAX,9007199254740993.0,1.0e23,123456.789};
+	const char* decimal[]={"0","-0","1","-5","0.1","0.30000000000000004","1.5E-03",
+		"+7.25","1234567890123456789012345","2.2250738585072011e-308",
+		"4.9406564584124654e-324","1.7976931348623157e+308","0.000001","   62.290  ",
+		"9007199254740993","1e23","8.98846567431158e307"};
+	NumberFormat fmt;
+	ScannedItem item;
+	unsigned long long state=88172645463325252ULL,bits;
+	double value;
+	char text[64];
+	int i;
+
+	fmt.setshortest();
+
+	for (i=0;i<(int)(sizeof(special)/sizeof(double));i++) {
+		checkroundtrip(special[i],fmt);
+		checkroundtrip(-special[i],fmt);
+	}
+
+	// Random bit patterns cover every exponent; random values with a few
+	// decimals are typical of model output
+
+	for (i=0;i<200000;i++) {
+		bits=nextrandom(state);
+		memcpy(&value,&bits,sizeof(double));
+		if (value==value && fabs(value)<=DBL_MAX) checkroundtrip(value,fmt);
+		value=(double)(nextrandom(state)%2000000000)/1000.0-1.0e6;
+		checkroundtrip(value,fmt);
+		sprintf(text,"%.3f",value);
+		checkparse(text);
+		sprintf(text,"%.17g",value);
+		checkparse(text);
+	}
+
+	for (i=0;i<(int)(sizeof(decimal)/sizeof(char*));i++) checkparse(decimal[i]);
+
+	// Shortest means no more digits than needed
+
+	fmt.format(text,0.3);
+	check(!strcmp(text,"0.3"),"shortest output of 0.3:",text);
+	fmt.format(text,0.1+0.2);
+	check(!strcmp(text,"0.30000000000000004"),"shortest output of 0.1+0.2:",text);
+
+	// Malformed numbers are rejected
+
+	check(!parsefloat("",0,value),"parsefloat rejects an empty field");
+	check(!parsefloat("1.2.3",5,value),"parsefloat rejects 1.2.3");
+	check(!parsefloat("12a",3,value),"parsefloat rejects 12a");
+
+	// scannumber finds value and notation as the programs' scanitem did
+
+	scannumber("-12.50",6,item);
+	check(item.isnum && item.ifplain && item.value==-12.5 && item.digits==2 &&
+		item.places==2 && item.ifsign,"scannumber of -12.50");
+	scannumber("1.5E-03",7,item);
+	check(item.isnum && !item.ifplain && item.value==0.0015,"scannumber of 1.5E-03");
+	scannumber("abc",3,item);
+	check(!item.isnum && item.value==0.0,"scannumber of abc");
+	scannumber("",0,item);
+	check(item.isnum && item.ifplain && item.value==0.0,"scannumber of an empty item");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+// Parallel and serial reading
+
+struct Row {
+	bool ok;
+	std::vector<double> val;
+};
+
+const int NCOL=8;
+
+void writerows(const char* filename) {
+
+	// Several blocks of rows, with the irregular lines the programs must cope
+	// with, and no newline after the last line
+
+	unsigned long long state=2463534242ULL;
+	FILE* out=fopen(filename,"wt");
+	int i,c;
+
+	check(out!=NULL,"create row file");
+	if (!out) return;
+
+	fprintf(out,"Lon Lat Year C1 C2 C3 C4 C5\n");
+	for (i=0;i<60000;i++) {
+		if (i%9973==5) fprintf(out,"\n");
+		else if (i%7919==3) fprintf(out," 1.5 2.5 1901 abc 1 2 3 4\n");
+		else if (i%5003==7) fprintf(out," 1.5 2.5 1901 0.25\n");
+		else {
+			for (c=0;c<NCOL;c++)
+				fprintf(out,"%s%.3f",c?(i%2?"\t":"  "):" ",
+					(double)(nextrandom(state)%2000000)/1000.0-1000.0);
+			fprintf(out,i%11?"\n":"\r\n");
+		}
+	}
+	fprintf(out," 3.5 4.5 1999 1 2 3 4 5");
+	fclose(out);
+}
+
+void readserial(const char* filename,std::vector<Row>& rows) {
+
+	// Reference: readfor line by line
+
+	InputFile in;
+	ReadFormat fmt("8f");
+	double dval[NCOL];
+	xtring header;
+	Row row;
+
+	rows.clear();
+	check(in.open(filename),"open row file");
+	readfor(in,"a#",&header);
+	while (!in.eof()) {
+		fmt.bind(0,dval);
+		row.ok=readfor(in,fmt);
+		if (in.eof() && !row.ok) break;
+		row.val.assign(dval,dval+NCOL);
+		rows.push_back(row);
+	}
+}
+
+void readchunked(const char* filename,int nthread,bool mapped,std::vector<Row>& rows) {
+
+	InputFile in;
+	FILE* strm=NULL;
+	ChunkedReader reader;
+	xtring header;
+	Row row;
+
+	rows.clear();
+	if (mapped) {
+		check(in.open(filename),"open row file");
+		readfor(in,"a#",&header);
+		check(reader.open(in,"8f",nthread),"start ChunkedReader");
+	}
+	else {
+		strm=fopen(filename,"rt");
+		check(strm!=NULL,"open row file");
+		if (!strm) return;
+		readfor(strm,"a#",&header);
+		check(reader.open(strm,"8f",nthread),"start ChunkedReader");
+	}
+
+	while (reader.nextrow()) {
+		row.ok=reader.rowok();
+		row.val.assign(reader.values(),reader.values()+NCOL);
+		rows.push_back(row);
+	}
+	reader.close();
+	if (!mapped) fclose(strm);
+}
+
+bool samerows(const std::vector<Row>& a,const std::vector<Row>& b) {
+
+	// Values of rows that could not be read are not compared
+
+	size_t i;
+	int c;
+
+	if (a.size()!=b.size()) return false;
+	for (i=0;i<a.size();i++) {
+		if (a[i].ok!=b[i].ok) return false;
+		if (a[i].ok)
+			for (c=0;c<NCOL;c++)
+				if (!samebits(a[i].val[c],b[i].val[c])) return false;
+	}
+	return true;
+}
+
+void testreading() {
+
+	const char* filename="rows.out";
+	std::vector<Row> serial,parallel;
+	char detail[100];
+	int nthread;
+
+	writerows(filename);
+	readserial(filename,serial);
+	check(serial.size()>60000,"serial reading finds all rows");
+
+	for (nthread=1;nthread<=4;nthread++) {
+		sprintf(detail,"(%d threads, stream)",nthread);
+		readchunked(filename,nthread,false,parallel);
+		check(samerows(serial,parallel),"ChunkedReader matches readfor",detail);
+		sprintf(detail,"(%d threads, InputFile)",nthread);
+		readchunked(filename,nthread,true,parallel);
+		check(samerows(serial,parallel),"ChunkedReader matches readfor",detail);
+	}
+
+	remove(filename);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+// Binary cache
+
+#ifndef _WIN32
+
+void writecells(const char* filename,double first,double middle,int nrow) {
+
+	// A fixed-width file whose size does not depend on the values written
+
+	FILE* out=fopen(filename,"wt");
+	int i;
+
+	check(out!=NULL,"create cache test file");
+	if (!out) return;
+	fprintf(out,"   Lon    Lat  Year    Tot\n");
+	for (i=0;i<nrow;i++)
+		fprintf(out," 10.25  50.75  %4d %6.2f\n",1901+i%100,
+			!i?first:i==nrow/2?middle:1.0);
+	fclose(out);
+}
+
+double cachedvalue(const char* filename,int row) {
+
+	ColumnCache cache;
+	int i;
+
+	if (!cache.open(filename) || cache.ncolumn()!=4) return -1.0;
+	for (i=0;i<=row;i++)
+		if (!cache.nextrow()) return -1.0;
+	return cache.values()[3];
+}
+
+void setmtime(const char* filename,const struct timespec& when) {
+
+	struct timespec times[2];
+
+	times[0]=times[1]=when;
+	check(!utimensat(AT_FDCWD,filename,times,0),"set modification time");
+}
+
+void gettime(const char* filename,struct timespec& when) {
+
+	struct stat st;
+
+	stat(filename,&st);
+#if defined(__APPLE__)
+	when=st.st_mtimespec;
+#else
+	when=st.st_mtim;
+#endif
+}
+
+void testcache() {
+
+	const char* filename="cells.out";
+	const int NROW=20000; // over two hashed blocks
+	struct timespec when,gbin0,gbin1;
+
+	remove("cells.out.gbin");
+
+	// A cache is built on first use and loaded again while the file is unchanged
+
+	writecells(filename,1.5,1.0,NROW);
+	check(cachedvalue(filename,0)==1.5,"cache built from the text");
+	gettime("cells.out.gbin",gbin0);
+	check(cachedvalue(filename,0)==1.5,"cache reused");
+	gettime("cells.out.gbin",gbin1);
+	check(gbin0.tv_sec==gbin1.tv_sec && gbin0.tv_nsec==gbin1.tv_nsec,
+		"unchanged file does not rebuild the cache");
+
+	// Rewritten at the same size with the very same time stamp: only the
+	// hash of the first and last blocks tells the files apart
+
+	gettime(filename,when);
+	writecells(filename,2.5,1.0,NROW);
+	setmtime(filename,when);
+	check(cachedvalue(filename,0)==2.5,"stale cache rejected (same size and time)");
+
+	// Rewritten in the middle only, within the same second: told apart by
+	// the sub-second time
+
+	gettime(filename,when);
+	writecells(filename,2.5,7.5,NROW);
+	when.tv_nsec=(when.tv_nsec+500000000)%1000000000;
+	setmtime(filename,when);
+	check(cachedvalue(filename,NROW/2)==7.5,"stale cache rejected (same size and second)");
+
+	remove(filename);
+	remove("cells.out.gbin");
+}
+
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+// Quantile sketch
+
+void testsketch() {
+
+	const int N=200000;
+	std::vector<double> all;
+	QuantileSketch whole,part[3],exact1,exact2;
+	unsigned long long state=1234567ULL;
+	double value,rank,worst=0.0;
+	int i,p;
+
+	for (i=0;i<N;i++) {
+		value=(double)(nextrandom(state)%1000000)/1000.0;
+		value*=value;
+		all.push_back(value);
+		whole.add(value);
+		part[i<N/4?0:i<N/4+37?1:2].add(value);
+	}
+	part[0].merge(part[1]);
+	part[0].merge(part[2]);
+	std::sort(all.begin(),all.end());
+
+	check(part[0].size()==(unsigned long long)N,"merged sketch counts every value");
+	for (p=1;p<100;p++) {
+		value=part[0].quantile(p/100.0);
+		rank=(std::lower_bound(all.begin(),all.end(),value)-all.begin())/(double)N;
+		if (fabs(rank-p/100.0)>worst) worst=fabs(rank-p/100.0);
+	}
+	check(worst<2.0/QUANTILESKETCH_K,"merged sketch rank error within 2/k");
+
+	exact1.init(0);
+	exact2.init(0);
+	for (i=0;i<10;i++) (i%2?exact1:exact2).add(i);
+	exact1.merge(exact2);
+	check(exact1.quantile(0.5)==4.5 && exact1.quantile(0.25)==2.25,
+		"exact sketches merge exactly");
+}
+
+
+int main(int argc,char* argv[]) {
+
+	testnumbers();
+	testreading();
+#ifndef _WIN32
+	testcache();
+#endif
+	testsketch();
+
+	if (nfail) {
+		printf("%d check(s) failed\n",nfail);
+		return 1;
+	}
+	printf("All gutil checks passed\n");
+	return 0;
+}
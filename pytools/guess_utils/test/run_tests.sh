@@ -0,0 +1,61 @@
+#!/bin/bash
+# Regression checks for the guess_utils programs and the GUTIL library.
+# Usage: run_tests.sh [<build-directory>]
+# The library checks (gutil_test.cpp) and the programs used below are compiled
+# into the build directory (a temporary one by default) with $CXX (default g++);
+# extra compiler and linker flags may be given in $CXXFLAGS and $LIBS, e.g.
+#   CXXFLAGS="-DHAVE_ZLIB" LIBS="-lz" ./run_tests.sh
+# Exits with status 1 if any check fails.
+
+TESTDIR=$(cd "$(dirname "$0")" && pwd)
+SRCDIR=$TESTDIR/../src
+CXX=${CXX:-g++}
+BUILD=${1:-$(mktemp -d)}
+FAILED=0
+
+mkdir -p "$BUILD" || exit 1
+
+build() {
+	# build <name> <source>
+	$CXX -std=c++11 -O2 -pthread $CXXFLAGS -I"$SRCDIR/gutil" "$2" "$SRCDIR/gutil/gutil.cpp" \
+		-o "$BUILD/$1" $LIBS || { echo "FAILED: could not build $1"; exit 1; }
+}
+
+compare() {
+	# compare <description> <expected-file> <output-file>
+	if cmp -s "$2" "$3"; then
+		echo "ok: $1"
+	else
+		echo "FAILED: $1"
+		diff "$2" "$3" | head -20
+		FAILED=1
+	fi
+}
+
+build gutil_test "$TESTDIR/gutil_test.cpp"
+for prog in delta joyn; do
+	build $prog "$SRCDIR/$prog.cpp"
+done
+
+# Library: parse/format round trip, parallel against serial reading, stale cache
+# rejection and quantile sketches (run in the build directory, where it writes
+# its scratch files)
+
+(cd "$BUILD" && ./gutil_test) || FAILED=1
+
+# Programs: items missing from short rows are read as 0, never as the values
+# of an earlier row
+
+cd "$BUILD" || exit 1
+./delta "$TESTDIR/data/short_a.out" "$TESTDIR/data/short_b.out" -i Lon Lat Year \
+	-o delta_short.txt > delta_short.log 2>&1
+compare "delta with short rows" "$TESTDIR/expected/delta_short.txt" delta_short.txt
+./joyn "$TESTDIR/data/short_a.out" "$TESTDIR/data/short_b.out" -i Lon Lat Year \
+	-o joyn_short.txt > joyn_short.log 2>&1
+compare "joyn with short rows" "$TESTDIR/expected/joyn_short.txt" joyn_short.txt
+
+if [ $FAILED != 0 ]; then
+	echo "Some checks failed"
+	exit 1
+fi
+echo "All checks passed"